@@ -0,0 +1,128 @@
+/*******************************************************************************
+ * Measures the evaluation of a gate and checks that it doesn't allocate. Every
+ * allocation function is replaced, which is why it is not part of the tests.
+ ******************************************************************************/
+#include "common.h"
+#include "core.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+using namespace lcs;
+
+/* Counted for each thread, since the logging thread allocates while it
+ * formats the trace messages of the gate. */
+static thread_local size_t _alloc_count = 0;
+
+static void* _allocate(size_t size, size_t align = 0) noexcept
+{
+    _alloc_count++;
+    if (size == 0) {
+        size = 1;
+    }
+    if (align <= alignof(std::max_align_t)) {
+        return std::malloc(size);
+    }
+    /* std::aligned_alloc requires a multiple of the alignment. */
+    return std::aligned_alloc(align, (size + align - 1) / align * align);
+}
+
+static void* _allocate_or_throw(size_t size, size_t align = 0)
+{
+    if (void* p = _allocate(size, align)) {
+        return p;
+    }
+    throw std::bad_alloc {};
+}
+
+void* operator new(size_t size) { return _allocate_or_throw(size); }
+void* operator new[](size_t size) { return _allocate_or_throw(size); }
+void* operator new(size_t size, std::align_val_t align)
+{
+    return _allocate_or_throw(size, static_cast<size_t>(align));
+}
+void* operator new[](size_t size, std::align_val_t align)
+{
+    return _allocate_or_throw(size, static_cast<size_t>(align));
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return _allocate(size);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return _allocate(size);
+}
+void* operator new(
+    size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+    return _allocate(size, static_cast<size_t>(align));
+}
+void* operator new[](
+    size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+    return _allocate(size, static_cast<size_t>(align));
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+void operator delete[](void* p, size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+void operator delete(
+    void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+void operator delete[](
+    void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+
+int main(void)
+{
+    static constexpr size_t RUN_S = 100000;
+    Scene s;
+    auto g_xor = s.add_node<GateNode>(GateType::XOR);
+    for (sockid i = 0; i < 8; i++) {
+        if (i >= 2) {
+            s.get_node<GateNode>(g_xor)->increment();
+        }
+        auto v = s.add_node<InputNode>();
+        s.connect(g_xor, i, v);
+        s.get_node<InputNode>(v)->set(i % 3 == 0);
+    }
+    NRef<GateNode> gate = s.get_node<GateNode>(g_xor);
+
+    size_t alloc_begin = _alloc_count;
+    auto begin         = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < RUN_S; i++) {
+        gate->on_signal();
+    }
+    auto end = std::chrono::steady_clock::now();
+    size_t allocs = _alloc_count - alloc_begin;
+    std::printf("8-input gate evaluation: %lld ns, %zu allocations\n",
+        static_cast<long long>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+                .count()
+            / RUN_S),
+        allocs);
+    return allocs == 0 && gate->get() == State::TRUE ? 0 : 1;
+}
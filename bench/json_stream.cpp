@@ -0,0 +1,117 @@
+/*******************************************************************************
+ * Compares the time and peak memory of the streaming JSON loader against
+ * Json::Reader and Scene::from_json. Each loader runs in its own process, so
+ * the peak of one doesn't hide the other.
+ ******************************************************************************/
+#include "common.h"
+#include "core.h"
+#include "io.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <json/json.h>
+#include <string>
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace lcs;
+
+/* A chain of gates, each one connected to the previous one and an input. */
+static std::string _generate(size_t gate_s)
+{
+    Scene s { "JSON benchmark" };
+    Node prev = s.add_node<InputNode>();
+    for (size_t i = 0; i < gate_s; i++) {
+        Node v = s.add_node<InputNode>();
+        Node g = s.add_node<GateNode>(
+            static_cast<GateType>(i % GateType::GATE_S), sockid { 2 });
+        if (g.id == 0 || v.id == 0) {
+            break;
+        }
+        s.get_node<GateNode>(g)->point = Point { static_cast<int>(i), 0 };
+        s.get_node<InputNode>(v)->set(i % 2 == 0);
+        s.connect(g, 0, prev);
+        s.connect(g, 1, v);
+        prev = g;
+    }
+    s.connect(s.add_node<OutputNode>(), 0, prev);
+    return s.to_json().toStyledString();
+}
+
+#ifndef _WIN32
+static long _peak_rss_kib(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/* Runs fn in a child process, so its peak memory is measured alone. */
+template <typename F> static bool _in_child(F fn)
+{
+    std::fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        bool is_ok = fn();
+        std::fflush(stdout);
+        std::_Exit(is_ok ? 0 : 1);
+    }
+    int status = 1;
+    return pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status)
+        && WEXITSTATUS(status) == 0;
+}
+
+static bool _measure(const std::filesystem::path& path, bool is_dom)
+{
+    long rss_begin = _peak_rss_kib();
+    auto begin     = std::chrono::steady_clock::now();
+    std::string text = read(path.string());
+    Scene s;
+    Error err = OK;
+    if (is_dom) {
+        Json::Reader reader {};
+        Json::Value root;
+        err = reader.parse(text, root) ? s.from_json(root)
+                                       : Error::INVALID_JSON_FORMAT;
+    } else {
+        err = io::load_json(text.data(), text.size(), s);
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::printf("%-8s %8lld us, peak RSS %8ld KiB (+%ld KiB)\n",
+        is_dom ? "DOM" : "Stream",
+        static_cast<long long>(
+            std::chrono::duration_cast<std::chrono::microseconds>(end - begin)
+                .count()),
+        _peak_rss_kib(), _peak_rss_kib() - rss_begin);
+    return err == OK;
+}
+#endif
+
+int main(int argc, char** argv)
+{
+#ifdef _WIN32
+    (void)argc, (void)argv;
+    std::printf("Peak memory is only measured on POSIX systems.\n");
+    return 0;
+#else
+    size_t gate_s = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    std::filesystem::path path
+        = std::filesystem::temp_directory_path() / "lcs_json_stream.json";
+    bool is_ok = _in_child([&]() {
+        std::string text = _generate(gate_s);
+        std::printf("Loading %zu bytes of JSON.\n", text.size());
+        std::ofstream file { path, std::ios::binary };
+        return static_cast<bool>(file << text);
+    });
+    for (bool is_dom : { false, true }) {
+        is_ok = is_ok && _in_child([&]() { return _measure(path, is_dom); });
+    }
+    std::filesystem::remove(path);
+    return is_ok ? 0 : 1;
+#endif
+}
@@ -0,0 +1,14 @@
+if(LCS_BUILD_BENCHMARKS)
+    set(LCS_BENCH_DEP core common io jsoncpp_static base64)
+
+    include_directories(include)
+
+    # Each file is a separate executable, so benchmarks that replace the
+    # allocation functions don't affect the others.
+    file(GLOB BENCHMARKS bench/*.cpp)
+    foreach(BENCH ${BENCHMARKS})
+        get_filename_component(BENCH_NAME ${BENCH} NAME_WE)
+        add_executable(${PRJ}.${BENCH_NAME} ${BENCH})
+        target_link_libraries(${PRJ}.${BENCH_NAME} ${LCS_BENCH_DEP})
+    endforeach()
+endif()
@@ -0,0 +1,18 @@
+if(NOT LCS_GUI)
+    project(lcs-sim C CXX)
+    set(LCS_SIM_DEPENDS core common io jsoncpp_static base64)
+
+    include_directories(include)
+    include(cmake/Tfd.cmake)
+    include(cmake/Json.cmake)
+    include(cmake/Others.cmake)
+
+    add_subdirectory(src/common)
+    add_subdirectory(src/core)
+    add_subdirectory(src/io)
+
+    file(GLOB SIM_SOURCES src/cli/*.cpp)
+    add_executable(lcs-sim ${SIM_SOURCES})
+
+    target_link_libraries(lcs-sim ${LCS_SIM_DEPENDS})
+endif()
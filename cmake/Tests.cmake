@@ -5,15 +5,7 @@ if(LCS_BUILD_TESTS)
     include_directories(include)
     include_directories(external/doctest/doctest)
 
-    # Only build them if they are not built by the Application
-    if(NOT LCS_GUI)
-        include(cmake/Tfd.cmake)
-        include(cmake/Json.cmake)
-        include(cmake/Others.cmake)
-        add_subdirectory(src/common)
-        add_subdirectory(src/core)
-        add_subdirectory(src/io)
-    endif()
+    # Libraries are built by either the Application or lcs-sim
     add_subdirectory(external/doctest)
 
     file(GLOB TESTS src/main.cpp test/*.cpp)
@@ -22,10 +14,13 @@ if(LCS_BUILD_TESTS)
         ${PRJ}.tst
         ${LCS_TEST_DEP}
     doctest::doctest)
-target_compile_definitions(${PRJ}.tst
-    PRIVATE
-     __TESTING__=1
-)
+    # Tracing tests read the INFO and DEBUG messages, which release builds
+    # remove at compile time otherwise.
+    target_compile_definitions(${PRJ}.tst
+        PRIVATE
+        __TESTING__=1
+        LCS_TRACE_LEVEL=0
+    )
     add_compile_definitions()
 
     add_custom_target(run_tests
@@ -10,10 +10,14 @@
  * License: GNU GENERAL PUBLIC LICENSE
  ******************************************************************************/
 
+#include <cstdio>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #define VERSION "0.1"
 
@@ -71,7 +75,8 @@ std::string read(const std::string& path);
 bool read(const std::string& path, std::vector<unsigned char>& data);
 
 /**
- * Write contents of data to the desired path.
+ * Write contents of data to the desired path. The data is written to a
+ * temporary file first, which then replaces the file at path.
  * @param path to save
  * @param data to save
  * @returns Whether the operation is successful or not
@@ -96,6 +101,9 @@ typedef uint8_t sockid;
 /** Relationship identifier. Id is a non-zero identifier. */
 typedef uint32_t relid;
 
+/** Interned component name, see io::component::intern. 0 is not a valid id. */
+typedef uint32_t compid;
+
 /** Type of a node in a scene. */
 enum NodeType : uint8_t {
     /** Logic gate. */
@@ -194,7 +202,6 @@ struct Node final : public Serializable {
                                   LOGGING/
 ******************************************************************************/
 
-extern std::ofstream __TEST_LOG__;
 enum LogLevel { DEBUG, INFO, WARN, ERROR };
 static constexpr const char* LogLevel_str(LogLevel l)
 {
@@ -206,6 +213,8 @@ static constexpr const char* LogLevel_str(LogLevel l)
     }
 }
 
+struct Trace;
+
 struct Line {
     Line()            = default;
     LogLevel severity = DEBUG;
@@ -222,28 +231,25 @@ struct Line {
         /*optional*/ Node object, const char* fmt, Args... args)
     {
         _set_time();
-        severity = l;
-        std::strncpy(log_level_str.data(), LogLevel_str(l),
-            log_level_str.max_size() - 1);
-        std::snprintf(
-            file_line.data(), file_line.max_size() - 1, "%s:%3d", file, line);
-        _fn_parse(_fn);
-        if (object.id != 0 || object.type != 0) {
-            std::strncpy(
-                obj.data(), object.to_str().c_str(), obj.max_size() - 1);
-            node = object;
-        }
+        _set_source(l, file, line, _fn, object);
         std::snprintf(expr.data(), expr.max_size() - 1, fmt, args...);
     }
 
+    /** Formats a trace message, see t_push. */
+    explicit Line(const Trace& trace);
+
 private:
     void _fn_parse(std::string fnname);
     void _set_time(void);
+    void _set_time(uint64_t ms);
+    void _set_source(
+        LogLevel l, const char* file, int line, const char* fn, Node object);
 };
 
 /**
  * Push a log message to the stack. Intended to be used by the macros such as
- * L_INFO, L_WARN, L_ERROR, L_DEBUG.
+ * L_INFO, L_WARN, L_ERROR, L_DEBUG. Thread-safe, the line is written to the
+ * stream and the file later by the logging thread, see l_flush.
  * @param line to push
  *
  */
@@ -253,7 +259,21 @@ void l_push(Line&& line);
 void l_clear(void);
 
 /**
- * Loop over existing logs starting from the oldest.
+ * Sets the stream log messages are printed to, stdout by default.
+ * @param stream to print to, nullptr to only keep them in the buffer
+ */
+void l_set_stream(FILE* stream);
+
+/**
+ * Sets the file log messages are written to without colors, none by default.
+ * @param path to write to, an empty path closes the file
+ * @returns whether the file is opened
+ */
+bool l_set_file(const std::filesystem::path& path);
+
+/**
+ * Loop over existing logs starting from the oldest. The log is locked during
+ * the iteration, so f must not log.
  * @param f iteration function
  */
 void l_iterate(std::function<void(size_t, const Line&)> f);
@@ -270,7 +290,6 @@ int __expect(std::function<bool(void)> expr, const char* function,
 #define L_INFO(...) __LLOG__(lcs::LogLevel::INFO, 0, __VA_ARGS__)
 #define L_WARN(...) __LLOG__(lcs::LogLevel::WARN, 0, __VA_ARGS__)
 #define L_ERROR(...) __LLOG__(lcs::LogLevel::ERROR, 0, __VA_ARGS__)
-#define C_DEBUG(...) __LLOG__(lcs::LogLevel::DEBUG, this->id(), __VA_ARGS__)
 
 #define lcs_assert(expr)                                                       \
     {                                                                          \
@@ -287,6 +306,122 @@ int __expect(std::function<bool(void)> expr, const char* function,
 #define L_DEBUG(...)
 #endif
 
+/**
+ * Lowest LogLevel that the tracing macros record, messages of the lower levels
+ * are removed at compile time. Defaults to LogLevel::WARN in release builds.
+ */
+#ifndef LCS_TRACE_LEVEL
+#ifdef NDEBUG
+#define LCS_TRACE_LEVEL 2
+#else
+#define LCS_TRACE_LEVEL 0
+#endif
+#endif
+
+/** Call site of a tracing macro. */
+struct TracePoint {
+    LogLevel severity;
+    const char* file;
+    int line;
+    const char* fn;
+};
+
+/**
+ * A log message that keeps its arguments in their binary form. Trace messages
+ * are formatted when the log is read, so recording one only copies its
+ * arguments.
+ */
+struct Trace {
+    /** Maximum number of arguments of a trace message. */
+    static constexpr size_t ARG_S = 6;
+
+    const TracePoint* point;
+    /** Format string, has to outlive the message. */
+    const char* fmt;
+    /** Formats the arguments, instantiated for their types by t_push. */
+    int (*format)(char* out, size_t n, const char* fmt, const uint64_t* args);
+    /** Milliseconds since the start of the application. */
+    uint64_t time;
+    Node node;
+    uint64_t args[ARG_S];
+};
+
+template <typename T> T _t_arg(const uint64_t& raw)
+{
+    T value;
+    std::memcpy(&value, &raw, sizeof(T));
+    return value;
+}
+
+template <typename... Args, size_t... I>
+int _t_format_args(char* out, size_t n, const char* fmt, const uint64_t* raw,
+    std::index_sequence<I...>)
+{
+    return std::snprintf(out, n, fmt, _t_arg<Args>(raw[I])...);
+}
+
+template <typename... Args>
+int _t_format(char* out, size_t n, const char* fmt, const uint64_t* raw)
+{
+    if constexpr (sizeof...(Args) == 0) {
+        (void)raw;
+        return std::snprintf(out, n, "%s", fmt);
+    } else {
+        return _t_format_args<Args...>(
+            out, n, fmt, raw, std::index_sequence_for<Args...> {});
+    }
+}
+
+/** Adds a trace message to the lock-free trace ring. */
+void _t_push(const Trace& trace);
+
+/**
+ * Records a trace message. Intended to be used by the macros such as T_INFO,
+ * T_DEBUG and C_DEBUG. Can be called from any thread. Messages are dropped
+ * while the trace ring is full.
+ * @param point call site
+ * @param node that sent the message, 0 if there is none
+ * @param fmt printf style format string, has to outlive the message
+ * @param args up to Trace::ARG_S numbers or pointers, pointed strings have to
+ * outlive the message
+ */
+template <typename... Args>
+void t_push(const TracePoint& point, Node node, const char* fmt, Args... args)
+{
+    static_assert(sizeof...(Args) <= Trace::ARG_S, "Too many arguments.");
+    static_assert(((std::is_trivially_copyable_v<Args>
+                       && sizeof(Args) <= sizeof(uint64_t))
+                      && ...),
+        "Trace arguments have to be numbers or pointers.");
+    Trace trace { &point, fmt, _t_format<Args...>, 0, node, {} };
+    if constexpr (sizeof...(Args) != 0) {
+        size_t i = 0;
+        ((std::memcpy(&trace.args[i++], &args, sizeof(Args))), ...);
+    }
+    _t_push(trace);
+}
+
+/**
+ * Writes the trace messages and the log lines that haven't been written yet.
+ * Lines are otherwise written in batches by the logging thread.
+ */
+void l_flush(void);
+
+#define __TRACE__(STATUS, NODE, ...)                                           \
+    do {                                                                       \
+        if constexpr ((STATUS) >= LCS_TRACE_LEVEL) {                           \
+            static const lcs::TracePoint __point__ {                           \
+                STATUS, __FILE_NAME__, __LINE__, __PRETTY_FUNCTION__           \
+            };                                                                 \
+            lcs::t_push(__point__, NODE, __VA_ARGS__);                         \
+        }                                                                      \
+    } while (0)
+
+#define T_DEBUG(...) __TRACE__(lcs::LogLevel::DEBUG, 0, __VA_ARGS__)
+#define T_INFO(...) __TRACE__(lcs::LogLevel::INFO, 0, __VA_ARGS__)
+#define C_DEBUG(...)                                                           \
+    __TRACE__(lcs::LogLevel::DEBUG, this->id(), __VA_ARGS__)
+
 #define S_ERROR(msg, ...) (L_ERROR(msg)), __VA_ARGS__
 #define ERROR(err) (L_ERROR("%s: %s", #err, errmsg(err))), err
 #ifndef WARN
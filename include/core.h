@@ -14,15 +14,23 @@
 #include <bitset>
 #include <cstdint>
 #include <map>
+#include <memory>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace lcs {
 
 class Scene;
+namespace io {
+    class Waveform;
+    namespace component {
+        struct Version;
+    }
+}
 
-enum State {
+enum State : uint8_t {
     /** Socket evaluated to false. */
     FALSE,
     /** Socket evaluated to true. */
@@ -126,13 +134,149 @@ struct Rel final : public Serializable {
     Node to_node;
     sockid from_sock;
     sockid to_sock;
-    State value;
+    /** Whether the relation kept changing when the event budget of the last
+     * propagation ran out, see Scene::set_event_budget. */
+    bool is_oscillating;
 
     /* Serializable Interface */
     Json::Value to_json() const override;
     LCS_ERROR from_json(const Json::Value&) override;
 };
 
+/**
+ * Stores the relations of a scene in a vector indexed by their relid. Since
+ * relation ids are only ever incremented, removed relations are left in place
+ * as tombstones with Rel::id 0 instead of moving the others.
+ *
+ * The values of the relations are kept in a separate packed array, so signal
+ * propagation does not have to load the rest of the relation. A tombstone, and
+ * relid 0, always have the value State::DISABLED.
+ */
+class RelTable {
+    template <typename R> class Iterator {
+    public:
+        Iterator(R* it, R* end)
+            : _it { it }
+            , _end { end }
+        {
+            _skip();
+        }
+
+        inline R& operator*() const { return *_it; }
+        inline R* operator->() const { return _it; }
+        inline bool operator==(const Iterator& o) const { return _it == o._it; }
+        inline bool operator!=(const Iterator& o) const { return _it != o._it; }
+        Iterator& operator++()
+        {
+            _it++;
+            _skip();
+            return *this;
+        }
+
+    private:
+        inline void _skip(void)
+        {
+            while (_it != _end && _it->id == 0) {
+                _it++;
+            }
+        }
+
+        R* _it;
+        R* _end;
+    };
+
+public:
+    using iterator       = Iterator<Rel>;
+    using const_iterator = Iterator<const Rel>;
+
+    RelTable()
+        : _rels { Rel {} }
+        , _values { State::DISABLED }
+        , _size { 0 } { };
+    RelTable(const RelTable&)            = default;
+    RelTable(RelTable&&)                 = default;
+    RelTable& operator=(const RelTable&) = default;
+    RelTable& operator=(RelTable&&)      = default;
+    ~RelTable()                          = default;
+
+    inline iterator begin(void)
+    {
+        return { _rels.data(), _rels.data() + _rels.size() };
+    }
+    inline iterator end(void)
+    {
+        return { _rels.data() + _rels.size(), _rels.data() + _rels.size() };
+    }
+    inline const_iterator begin(void) const
+    {
+        return { _rels.data(), _rels.data() + _rels.size() };
+    }
+    inline const_iterator end(void) const
+    {
+        return { _rels.data() + _rels.size(), _rels.data() + _rels.size() };
+    }
+    /** Number of relations, excluding tombstones. */
+    inline size_t size(void) const { return _size; }
+    inline bool empty(void) const { return _size == 0; }
+    inline bool contains(relid id) const
+    {
+        return id < _rels.size() && _rels[id].id != 0;
+    }
+
+    /** Returns the relation with the given id, or nullptr. */
+    inline NRef<Rel> find(relid id)
+    {
+        return contains(id) ? &_rels[id] : nullptr;
+    }
+    inline NRef<const Rel> find(relid id) const
+    {
+        return contains(id) ? &_rels[id] : nullptr;
+    }
+
+    /** Returns the value of a relation, State::DISABLED if it doesn't exist. */
+    inline State value(relid id) const
+    {
+        return id < _values.size() ? _values[id] : State::DISABLED;
+    }
+    /** Updates the value of an existing relation. */
+    inline void set_value(relid id, State value) { _values[id] = value; }
+
+    /**
+     * Inserts a relation with State::FALSE unless its id is already in use.
+     * @param rel to insert, must have a non-zero id
+     * @returns the relation with the same id
+     */
+    Rel& emplace(Rel rel)
+    {
+        relid id = rel.id;
+        if (id >= _rels.size()) {
+            _rels.resize(id + 1);
+            _values.resize(id + 1, State::DISABLED);
+        }
+        if (_rels[id].id == 0) {
+            _rels[id]   = std::move(rel);
+            _values[id] = State::FALSE;
+            _size++;
+        }
+        return _rels[id];
+    }
+
+    /** Replaces the relation with a tombstone. */
+    void erase(relid id)
+    {
+        if (contains(id)) {
+            _rels[id]   = Rel {};
+            _values[id] = State::DISABLED;
+            _size--;
+        }
+    }
+
+private:
+    std::vector<Rel> _rels;
+    std::vector<State> _values;
+    size_t _size;
+};
+
 /**
  * Describes a single logic gate.
  */
@@ -151,6 +295,28 @@ public:
     bool decrement(void);
     inline GateType type(void) const { return _type; };
 
+    /**
+     * Calculates the result of a gate from the number of its TRUE inputs,
+     * so the inputs never have to be collected.
+     * @param type of the gate
+     * @param ones number of TRUE inputs
+     * @param size number of inputs
+     * @returns result of the gate
+     */
+    static constexpr bool apply(GateType type, size_t ones, size_t size)
+    {
+        switch (type) {
+        case GateType::NOT: return ones == 0;
+        case GateType::AND: return ones == size;
+        case GateType::OR: return ones != 0;
+        case GateType::XOR: return ones & 1;
+        case GateType::NAND: return ones != size;
+        case GateType::NOR: return ones == 0;
+        case GateType::XNOR: return !(ones & 1);
+        default: return false;
+        }
+    }
+
     /* BaseNode */
     bool is_connected(void) const override;
     State get(sockid slot = 0) const override;
@@ -166,8 +332,7 @@ public:
     std::vector<relid> output;
 
 private:
-    /** Gate specific calculation function */
-    bool (*_apply)(const std::vector<bool>&);
+    friend class Netlist;
 
     GateType _type;
     State _value;
@@ -175,6 +340,26 @@ private:
     sockid _max_in;
 };
 
+/**
+ * Signal values of a single instance of a component. Instances of a component
+ * share the netlist of the loaded component and only keep their values, so
+ * sequential components such as latches and counters remember their state
+ * separately. See io::component::run.
+ */
+struct InstanceState {
+    /** Value of each signal of the netlist. */
+    std::vector<State> values;
+    /** Cells of the netlist that have to be evaluated. */
+    std::vector<uint8_t> pending;
+    /** States of the components inside the instance. */
+    std::vector<InstanceState> children;
+    /** Netlist::build the values belong to, 0 if they are not set. */
+    uint32_t build = 0;
+    /** Loaded component the instance runs, which is kept alive by the
+     * instance until it runs a reloaded one. */
+    std::shared_ptr<const io::component::Version> component;
+};
+
 class ComponentNode final : public BaseNode, public Serializable {
 public:
     explicit ComponentNode(Scene*, Node, const std::string& path = "");
@@ -201,8 +386,14 @@ public:
     std::string path;
 
 private:
+    friend class Netlist;
     bool _is_disabled;
     uint64_t _output_value;
+    /** Interned path, resolved once by ComponentNode::set_component. */
+    compid _component;
+    /** State of the component in SimulationMode::INTERPRETED, the netlist
+     * keeps its own in SimulationMode::COMPILED. */
+    InstanceState _state;
 };
 
 /**
@@ -220,6 +411,14 @@ public:
     ~InputNode()                           = default;
 
     bool is_timer(void) const { return _freq.has_value(); }
+    /**
+     * Turns the input into a clock, or back to a regular input. Clocks are
+     * toggled by the Scheduler of the scene.
+     * @param freq toggles per second, up to Scheduler::MAX_FREQUENCY.
+     * std::nullopt or a non-positive value for a regular input
+     * @param phase offset as a fraction of the period
+     */
+    void set_clock(std::optional<float> freq, float phase = 0);
     /** Set the value, and notify connected nodes.
      * @param value to set
      **/
@@ -239,6 +438,8 @@ public:
     std::vector<relid> output;
 
     std::optional<float> _freq;
+    /** Phase offset of the clock as a fraction of its period. */
+    float _phase;
 
 private:
     bool _value;
@@ -266,6 +467,7 @@ public:
     relid input;
 
 private:
+    friend class Netlist;
     State _value;
 };
 
@@ -298,12 +500,33 @@ struct ComponentContext final : public Serializable {
      */
     uint64_t run(uint64_t input);
 
+    /**
+     * Execute a scene using the given input and the state of an instance,
+     * without modifying the scene. Can be called from multiple threads with
+     * separate states, see Netlist::run.
+     * @param input binary encoded input, same as ComponentContext::run
+     * @param state of the instance, initialized on the first run
+     * @returns binary encoded result
+     */
+    uint64_t run(uint64_t input, InstanceState& state) const;
+
     /**
      * Execute a scene using the existing state.
      * @returns binary encoded result
      */
     uint64_t run();
 
+    /**
+     * Execute a scene for each of the given inputs. Inputs are evaluated
+     * in groups of 64 on the compiled netlist, see Netlist::evaluate_lanes.
+     * Each input is evaluated independently from the existing state, and the
+     * state of the scene is not modified.
+     * @param input binary encoded inputs, same as ComponentContext::run
+     * @param output binary encoded results, has to fit n items
+     * @param n number of inputs
+     */
+    void run_batch(const uint64_t* input, uint64_t* output, size_t n);
+
     /** Get node id for given input socket */
     Node get_input(sockid id) const;
 
@@ -324,6 +547,7 @@ struct ComponentContext final : public Serializable {
     std::vector<relid> outputs;
 
 private:
+    friend class Netlist;
     /** Temporarily used input value */
     std::bitset<64> _execution_input;
     /** Temporarily used output value */
@@ -349,8 +573,522 @@ template <typename T> constexpr NodeType as_node_type(void)
     return NodeType::NODE_S;
 }
 
+/**
+ * Dense storage for the nodes of a scene. Nodes are stored contiguously and
+ * are looked up by their Node::id through a sparse table, so a lookup is a
+ * single indexed load and iteration never leaves the dense array. Removing a
+ * node moves the last node into its place, so references to nodes are only
+ * valid until the next insertion or removal.
+ *
+ * Every slot of the sparse table has a generation that is incremented when
+ * its node is removed. A SlotMap::Handle can not reach a node that reuses an
+ * id after its original node was removed. Ids of removed nodes are reused by
+ * SlotMap::next_id before new ones.
+ *
+ * Node::id 0 is reserved as the null node.
+ */
+template <typename T> class SlotMap {
+public:
+    using value_type     = std::pair<Node, T>;
+    using iterator       = typename std::vector<value_type>::iterator;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+
+    /** A generation checked reference to a node. */
+    struct Handle {
+        uint16_t id;
+        uint32_t generation;
+    };
+
+    SlotMap()
+        : _sparse { Slot { NONE, 0 } } { };
+    SlotMap(const SlotMap&)            = default;
+    SlotMap(SlotMap&&)                 = default;
+    SlotMap& operator=(const SlotMap&) = default;
+    SlotMap& operator=(SlotMap&&)      = default;
+    ~SlotMap()                         = default;
+
+    inline iterator begin(void) { return _dense.begin(); }
+    inline iterator end(void) { return _dense.end(); }
+    inline const_iterator begin(void) const { return _dense.begin(); }
+    inline const_iterator end(void) const { return _dense.end(); }
+    inline size_t size(void) const { return _dense.size(); }
+    inline bool empty(void) const { return _dense.empty(); }
+
+    iterator find(Node id)
+    {
+        return _contains(id.id) ? _dense.begin() + _sparse[id.id].index
+                                : _dense.end();
+    }
+
+    const_iterator find(Node id) const
+    {
+        return _contains(id.id) ? _dense.begin() + _sparse[id.id].index
+                                : _dense.end();
+    }
+
+    /**
+     * Inserts a node with the given id unless the id is already in use.
+     * @param id of the node
+     * @param value node to insert
+     * @returns the node with the given id, and whether it was inserted
+     */
+    std::pair<iterator, bool> emplace(Node id, T value)
+    {
+        if (id.id == 0) {
+            return { end(), false };
+        } else if (_contains(id.id)) {
+            return { find(id), false };
+        }
+        for (uint32_t i = _sparse.size(); i < id.id; i++) {
+            _free.push_back(i);
+        }
+        if (id.id >= _sparse.size()) {
+            _sparse.resize(id.id + 1, Slot { NONE, 0 });
+        }
+        _sparse[id.id].index = _dense.size();
+        _dense.emplace_back(id, std::move(value));
+        return { _dense.end() - 1, true };
+    }
+
+    /**
+     * Removes a node. The last node is moved into its place, so references
+     * and iterators to that node are invalidated, unlike its Handle.
+     * @param it node to remove
+     */
+    void erase(iterator it)
+    {
+        uint16_t id    = it->first.id;
+        uint32_t index = _sparse[id].index;
+        if (index + 1 != _dense.size()) {
+            *it                         = std::move(_dense.back());
+            _sparse[it->first.id].index = index;
+        }
+        _dense.pop_back();
+        _sparse[id].index = NONE;
+        _sparse[id].generation++;
+        _free.push_back(id);
+    }
+
+    /**
+     * Returns the id for the next node. Ids that were never used are returned
+     * first, so state that others keep by id, such as the editor, doesn't
+     * carry over to a new node until the removed ids are reused.
+     * @returns id | 0 if every id is in use
+     */
+    uint16_t next_id(void)
+    {
+        if (_sparse.size() <= UINT16_MAX) {
+            return _sparse.size();
+        }
+        while (!_free.empty() && _contains(_free.back())) {
+            _free.pop_back();
+        }
+        return _free.empty() ? 0 : _free.back();
+    }
+
+    /** Creates a generation checked reference to an existing node. */
+    Handle handle(Node id) const
+    {
+        return Handle { id.id,
+            id.id < _sparse.size() ? _sparse[id.id].generation : 0 };
+    }
+
+    /**
+     * Obtain a node from its handle.
+     * @param h handle of the node
+     * @returns T* | nullptr if the node was removed
+     */
+    NRef<T> get(Handle h)
+    {
+        if (!_contains(h.id) || _sparse[h.id].generation != h.generation) {
+            return nullptr;
+        }
+        return &_dense[_sparse[h.id].index].second;
+    }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+    struct Slot {
+        uint32_t index;
+        uint32_t generation;
+    };
+
+    inline bool _contains(uint32_t id) const
+    {
+        return id < _sparse.size() && _sparse[id].index != NONE;
+    }
+
+    std::vector<value_type> _dense;
+    std::vector<Slot> _sparse;
+    /** Ids of removed nodes, may contain ids that are in use again. */
+    std::vector<uint16_t> _free;
+};
+
+/** Selects how a scene propagates signals between its nodes. */
+enum SimulationMode : uint8_t {
+    /** Each signal is routed through Scene::signal and BaseNode::on_signal. */
+    INTERPRETED,
+    /** Input changes are evaluated on a levelized Netlist of the scene. */
+    COMPILED,
+};
+
+/**
+ * A flattened copy of a scene that is used for simulation. Every node is
+ * stored as a cell and every output socket of a node as a signal. Cells are
+ * sorted by their topological level, so a single pass over Netlist::_order
+ * settles every path of the scene. Cells that are part of a feedback loop, or
+ * that depend on one, are placed after the acyclic ones and are iterated until
+ * they settle.
+ *
+ * The node and relation maps of the Scene remain the source of truth. The
+ * netlist is rebuilt on the next evaluation after any structural change, and
+ * writes changed values back to the scene after each evaluation.
+ *
+ * When the netlist is flattened, see Netlist::set_flatten, the scenes of the
+ * components are inlined as instances instead of being executed through
+ * io::component::run. Values of the nodes inside an instance can be read with
+ * Netlist::get_value.
+ */
+class Netlist {
+public:
+    /** Signal index of a disconnected input slot. */
+    static constexpr uint32_t NONE = UINT32_MAX;
+    /** Maximum number of passes over the cells in a feedback loop. */
+    static constexpr size_t CYCLE_LIMIT = 64;
+    /** Levels with fewer cells are always evaluated on a single thread. */
+    static constexpr size_t PARALLEL_LIMIT = 4096;
+    /** Number of cells a thread evaluates at once. */
+    static constexpr size_t CHUNK_SIZE = 512;
+
+    /** Cell types. Gate cells use their GateType as the cell type. */
+    enum CellType : uint8_t {
+        CELL_INPUT = GateType::GATE_S,
+        CELL_OUTPUT,
+        CELL_COMPONENT,
+        CELL_COMPONENT_INPUT,
+        CELL_COMPONENT_OUTPUT,
+        /** Component input slot of an inlined component. */
+        CELL_INSTANCE_INPUT,
+        /** Output socket of an inlined ComponentNode. */
+        CELL_INSTANCE_OUTPUT,
+    };
+
+    Netlist(Scene* parent = nullptr);
+    Netlist(const Netlist&)            = delete;
+    Netlist(Netlist&&)                 = default;
+    Netlist& operator=(const Netlist&) = delete;
+    Netlist& operator=(Netlist&&)      = default;
+    ~Netlist()                         = default;
+
+    inline void reload(Scene* parent)
+    {
+        _parent = parent;
+        if (!_instances.empty()) {
+            _instances[0].scene = parent;
+        }
+    }
+
+    /** Marks the netlist as outdated, it will be rebuilt before the next
+     * evaluation. */
+    inline void invalidate(void) { _is_dirty = true; }
+    inline bool is_dirty(void) const { return _is_dirty; }
+
+    /**
+     * Enables inlining the scenes of components into the netlist, including
+     * the components they depend on. Components with clocks are still
+     * executed through io::component::run, since their clocks are driven by
+     * the loaded component. A flattened netlist is rebuilt whenever a
+     * component is reloaded.
+     * @param is_flat whether components should be inlined
+     */
+    inline void set_flatten(bool is_flat)
+    {
+        _is_flat  = is_flat;
+        _is_dirty = true;
+    }
+    inline bool is_flat(void) const { return _is_flat; }
+
+    /** Rebuilds the netlist from the parent scene. */
+    void compile(void);
+
+    /**
+     * Updates the value of an input or a component input cell. The change
+     * is applied on the next Netlist::evaluate call.
+     * @param id of an InputNode or a NodeType::COMPONENT_INPUT
+     * @param value to set
+     */
+    void set(Node id, State value);
+
+    /**
+     * Evaluates all pending cells and writes the changes back to the scene.
+     * Compiles the netlist first if it is outdated.
+     * @returns whether the feedback loops settled within Netlist::CYCLE_LIMIT
+     */
+    bool evaluate(void);
+
+    /**
+     * Evaluates 64 independent patterns at once without modifying the scene.
+     * Every bit of a word is a separate lane, so each gate is evaluated for
+     * all patterns with a single bitwise operation. Feedback loops start from
+     * the current state of the scene in every lane.
+     * @param input a word for each component input slot
+     * @param output a word for each component output slot
+     */
+    void evaluate_lanes(const uint64_t* input, uint64_t* output);
+
+    /**
+     * Evaluates the component inputs with the signal values of an instance
+     * instead of the values of the scene. Only the cells that the input
+     * changes are evaluated. Instances start from the state of the scene at
+     * the last compilation, and again whenever the netlist is rebuilt.
+     *
+     * The netlist is only read, so it can be run from multiple threads as
+     * long as each thread uses its own state. It has to be compiled first.
+     * @param input binary encoded input, same as ComponentContext::run
+     * @param state of the instance
+     * @returns binary encoded result
+     */
+    uint64_t run(uint64_t input, InstanceState& state) const;
+
+    /** Number of cells */
+    inline size_t size(void) const { return _type.size(); }
+    /** Number of topological levels, excluding the feedback loops. */
+    inline size_t levels(void) const
+    {
+        return _level_offset.empty() ? 0 : _level_offset.size() - 1;
+    }
+    /** Whether the scene contains a feedback loop. */
+    inline bool is_cyclic(void) const { return _cyclic_begin < _order.size(); }
+    /** Number of inlined components. */
+    inline size_t instances(void) const { return _instances.size() - 1; }
+    /** Number of signal changes since the netlist was created. */
+    inline uint64_t event_count(void) const { return _event_count; }
+    /** Unique number of the last compilation, 0 if it was never compiled. */
+    inline uint32_t build(void) const { return _build; }
+
+    /**
+     * Sets the number of threads that evaluate the levels of every netlist
+     * with at least Netlist::PARALLEL_LIMIT cells, including the calling
+     * thread. The results are identical to the single threaded evaluation.
+     * @param count number of threads, 0 to use all hardware threads
+     */
+    static void set_thread_count(size_t count);
+    static size_t thread_count(void);
+
+    /**
+     * Returns the value of a node inside an inlined component.
+     * @param path ComponentNodes that lead to the component, starting from
+     * the parent scene
+     * @param id of the node inside the component
+     * @param sock output socket of the node
+     * @returns State | State::DISABLED if the node was not inlined
+     */
+    State get_value(
+        const std::vector<Node>& path, Node id, sockid sock = 0) const;
+
+private:
+    /** A component that has been inlined into the netlist. */
+    struct Instance {
+        /** Instance that contains the ComponentNode, 0 for the parent. */
+        uint32_t parent;
+        /** ComponentNode of the instance. */
+        Node node;
+        const Scene* scene;
+    };
+
+    /** Side effects of a chunk of cells that were evaluated by a worker. */
+    struct Chunk {
+        /** Changed signals. */
+        std::vector<uint32_t> changed;
+        /** Changed output cells. */
+        std::vector<uint32_t> sinks;
+        /** Component cells, evaluated after the level. */
+        std::vector<uint32_t> deferred;
+    };
+
+    inline static uint64_t _key(uint32_t instance, Node id)
+    {
+        return uint64_t { instance } << 32 | id.numeric();
+    }
+    bool _is_outdated(void) const;
+    void _add_cell(
+        uint32_t instance, Node id, uint8_t type, uint32_t aux, uint32_t out_s);
+    void _add_cells(const Scene& s, uint32_t instance);
+    void _add_inputs(uint32_t cell);
+    const Scene* _get_inlinable(const std::string& path, uint32_t instance);
+    uint32_t _signal_of(uint32_t instance, relid id) const;
+    void _eval(uint32_t cell, Chunk* chunk = nullptr);
+    void _eval_level(uint32_t begin, uint32_t end);
+    uint32_t _compute(uint32_t cell, const State* value, InstanceState* states,
+        State* out) const;
+    void _eval(uint32_t cell, InstanceState& state) const;
+    void _set_signal(InstanceState& state, uint32_t signal, State value) const;
+    void _set_signal(uint32_t signal, State value, Chunk* chunk = nullptr);
+    void _mark_changed(uint32_t signal);
+    void _write_back(void);
+    void _read_values(void);
+    bool _eval_lanes(uint32_t cell);
+    bool _set_lane(uint32_t signal, uint64_t value);
+    uint32_t _cell_of(Node id) const;
+
+    Scene* _parent;
+    bool _is_dirty;
+    bool _is_flat;
+    /** io::component::revision at the last compilation. */
+    uint32_t _revision;
+    uint32_t _build;
+
+    /** Type of each cell, see Netlist::CellType. */
+    std::vector<uint8_t> _type;
+    /** Node that each cell was compiled from. */
+    std::vector<Node> _node;
+    /** Component index for component cells, slot for context cells,
+     * socket for instance output cells. */
+    std::vector<uint32_t> _aux;
+    std::vector<compid> _component_ids;
+    /** State of each component cell, by their component index. */
+    std::vector<InstanceState> _states;
+    /** Cells of the component input and output slots, by their slot. */
+    std::vector<uint32_t> _slot_in;
+    std::vector<uint32_t> _slot_out;
+    /** Instance of each cell, 0 for the cells of the parent scene. */
+    std::vector<uint32_t> _instance;
+    /** Inlined components, the first item is the parent scene. */
+    std::vector<Instance> _instances;
+    /** Instance of each inlined ComponentNode, see Netlist::_key. */
+    std::unordered_map<uint64_t, uint32_t> _children;
+    /** First cell of each node, see Netlist::_key. */
+    std::unordered_map<uint64_t, uint32_t> _cells;
+    /** First input of each cell in Netlist::_in, has size() + 1 items. */
+    std::vector<uint32_t> _in_offset;
+    /** Signal connected to each input slot, or Netlist::NONE. */
+    std::vector<uint32_t> _in;
+    /** First output signal of each cell, has size() + 1 items. */
+    std::vector<uint32_t> _out_offset;
+    /** Cell that drives each signal. */
+    std::vector<uint32_t> _driver;
+    /** First reader of each signal in Netlist::_fanout. */
+    std::vector<uint32_t> _fanout_offset;
+    /** Cells that read each signal. */
+    std::vector<uint32_t> _fanout;
+    /** First relation of each signal in Netlist::_rels. */
+    std::vector<uint32_t> _rel_offset;
+    /** Relations that carry each signal. */
+    std::vector<relid> _rels;
+    /** Current value of each signal. */
+    std::vector<State> _value;
+    /** Value of each signal after the compilation, see Netlist::run. */
+    std::vector<State> _initial;
+
+    /** Cells sorted by their level. */
+    std::vector<uint32_t> _order;
+    /** First cell of each level in Netlist::_order. */
+    std::vector<uint32_t> _level_offset;
+    /** Cells starting from this index in Netlist::_order are cyclic. */
+    size_t _cyclic_begin;
+
+    /** Cells that have to be evaluated. */
+    std::vector<uint8_t> _pending;
+    /** Signals that have been changed since the last write back. */
+    std::vector<uint32_t> _changed;
+    /** Output cells that have been changed since the last write back. */
+    std::vector<uint32_t> _changed_sinks;
+    /** Value of each signal in Netlist::evaluate_lanes, a bit per pattern. */
+    std::vector<uint64_t> _lanes;
+    /** Chunks of the level that is evaluated in parallel. */
+    std::vector<Chunk> _chunks;
+    uint64_t _event_count;
+};
+
+/**
+ * Toggles the clocks of a scene in simulation time. Every clock is queued with
+ * the time of its next toggle, so advancing the time only visits the clocks
+ * that toggle within it, independent of their frequencies and of the frame
+ * rate.
+ *
+ * A clock with frequency f toggles f times per second, so a full period takes
+ * 2 / f seconds. With phase p it toggles at 2p / f + k / f seconds for every
+ * k > 0.
+ */
+class Scheduler {
+public:
+    /** Simulation time of a second, time is measured in nanoseconds. */
+    static constexpr uint64_t SECOND = 1'000'000'000;
+    /** Highest frequency of a clock, see InputNode::set_clock. */
+    static constexpr float MAX_FREQUENCY = 1e6f;
+
+    Scheduler(Scene* parent = nullptr);
+    Scheduler(const Scheduler&)            = delete;
+    Scheduler(Scheduler&&)                 = default;
+    Scheduler& operator=(const Scheduler&) = delete;
+    Scheduler& operator=(Scheduler&&)      = default;
+    ~Scheduler()                           = default;
+
+    inline void reload(Scene* parent) { _parent = parent; }
+
+    /**
+     * Schedules the next toggle of a clock after the current time. Replaces
+     * the pending toggle if the clock was already scheduled.
+     * @param id of the InputNode
+     * @param freq toggles per second, has to be positive
+     * @param phase offset as a fraction of the period
+     */
+    void add(Node id, float freq, float phase = 0);
+
+    /**
+     * Removes a clock from the schedule.
+     * @param id of the InputNode
+     */
+    void remove(Node id);
+
+    inline bool empty(void) const { return _clocks.empty(); }
+    inline size_t size(void) const { return _clocks.size(); }
+    /** Current simulation time. */
+    inline uint64_t now(void) const { return _now; }
+    /** Time of the next toggle, UINT64_MAX if there are no clocks. */
+    uint64_t next(void);
+
+    /**
+     * Toggles the clocks in the order of their toggle times until the given
+     * time, then sets the current time. Clocks that toggle at the same time
+     * are toggled in the order of their ids.
+     * @param time to advance to, earlier times are ignored
+     * @returns number of toggles
+     */
+    size_t run_until(uint64_t time);
+
+private:
+    struct Event {
+        uint64_t time;
+        /** Number of half periods since the phase offset. */
+        uint64_t step;
+        Node id;
+        /** Has to match the sequence of the clock, otherwise the event has
+         * been replaced. */
+        uint32_t seq;
+    };
+    struct Clock {
+        double half_period;
+        double offset;
+        uint32_t seq;
+    };
+
+    /** Drops the replaced events from the top of the queue. */
+    void _prune(void);
+
+    Scene* _parent;
+    uint64_t _now;
+    uint32_t _seq;
+    /** Min-heap of the pending toggles, ordered by time then node id. */
+    std::vector<Event> _queue;
+    std::map<Node, Clock> _clocks;
+};
+
 class Scene final : public Serializable {
 public:
+    /** Default number of node updates in a single propagation step. */
+    static constexpr size_t EVENT_BUDGET = 1 << 20;
+
     Scene(const std::string& name = "", const std::string& author = "",
         const std::string& description = "", int _version = 1);
     Scene(ComponentContext ctx, const std::string& name = "",
@@ -362,26 +1100,81 @@ public:
     Scene& operator=(const Scene&) = delete;
     ~Scene()                       = default;
 
-    /** Run a frame for the scene. */
-    void run_timers(void);
+    /**
+     * Advances the simulation time of the scene, toggling the clocks on the
+     * way. See Scheduler::run_until.
+     * @param time to advance to
+     * @returns number of toggles
+     */
+    inline size_t run_timers(uint64_t time)
+    {
+        return _scheduler.run_until(time);
+    }
+
+    /**
+     * Selects the simulation engine of the scene.
+     * @param mode to use
+     */
+    void set_mode(SimulationMode mode);
+    inline SimulationMode mode(void) const { return _mode; }
+
+    /** Marks the compiled netlist as outdated. Has to be called after any
+     * change in the structure of the scene. */
+    inline void invalidate(void) { _netlist.invalidate(); }
+
+    /**
+     * Propagates the current value of an input node or a component input.
+     * In SimulationMode::COMPILED the change is evaluated on the netlist,
+     * otherwise it is propagated through BaseNode::on_signal.
+     * @param id of the changed node
+     */
+    void evaluate(Node id);
+
+    /**
+     * Limits the number of node updates in a single propagation step. A step
+     * that runs out of its budget is considered to be oscillating, and the
+     * relations that keep changing are marked with Rel::is_oscillating.
+     * @param budget maximum number of node updates, Scene::EVENT_BUDGET by
+     * default
+     */
+    inline void set_event_budget(size_t budget) { _event_budget = budget; }
+    inline size_t event_budget(void) const { return _event_budget; }
+
+    /** Number of relations that have changed their value since the scene
+     * was created, including the signals of the compiled netlist. */
+    inline uint64_t event_count(void) const
+    {
+        return _event_count + _netlist.event_count();
+    }
 
     /** Creates a node in a scene with given type. Passes arguments to
-     * the constructor similar to emplace methods.
+     * the constructor similar to emplace methods. May invalidate the
+     * references to the other nodes of the same type.
      * @param args to pass
-     * @returns node identifier of newly created node.
+     * @returns node identifier of newly created node, its id is 0 if all ids
+     * of the type are in use.
      */
     template <class T, class... Args> Node add_node(Args&&... args)
     {
         constexpr NodeType node_type = as_node_type<T>();
-        _last_node[node_type].id++;
-        std::map<Node, T>& nodemap = _get_node_map<T>();
-        return nodemap
-            .emplace(_last_node[node_type],
-                T { this, _last_node[node_type].id, args... })
-            .first->first;
+        SlotMap<T>& nodemap          = _get_node_map<T>();
+        Node id { nodemap.next_id(), node_type };
+        if (id.id == 0) {
+            L_ERROR("All %s ids are in use.",
+                NodeType_to_str_full(node_type));
+            return id;
+        }
+        if (id.id > _last_node[node_type].id) {
+            _last_node[node_type] = id;
+        }
+        _netlist.invalidate();
+        return nodemap.emplace(id, T { this, id, args... }).first->first;
     }
 
-    /** Safely removes given node from the scene.
+    /** Safely removes given node from the scene. The last node of the same
+     * type is moved into its place, so the references from get_node to
+     * nodes of that type are invalidated. Use SlotMap::handle to refer to a
+     * node across removals.
      * @param id node to remove
      */
     void remove_node(Node id);
@@ -393,8 +1186,8 @@ public:
      */
     template <typename T> NRef<T> get_node(Node id)
     {
-        std::map<Node, T>& nodemap = _get_node_map<T>();
-        auto g                     = nodemap.find(id);
+        SlotMap<T>& nodemap = _get_node_map<T>();
+        auto g              = nodemap.find(id);
         lcs_assert(
             id.id != 0 && g != nodemap.end() && id.type == as_node_type<T>());
         return &g->second;
@@ -416,6 +1209,13 @@ public:
      */
     NRef<Rel> get_rel(relid id);
 
+    /**
+     * Obtain the value of a relationship.
+     * @param id rel id
+     * @returns State | State::DISABLED if the relation doesn't exist
+     */
+    inline State get_value(relid id) const { return _relations.value(id); }
+
     /**
      * Attempts to connect two nodes from their given sockets. Id of such
      * relation will be automatically generated and returned on success.
@@ -444,12 +1244,47 @@ public:
     LCS_ERROR disconnect(relid id);
 
     /**
-     * Trigger a signal for the given relation while updating it's value.
+     * Trigger a signal for the given relation while updating it's value. The
+     * target node is queued and updated once the ongoing propagation step
+     * reaches it, so signals never recurse.
      * @param id relationship id
      * @param value to set
      */
     void signal(relid id, State value);
 
+    /**
+     * Starts a batch of edits. Until the matching Scene::commit, connecting
+     * nodes doesn't evaluate them and signals are only queued, so adding
+     * many relations doesn't propagate through the graph for each of them.
+     * Batches can be nested.
+     */
+    void begin(void);
+
+    /**
+     * Ends a batch that was started by Scene::begin. The outermost commit
+     * settles the scene once, evaluating every node in topological order.
+     */
+    void commit(void);
+    inline bool is_batch(void) const { return _batch_depth != 0; }
+
+    /** Starts a batch that is committed at the end of the scope. */
+    class Batch {
+    public:
+        explicit Batch(Scene& scene)
+            : _scene { scene }
+        {
+            _scene.begin();
+        }
+        Batch(const Batch&)            = delete;
+        Batch(Batch&&)                 = delete;
+        Batch& operator=(const Batch&) = delete;
+        Batch& operator=(Batch&&)      = delete;
+        ~Batch() { _scene.commit(); }
+
+    private:
+        Scene& _scene;
+    };
+
     /** Returns a dependency string. */
     std::string to_dependency(void) const;
     /** Returns file path to save. */
@@ -458,7 +1293,7 @@ public:
      * Loads dependencies according to the internal list.
      * @returns Error on failure:
      *
-     * - io::component::fetch
+     * - io::component::fetch_all
      *
      */
     LCS_ERROR load_dependencies(void);
@@ -471,13 +1306,18 @@ public:
     std::vector<std::string> dependencies;
     std::optional<ComponentContext> component_context;
 
-    std::map<Node, GateNode> _gates;
-    std::map<Node, ComponentNode> _components;
-    std::map<Node, InputNode> _inputs;
-    std::map<Node, OutputNode> _outputs;
-    std::map<relid, Rel> _relations;
-    /** key = Node::id, value: internal clock counter */
-    std::map<Node, float> _timerlist;
+    SlotMap<GateNode> _gates;
+    SlotMap<ComponentNode> _components;
+    SlotMap<InputNode> _inputs;
+    SlotMap<OutputNode> _outputs;
+    RelTable _relations;
+    /** Toggle times of the clocks, see InputNode::set_clock. */
+    Scheduler _scheduler;
+    /** Compiled copy of the scene, used in SimulationMode::COMPILED. */
+    Netlist _netlist;
+    /** Receives the value changes of the relations while recording, see
+     * io::Waveform::open. */
+    io::Waveform* _waveform;
 
     /**
      * Attempts to connect two nodes from their given sockets. On success
@@ -509,10 +1349,33 @@ public:
     relid _last_rel;
 
 private:
+    SimulationMode _mode;
+
+    /** Nodes that are waiting to be updated in the current step. */
+    std::vector<Node> _worklist;
+    /** Relations that are marked with Rel::is_oscillating. */
+    std::vector<relid> _oscillating;
+    size_t _event_budget;
+    uint64_t _event_count;
+    /** Number of nested batches, see Scene::begin. */
+    size_t _batch_depth;
+    bool _is_propagating;
+    bool _is_budget_exceeded;
+
+    /** Queues the target of a relation, and propagates unless a step is
+     * already in progress. */
+    void _notify(Rel& rel);
+    /** Updates the nodes in the worklist until it is empty or the event
+     * budget runs out. */
+    void _propagate(void);
+    /** Evaluates every node once in topological order, then propagates
+     * through the nodes that are part of a cycle. */
+    void _settle(void);
+
     /** The helper method for move constructor and move assignment */
     void _move_from(Scene&&);
 
-    template <class T> std::map<Node, T>& _get_node_map()
+    template <class T> SlotMap<T>& _get_node_map()
     {
         constexpr bool is_gate      = std::is_same<T, GateNode>::value;
         constexpr bool is_component = std::is_same<T, ComponentNode>::value;
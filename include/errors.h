@@ -57,14 +57,20 @@ enum Error {
     INVALID_DEPENDENCY_FORMAT,
     /** Component contains a undefined dependency. */
     UNDEFINED_DEPENDENCY,
+    /** Components depend on each other. */
+    CYCLIC_DEPENDENCY,
     /** Not a valid JSON document. */
     INVALID_JSON_FORMAT,
+    /** Not a valid binary scene, or written by a newer version. */
+    INVALID_BINARY_FORMAT,
     /** Invalid file format */
     NOT_A_JSON,
     /** No such file or directory in given path */
     NOT_FOUND,
     /** Failed to save file*/
     NO_SAVE_PATH_DEFINED,
+    /** The file could not be written to the disk. */
+    WRITE_FAILED,
     /** Failed to send the request to the server. Request didn't arrive to the
        server. */
     REQUEST_FAILED,
@@ -119,10 +125,13 @@ constexpr const char* errmsg(Error e)
     case REL_CONNECT_ERROR: return "An error occurred while connecting a node.";
     case INVALID_DEPENDENCY_FORMAT: return "Invalid dependency string. ";
     case UNDEFINED_DEPENDENCY: return "Undefined dependency.";
+    case CYCLIC_DEPENDENCY: return "Components depend on each other.";
     case INVALID_JSON_FORMAT: return "Invalid JSON document.";
+    case INVALID_BINARY_FORMAT: return "Invalid binary scene.";
     case NOT_A_JSON: return "Invalid file format.";
     case NOT_FOUND: return "No such file or directory.";
     case NO_SAVE_PATH_DEFINED: return "Failed to save file.";
+    case WRITE_FAILED: return "Failed to write file.";
     case REQUEST_FAILED: return "Failed to send the request.";
     case RESPONSE_ERROR: return "Bad request.";
     case JSON_PARSE_ERROR: return "Response is not a valid JSON string.";
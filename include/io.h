@@ -11,13 +11,21 @@
  ******************************************************************************/
 
 #include "common.h"
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include <vector>
 
 namespace Json {
 class Value;
 }
 namespace lcs {
 class Scene;
+struct InstanceState;
+enum State : uint8_t;
 namespace io {
     /**
      * Parse a component from given string data, if it's a valid component
@@ -34,6 +42,54 @@ namespace io {
      */
     LCS_ERROR load(const std::string& data, Scene& scene);
 
+    /**
+     * Reads a scene from JSON text without building a document. Nodes are
+     * inserted while the text is tokenized, with the same validation and
+     * error codes as Scene::from_json.
+     *
+     * @param data JSON text, doesn't have to be NUL-terminated
+     * @param size of the text
+     * @param scene to update
+     * @returns Error on failure:
+     *
+     * - Error::INVALID_JSON_FORMAT
+     * - Serializable::from_json
+     */
+    LCS_ERROR load_json(const char* data, size_t size, Scene& scene);
+
+    /**
+     * Maps a scene file to memory and parses it in place. Files starting with
+     * io::binary::MAGIC are read as binary scenes, others as JSON.
+     *
+     * @param path to the file
+     * @param scene to update
+     * @returns Error on failure:
+     *
+     * - Error::NOT_FOUND
+     * - Error::INVALID_JSON_FORMAT
+     * - io::binary::load
+     * - Serializable::from_json
+     */
+    LCS_ERROR load_file(const std::string& path, Scene& scene);
+
+    /** Layout of the JSON text written by io::to_text. */
+    enum JsonStyle : uint8_t {
+        /** Without whitespace, for files only the application reads. */
+        MINIFIED,
+        /** Same as Json::Value::toStyledString, for human-edited files. */
+        STYLED,
+    };
+
+    /**
+     * Writes a JSON document to text. Both styles are read back to the same
+     * document.
+     *
+     * @param doc to write
+     * @param style of the text
+     * @returns JSON text
+     */
+    std::string to_text(const Json::Value& doc, JsonStyle style = MINIFIED);
+
     /***************************************************************************
                                         Scene
     ***************************************************************************/
@@ -77,6 +133,7 @@ namespace io {
          * @returns Error on failure:
          *
          * - Error::NO_SAVE_PATH_DEFINED
+         * - Error::WRITE_FAILED
          */
         LCS_ERROR save(size_t idx = SIZE_MAX);
 
@@ -87,9 +144,53 @@ namespace io {
          * @returns Error on failure:
          *
          * - Error::NO_SAVE_PATH_DEFINED
+         * - Error::WRITE_FAILED
          */
         LCS_ERROR save_as(const std::string& new_path, size_t idx = SIZE_MAX);
 
+        /**
+         * Saves the scene in the background. The scene is serialized on the
+         * simulation thread, then written to a temporary file by a worker
+         * thread and renamed over the previous file. Saves of the same file
+         * are written in the order they were started.
+         *
+         * The scene is marked as saved immediately, io::scene::poll_save
+         * reports the result of the write. A loaded component is replaced
+         * by the saved one after the write succeeds.
+         * @param idx index of the scene, active scene if not provided
+         * @returns Error on failure:
+         *
+         * - Error::NO_SAVE_PATH_DEFINED
+         */
+        LCS_ERROR save_async(size_t idx = SIZE_MAX);
+
+        /**
+         * Saves the scene to a new path in the background, see
+         * io::scene::save_async.
+         * @param new_path to save
+         * @param idx index of the scene, active scene if not provided
+         * @returns Error on failure:
+         *
+         * - Error::NO_SAVE_PATH_DEFINED
+         */
+        LCS_ERROR save_as_async(
+            const std::string& new_path, size_t idx = SIZE_MAX);
+
+        /** Result of a save that was written in the background. */
+        struct SaveResult {
+            std::string path;
+            Error err = OK;
+        };
+
+        /**
+         * Takes the result of a finished background save. Scenes that could
+         * not be written are marked as unsaved again, with
+         * Error::WRITE_FAILED.
+         * @param result to update
+         * @returns whether a save has finished
+         */
+        bool poll_save(SaveResult& result);
+
         /**
          * Closes the scene with selected path, erasing from memory.
          * @param idx index of the scene, active scene if not provided
@@ -104,13 +205,113 @@ namespace io {
          */
         NRef<Scene> get(size_t idx = SIZE_MAX);
 
+        /** Default time budget of a frame in turbo mode, in microseconds. */
+        constexpr uint32_t TURBO_BUDGET = 10'000;
+        /** Longest simulation time a frame can advance, in nanoseconds. */
+        constexpr uint64_t FRAME_LIMIT = 100'000'000;
+
         /**
          * Runs a single frame to update values of selected scene and it's
-         * dependency's clocks.
+         * dependency's clocks, including the components used by its
+         * components. The simulation time advances by the real time
+         * since the previous frame, up to io::scene::FRAME_LIMIT. Fast clocks
+         * can't take more than the time budget of the turbo mode, the
+         * simulation falls behind the real time instead. In turbo mode the
+         * clocks run as fast as possible until the time budget of the frame is
+         * spent.
          * @param idx to select
          */
         void run_frame(size_t idx = SIZE_MAX);
 
+        /**
+         * Advances the selected scene and its dependencies to the next toggle
+         * of their clocks, see io::scene::run_frame.
+         * @param idx to select
+         * @returns whether there was a clock to toggle
+         */
+        bool step(size_t idx = SIZE_MAX);
+
+        /**
+         * Enables or disables the turbo mode of io::scene::run_frame.
+         * @param is_enabled whether the clocks should run faster than real
+         * time
+         * @param budget time a frame can spend on the clocks, in microseconds
+         */
+        void set_turbo(bool is_enabled, uint32_t budget = TURBO_BUDGET);
+        bool is_turbo(void);
+
+        /** Real time between the frames of the simulation thread, in
+         * microseconds. */
+        constexpr uint32_t FRAME_INTERVAL = 1'000;
+
+        /**
+         * Values of a scene at the end of a frame. The simulation thread
+         * publishes a snapshot of the active scene after each frame, so the
+         * user interface can read the values without waiting for the
+         * simulation.
+         */
+        class Snapshot {
+        public:
+            Snapshot();
+
+            /** Copies the values of given scene, reusing the buffers. */
+            void capture(Scene& scene);
+
+            /** Value of a relation, State::DISABLED if it doesn't exist. */
+            State get(relid id) const;
+            /** Value of an output socket of a node, State::DISABLED if the
+             * node doesn't exist. */
+            State get(Node id, sockid sock = 0) const;
+            bool is_oscillating(relid id) const;
+
+            /** Simulation time of the scene, in nanoseconds. */
+            uint64_t time;
+            /** Number of snapshots that were published before this one. */
+            uint64_t revision;
+
+        private:
+            struct Value {
+                uint64_t bits;
+                bool is_disabled;
+            };
+
+            std::vector<State> _relations;
+            std::vector<bool> _oscillating;
+            /** Values of the nodes of each type, indexed by their ids. */
+            std::array<std::vector<Value>, NodeType::NODE_S> _nodes;
+        };
+
+        /**
+         * Starts the simulation thread. The thread owns the active scene:
+         * it runs io::scene::run_frame every io::scene::FRAME_INTERVAL,
+         * applies the edits from io::scene::post and publishes a
+         * io::scene::Snapshot after each frame.
+         *
+         * While the thread is running, other threads must not modify the
+         * nodes, the relations or the values of the active scene directly.
+         */
+        void start(void);
+
+        /** Stops the simulation thread, applying the remaining edits. */
+        void stop(void);
+        bool is_running(void);
+
+        /**
+         * Queues an edit of the active scene and waits until the simulation
+         * thread applies it and publishes the next snapshot. Runs the edit
+         * immediately if the simulation thread is not running.
+         * @param edit to apply
+         */
+        void post(std::function<void(Scene&)> edit);
+
+        /**
+         * Returns the latest snapshot of the active scene. The snapshot stays
+         * valid until the next call, which must be from the same thread.
+         * Captures the active scene if the simulation thread is not running.
+         * @returns snapshot or nullptr if there is no active scene
+         */
+        NRef<const Snapshot> snapshot(void);
+
         /**
          * Creates an empty scene with given name
          * @param name Scene name
@@ -143,6 +344,15 @@ namespace io {
     ***************************************************************************/
 
     namespace component {
+        /** Default value of io::component::set_truth_table_limit. */
+        constexpr size_t TRUTH_TABLE_LIMIT = 16;
+        /**
+         * Largest input count a truth table can be built for. Tables are
+         * built while the component storage is locked, so they are kept
+         * small.
+         */
+        constexpr size_t TRUTH_TABLE_MAX = 16;
+
         /**
          * Verifies the existence of a component. If it hasn't been loaded yet,
          * loads the component from the file system. If the component does not
@@ -170,22 +380,347 @@ namespace io {
             bool invalidate = false);
 
         /**
-         * Executes the component with given id with provided input, returning
-         * it's result.
+         * Loads the components that are not loaded yet, along with their own
+         * dependencies. Each component is read once, independent components
+         * are parsed in parallel and a component is only loaded after the
+         * components it depends on.
+         * @param names of the components
+         * @returns Error on failure:
          *
+         * - Error::INVALID_DEPENDENCY_FORMAT
+         * - Error::CYCLIC_DEPENDENCY
+         * - Error::NOT_A_COMPONENT
+         * - io::load_file
+         */
+        LCS_ERROR fetch_all(const std::vector<std::string>& names);
+
+        /**
+         * Returns a stable id for the component name, which can be executed
+         * without looking the name up again. The component doesn't have to
+         * be loaded, it is fetched on the first run and again after a
+         * component is reloaded.
          * @param name component name
+         * @returns id of the component, never 0
+         */
+        compid intern(const std::string& name);
+
+        /**
+         * Executes the component with given id with provided input, returning
+         * it's result. Returns 0 if the component can't be loaded.
+         *
+         * Combinational components with up to
+         * io::component::set_truth_table_limit inputs are simulated for every
+         * possible input on their first run, later runs are looked up from
+         * the resulting truth table. Truth tables are discarded whenever a
+         * component is reloaded.
+         *
+         * @param id component id from io::component::intern
          * @param input binary encoded input value
          * @returns - binary encoded result
          */
+        uint64_t run(compid id, uint64_t input);
+
+        /** Executes the component by its name, see io::component::run. */
         uint64_t run(const std::string& name, uint64_t input);
 
+        /**
+         * Executes an instance of the component with given id. Sequential
+         * components keep the signal values of each instance in its state,
+         * while the loaded component is shared by all instances. Components
+         * that are evaluated from a truth table don't use the state, neither
+         * do components with clocks, which run on the loaded component since
+         * its clocks are toggled by io::scene::run_frame.
+         *
+         * Unlike the other overloads it can be called from multiple threads
+         * with separate states, including while a component is reloaded.
+         * An instance keeps running the version of the component it started
+         * with until its next run after the reload.
+         * @param id component id from io::component::intern
+         * @param input binary encoded input value
+         * @param state of the instance, empty for a new instance
+         * @returns - binary encoded result
+         */
+        uint64_t run(compid id, uint64_t input, InstanceState& state);
+
+        /**
+         * Executes the component with given id for each of the provided
+         * inputs, see ComponentContext::run_batch.
+         *
+         * @param id component id from io::component::intern
+         * @param input binary encoded input values
+         * @param output binary encoded results, has to fit n items
+         * @param n number of inputs
+         */
+        void run_batch(
+            compid id, const uint64_t* input, uint64_t* output, size_t n);
+
+        /** Executes the component by its name, see io::component::run_batch. */
+        void run_batch(const std::string& name, const uint64_t* input,
+            uint64_t* output, size_t n);
+
         /**
          * Returns a reference to a dependency. Dependency has to be loaded to
-         * use this method.
+         * use this method. The lookup is thread-safe, the reference stays
+         * valid until the component is reloaded.
          * @param name of the component
          * @returns Constant reference to a component or nullptr
          */
         NRef<const Scene> get(const std::string& name);
+
+        /**
+         * Sets the maximum number of inputs a component can have to be
+         * evaluated from a truth table, see io::component::run. A truth table
+         * holds 2^limit results. Existing truth tables are discarded.
+         * @param limit number of inputs, 0 disables truth tables, larger
+         * values than io::component::TRUTH_TABLE_MAX are clamped to it
+         */
+        void set_truth_table_limit(size_t limit);
+
+        /**
+         * Returns whether the component is evaluated from a truth table.
+         * Truth tables are only built after the first run of a component.
+         * @param name of the component
+         */
+        bool has_truth_table(const std::string& name);
+
+        /**
+         * Returns a counter that is incremented whenever a loaded component
+         * is replaced by io::component::fetch or io::scene::save.
+         */
+        uint32_t revision(void);
+
+        /** A component file in the library, as recorded by the index. */
+        struct Entry {
+            /** Dependency string, see Scene::to_dependency. */
+            std::string dependency;
+            std::string name;
+            std::string author;
+            int version     = 0;
+            sockid input_s  = 0;
+            sockid output_s = 0;
+            /** Components it uses, in the order of the file. */
+            std::vector<std::string> dependencies;
+            std::string path;
+            /** FNV-1a hash of the file. */
+            uint64_t hash = 0;
+            /** Modification time and size the entry was read at. */
+            int64_t mtime = 0;
+            uint64_t size = 0;
+        };
+
+        /**
+         * Updates the index of the components in LIBRARY and LOCAL, which is
+         * kept in CACHE between runs. Only the files that were added or
+         * modified since the last update are read.
+         * @returns number of indexed components
+         */
+        size_t update_index(void);
+
+        /**
+         * Returns the indexed components without reading the component
+         * files, see io::component::update_index.
+         */
+        std::vector<Entry> list(void);
     } // namespace component
+
+    /***************************************************************************
+                                        Binary
+    ***************************************************************************/
+
+    /**
+     * A compact binary encoding of the scene documents. All values are stored
+     * in little-endian byte order:
+     *
+     *  > Header - MAGIC, format version, flags, metadata and item counts
+     *  > String table - NUL-terminated strings, referenced by their offset
+     *  > Dependencies - string offsets
+     *  > Gates, inputs, outputs, components and relations - packed records
+     *  > Positions - x and y of each node in the order above, only present
+     *  with Flags::HAS_POSITIONS
+     *
+     * Every section starts at a multiple of 4 bytes. The records are parsed
+     * directly from the file, so loading doesn't build a JSON document.
+     */
+    namespace binary {
+        constexpr char MAGIC[4]           = { 'L', 'C', 'S', 'B' };
+        constexpr uint16_t FORMAT_VERSION = 1;
+        constexpr const char* SUFFIX      = ".lcsb";
+
+        enum Flags : uint16_t {
+            /** The scene is a component, see Scene::component_context. */
+            IS_COMPONENT = 1 << 0,
+            /** The positions section is present. */
+            HAS_POSITIONS = 1 << 1,
+        };
+
+        /** Returns whether data starts with a binary scene header. */
+        bool is_binary(const unsigned char* data, size_t size);
+
+        /**
+         * Encodes a scene document, as written by Scene::to_json.
+         * @param doc to encode
+         * @param data to write to
+         * @returns Error on failure:
+         *
+         * - Error::INVALID_SCENE
+         * - Error::INVALID_NODE
+         * - Error::INVALID_GATE
+         * - Error::INVALID_INPUT
+         * - Error::INVALID_COMPONENT
+         */
+        LCS_ERROR from_json(
+            const Json::Value& doc, std::vector<unsigned char>& data);
+
+        /**
+         * Decodes a binary scene into the same document Scene::to_json
+         * writes, so documents convert without losing information.
+         * @param data to decode
+         * @param size of the data
+         * @param doc to write to
+         * @returns Error on failure:
+         *
+         * - Error::INVALID_BINARY_FORMAT
+         */
+        LCS_ERROR to_json(
+            const unsigned char* data, size_t size, Json::Value& doc);
+
+        /**
+         * Loads a binary scene without building a document. Equivalent to
+         * decoding it with io::binary::to_json and calling Scene::from_json.
+         * @param data to load
+         * @param size of the data
+         * @param scene to update
+         * @returns Error on failure:
+         *
+         * - Error::INVALID_BINARY_FORMAT
+         * - Serializable::from_json
+         */
+        LCS_ERROR load(const unsigned char* data, size_t size, Scene& scene);
+
+        /**
+         * Converts a scene file between JSON and the binary format. The
+         * format is chosen by the suffix of the target, io::binary::SUFFIX
+         * for binary files.
+         * @param from path of the source file
+         * @param to path to write
+         * @returns Error on failure:
+         *
+         * - Error::NOT_FOUND
+         * - Error::INVALID_JSON_FORMAT
+         * - Error::WRITE_FAILED
+         * - io::binary::from_json
+         * - io::binary::to_json
+         */
+        LCS_ERROR convert(const std::string& from, const std::string& to);
+
+        /** Returns whether the path has io::binary::SUFFIX. */
+        bool is_binary_path(const std::string& path);
+    } // namespace binary
+
+    /***************************************************************************
+                                        Waveform
+    ***************************************************************************/
+
+    /**
+     * Records the value changes of the selected relations of a scene to a
+     * Value Change Dump (VCD) file. The simulation pushes the changes to a
+     * lock-free ring buffer, which is written to the file by a background
+     * thread.
+     *
+     * NOTE: The scene must not be moved or destroyed while recording.
+     */
+    class Waveform {
+    public:
+        /** Number of changes the ring buffer can hold. */
+        static constexpr size_t RING_SIZE = 1 << 16;
+
+        Waveform();
+        Waveform(const Waveform&)            = delete;
+        Waveform(Waveform&&)                 = delete;
+        Waveform& operator=(const Waveform&) = delete;
+        Waveform& operator=(Waveform&&)      = delete;
+        ~Waveform();
+
+        /**
+         * Adds a relation to the recorded signals. Signals have to be added
+         * before Waveform::open.
+         * @param id of the relation
+         * @param name of the signal
+         */
+        void watch(relid id, const std::string& name);
+
+        /**
+         * Writes the header and the current values of the signals, then
+         * starts recording the changes of the scene.
+         * @param path to write
+         * @param scene to record
+         * @param timescale unit of Waveform::set_time
+         * @returns Error on failure:
+         *
+         * - Error::WRITE_FAILED
+         */
+        LCS_ERROR open(const std::string& path, Scene& scene,
+            const char* timescale = "1 ns");
+
+        /**
+         * Stops recording. Waits until the remaining changes are written and
+         * closes the file.
+         */
+        void close(void);
+
+        inline bool is_open(void) const { return _file != nullptr; }
+
+        /**
+         * Sets the time of the following changes. Time has to be increasing.
+         * The Scheduler of the recorded scene sets its simulation time.
+         * @param time in the unit of the timescale
+         */
+        inline void set_time(uint64_t time) { _time = time; }
+        inline uint64_t time(void) const { return _time; }
+
+        /**
+         * Pushes a value change to the ring buffer if the relation is
+         * watched. Called by the scene for each relation that changes its
+         * value. Waits for the writer if the ring buffer is full.
+         * @param id of the relation
+         * @param value new value
+         */
+        inline void record(relid id, State value)
+        {
+            if (id < _codes.size() && _codes[id] != 0) {
+                _push(_codes[id], value);
+            }
+        }
+
+    private:
+        struct Change {
+            uint64_t time;
+            uint32_t code;
+            State value;
+        };
+
+        void _push(uint32_t code, State value);
+        /** Body of the writer thread. */
+        void _write(void);
+
+        Scene* _scene;
+        FILE* _file;
+        std::thread _writer;
+        std::atomic<bool> _is_running;
+        uint64_t _time;
+        /** Time of the last change in the file, only used by the writer. */
+        uint64_t _last_time;
+
+        /** Signal of each relation, 0 if it is not watched. */
+        std::vector<uint32_t> _codes;
+        std::vector<relid> _rels;
+        std::vector<std::string> _names;
+
+        std::vector<Change> _ring;
+        /** Next change to push, only written by the simulation. */
+        std::atomic<size_t> _head;
+        /** Next change to write, only written by the writer. */
+        std::atomic<size_t> _tail;
+    };
 } // namespace io
 } // namespace lcs
@@ -107,5 +107,11 @@ inline bool is_logged_in(void) { return get_flow().get_state() == Flow::DONE; }
  */
 void open_browser(const std::string& url);
 
-LCS_ERROR upload_scene(NRef<const Scene> scene, std::string resp);
+/**
+ * Uploads a scene to the server. Blocks until the server responds.
+ * @param text JSON document of the scene, see io::to_text
+ * @param resp response of the server
+ * @returns net::post_request
+ */
+LCS_ERROR upload_scene(const std::string& text, std::string& resp);
 } // namespace lcs::net
@@ -11,6 +11,7 @@
  ******************************************************************************/
 
 #include "core.h"
+#include "io.h"
 #include "ui/configuration.h"
 #include "ui/util.h"
 #include <imgui.h>
@@ -24,7 +25,9 @@ State ToggleButton(State, bool clickable = false);
 void NodeTypeTitle(Node n);
 void NodeTypeTitle(Node n, sockid sock);
 
-template <typename T> void NodeView(NRef<T> base_node, bool has_changes);
+template <typename T>
+void NodeView(NRef<T> base_node, NRef<const io::scene::Snapshot> snapshot,
+    bool has_changes);
 
 template <int SIZE, typename... Args>
 bool IconButton(const char* icon, Args... args)
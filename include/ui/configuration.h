@@ -91,6 +91,8 @@ public:
     int startup_win_x          = 1980;
     int startup_win_y          = 1080;
     bool start_fullscreen      = true;
+    /** Simulation threads, 0 to use all hardware threads. */
+    int sim_threads = 0;
 
     /* Serializable Interface */
     Json::Value to_json() const override;
@@ -11,7 +11,9 @@
  ******************************************************************************/
 
 namespace lcs::ui {
-bool save_as_flow(const char* title);
+bool save_as_flow(const char* title, bool is_async = false);
+/** Shows a notification for each save that finished in the background. */
+void save_result_flow(void);
 void close_flow(void);
 void open_flow(void);
 
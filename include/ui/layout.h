@@ -11,17 +11,18 @@
  ******************************************************************************/
 
 #include "core.h"
+#include "io.h"
 #include <imgui.h>
 
 namespace lcs::ui {
 
 void MenuBar(void);
 void Palette(NRef<Scene>);
-void Inspector(NRef<Scene>);
-void NodeEditor(NRef<Scene> scene);
+void Inspector(NRef<Scene>, NRef<const io::scene::Snapshot>);
+void NodeEditor(NRef<Scene> scene, NRef<const io::scene::Snapshot> snapshot);
 int _input_text_callback(ImGuiInputTextCallbackData*);
 void Profile(const std::string& name);
-void SceneInfo(NRef<Scene>);
+void SceneInfo(NRef<Scene>, NRef<const io::scene::Snapshot>);
 void Console(void);
 
 void RenderNotifications(void);
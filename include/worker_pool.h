@@ -0,0 +1,69 @@
+#pragma once
+/*******************************************************************************
+ * \file
+ * File: worker_pool.h
+ * Created: 10/17/26
+ * Description: Thread pool shared by the netlist and the component loader.
+ *
+ * Project: umutsevdi/logic-circuit-simulator-2
+ * License: GNU GENERAL PUBLIC LICENSE
+ ******************************************************************************/
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lcs {
+
+/**
+ * Threads that run a number of tasks, such as the chunks of a netlist level.
+ * Tasks are handed out through a shared counter, so threads that finish early
+ * take over the remaining tasks instead of waiting for a fixed share. The
+ * calling thread works on the tasks as well.
+ */
+class WorkerPool {
+public:
+    WorkerPool()                             = default;
+    WorkerPool(const WorkerPool&)            = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    ~WorkerPool();
+
+    inline size_t size(void) const { return _workers.size() + 1; }
+
+    /**
+     * Stops the running threads and starts thread_s - 1 new ones.
+     * @param thread_s number of threads, including the calling thread
+     */
+    void resize(size_t thread_s);
+
+    /**
+     * Runs fn(task) for each task in [0, task_s) and waits for all of them.
+     * Runs on the calling thread only if the pool is already in use.
+     * @param task_s number of tasks
+     * @param fn to run for each task
+     */
+    void run(size_t task_s, const std::function<void(size_t)>& fn);
+
+private:
+    void _drain(void);
+    void _work(void);
+
+    std::vector<std::thread> _workers;
+    /* Held while tasks are running or the pool is resized. */
+    std::mutex _run_lock;
+    std::mutex _lock;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    const std::function<void(size_t)>* _fn = nullptr;
+    size_t _task_s                         = 0;
+    std::atomic<size_t> _next              = 0;
+    size_t _active                         = 0;
+    uint64_t _generation                   = 0;
+    bool _is_stopping                      = false;
+};
+
+} // namespace lcs
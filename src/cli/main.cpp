@@ -0,0 +1,279 @@
+/*******************************************************************************
+ * \file
+ * File: src/cli/main.cpp
+ * Description: lcs-sim, runs a scene without the user interface.
+ *
+ * Each line of the input vectors assigns a value to every input of the scene
+ * that is not a clock, in the order of their ids. Characters other than 0 and
+ * 1 are ignored, empty lines keep the previous values and lines starting with
+ * '#' are comments. After each vector the clocks run for the given number of
+ * ticks, where a tick advances the simulation time to the next toggle of a
+ * clock, and the values of the outputs are printed as a line of 0, 1 and x for
+ * disabled outputs.
+ *
+ * Project: umutsevdi/logic-circuit-simulator-2.git
+ * License: GNU GENERAL PUBLIC LICENSE
+ ******************************************************************************/
+
+#include "common.h"
+#include "core.h"
+#include "io.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace lcs;
+
+static const char* _usage
+    = "Usage: lcs-sim [options] <scene>\n"
+      "\n"
+      "Options:\n"
+      "  -L, --library <dir>  Resolve dependencies from <dir>/lib and\n"
+      "                       <dir>/local instead of the user library.\n"
+      "  -i, --inputs <file>  Read input vectors from a file, '-' for stdin.\n"
+      "                       Default: stdin\n"
+      "  -n, --ticks <N>      Clock toggles to run after each vector.\n"
+      "                       Default: 1\n"
+      "  -c, --compiled       Simulate on the compiled netlist.\n"
+      "  -f, --flatten        Inline components into the netlist, implies\n"
+      "                       --compiled.\n"
+      "  -j, --threads <N>    Threads that evaluate the netlist, 0 to use all\n"
+      "                       hardware threads. Default: 1\n"
+      "  -t, --trace          Print the outputs after every tick.\n"
+      "  -w, --vcd <file>     Record the inputs and the outputs to a VCD\n"
+      "                       file.\n"
+      "  -v, --verbose        Print log messages to stderr.\n"
+      "  -h, --help           Print this message.\n";
+
+struct Options {
+    std::string scene;
+    std::string library;
+    std::string inputs = "-";
+    std::string vcd;
+    size_t ticks       = 1;
+    size_t threads     = 1;
+    bool is_compiled   = false;
+    bool is_flat       = false;
+    bool is_trace      = false;
+    bool is_verbose    = false;
+};
+
+static bool _parse_count(const char* str, size_t& value)
+{
+    char* end = nullptr;
+    long long n = std::strtoll(str, &end, 10);
+    if (end == str || *end != '\0' || n < 0) {
+        return false;
+    }
+    value = static_cast<size_t>(n);
+    return true;
+}
+
+/* Returns 0 on success, the exit code otherwise. */
+static int _parse_args(int argc, char* argv[], Options& opt)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value  = i + 1 < argc;
+        if (arg == "-h" || arg == "--help") {
+            std::printf("%s", _usage);
+            return -1;
+        } else if ((arg == "-L" || arg == "--library") && has_value) {
+            opt.library = argv[++i];
+        } else if ((arg == "-i" || arg == "--inputs") && has_value) {
+            opt.inputs = argv[++i];
+        } else if ((arg == "-n" || arg == "--ticks") && has_value) {
+            if (!_parse_count(argv[++i], opt.ticks)) {
+                std::fprintf(stderr, "Invalid tick count: %s\n", argv[i]);
+                return 2;
+            }
+        } else if ((arg == "-j" || arg == "--threads") && has_value) {
+            if (!_parse_count(argv[++i], opt.threads)) {
+                std::fprintf(stderr, "Invalid thread count: %s\n", argv[i]);
+                return 2;
+            }
+        } else if ((arg == "-w" || arg == "--vcd") && has_value) {
+            opt.vcd = argv[++i];
+        } else if (arg == "-c" || arg == "--compiled") {
+            opt.is_compiled = true;
+        } else if (arg == "-f" || arg == "--flatten") {
+            opt.is_compiled = true;
+            opt.is_flat     = true;
+        } else if (arg == "-t" || arg == "--trace") {
+            opt.is_trace = true;
+        } else if (arg == "-v" || arg == "--verbose") {
+            opt.is_verbose = true;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::fprintf(stderr, "Invalid option: %s\n%s", arg.c_str(), _usage);
+            return 2;
+        } else if (opt.scene.empty()) {
+            opt.scene = arg;
+        } else {
+            std::fprintf(stderr, "Unexpected argument: %s\n", arg.c_str());
+            return 2;
+        }
+    }
+    if (opt.scene.empty()) {
+        std::fprintf(stderr, "%s", _usage);
+        return 2;
+    }
+    return 0;
+}
+
+/* Nodes of the given type sorted by their ids, since the node storage does
+ * not keep them in order. */
+template <typename T>
+static std::vector<Node> _sorted_nodes(
+    SlotMap<T>& map, std::function<bool(T&)> filter)
+{
+    std::vector<Node> nodes;
+    for (auto& node : map) {
+        if (filter(node.second)) {
+            nodes.push_back(node.first);
+        }
+    }
+    std::sort(nodes.begin(), nodes.end(),
+        [](Node a, Node b) { return a.id < b.id; });
+    return nodes;
+}
+
+static void _print_outputs(Scene& s, const std::vector<Node>& outputs)
+{
+    std::string line(outputs.size(), 'x');
+    for (size_t i = 0; i < outputs.size(); i++) {
+        State value = s.get_node<OutputNode>(outputs[i])->get();
+        if (value != State::DISABLED) {
+            line[i] = value == State::TRUE ? '1' : '0';
+        }
+    }
+    std::fwrite(line.data(), 1, line.size(), stdout);
+    std::fputc('\n', stdout);
+}
+
+int main(int argc, char* argv[])
+{
+    Options opt;
+    if (int code = _parse_args(argc, argv, opt); code != 0) {
+        return code < 0 ? 0 : code;
+    }
+    l_set_stream(opt.is_verbose ? stderr : nullptr);
+    init_paths();
+    if (!opt.library.empty()) {
+        LIBRARY = std::filesystem::path { opt.library } / "lib";
+        LOCAL   = std::filesystem::path { opt.library } / "local";
+    }
+
+    size_t idx = 0;
+    if (Error err = io::scene::open(opt.scene, idx); err) {
+        std::fprintf(stderr, "Failed to open %s: %s\n", opt.scene.c_str(),
+            errmsg(err));
+        return 1;
+    }
+    NRef<Scene> s = io::scene::get(idx);
+    Netlist::set_thread_count(opt.threads);
+    if (opt.is_compiled) {
+        s->_netlist.set_flatten(opt.is_flat);
+        s->set_mode(SimulationMode::COMPILED);
+    }
+
+    std::vector<Node> inputs = _sorted_nodes<InputNode>(
+        s->_inputs, [](InputNode& n) { return !n.is_timer(); });
+    std::vector<Node> outputs = _sorted_nodes<OutputNode>(
+        s->_outputs, [](OutputNode&) { return true; });
+
+    std::ifstream file;
+    if (opt.inputs != "-") {
+        file.open(opt.inputs);
+        if (!file) {
+            std::fprintf(stderr, "Failed to open %s\n", opt.inputs.c_str());
+            return 1;
+        }
+    }
+    std::istream& in = opt.inputs != "-" ? file : std::cin;
+
+    io::Waveform waveform;
+    if (!opt.vcd.empty()) {
+        for (auto& node : s->_inputs) {
+            if (!node.second.output.empty()) {
+                waveform.watch(node.second.output[0],
+                    (node.second.is_timer() ? "clk" : "in")
+                        + std::to_string(node.first.id));
+            }
+        }
+        for (Node node : outputs) {
+            waveform.watch(s->get_node<OutputNode>(node)->input,
+                "out" + std::to_string(node.id));
+        }
+        if (Error err = waveform.open(opt.vcd, *s); err) {
+            std::fprintf(stderr, "Failed to open %s: %s\n", opt.vcd.c_str(),
+                errmsg(err));
+            return 1;
+        }
+    }
+
+    using clock = std::chrono::steady_clock;
+    clock::duration elapsed {};
+    uint64_t events = s->event_count();
+    size_t vector_s = 0;
+    size_t ticks    = 0;
+    size_t line_no  = 0;
+    std::string line;
+    std::vector<bool> vector;
+    while (std::getline(in, line)) {
+        line_no++;
+        if (!line.empty() && line[0] == '#') {
+            continue;
+        }
+        vector.clear();
+        for (char c : line) {
+            if (c == '0' || c == '1') {
+                vector.push_back(c == '1');
+            }
+        }
+        if (!vector.empty() && vector.size() != inputs.size()) {
+            std::fprintf(stderr, "%s:%zu: Expected %zu inputs, found %zu.\n",
+                opt.inputs.c_str(), line_no, inputs.size(), vector.size());
+            return 1;
+        }
+
+        auto begin = clock::now();
+        for (size_t i = 0; i < vector.size(); i++) {
+            NRef<InputNode> node = s->get_node<InputNode>(inputs[i]);
+            if ((node->get() == State::TRUE) != vector[i]) {
+                node->set(vector[i]);
+            }
+        }
+        for (size_t t = 0; t < opt.ticks && io::scene::step(idx); t++) {
+            ticks++;
+            if (opt.is_trace) {
+                elapsed += clock::now() - begin;
+                _print_outputs(*s, outputs);
+                begin = clock::now();
+            }
+        }
+        elapsed += clock::now() - begin;
+        vector_s++;
+        /* Keeps the log messages next to the outputs of their vector. */
+        l_flush();
+        if (!opt.is_trace) {
+            _print_outputs(*s, outputs);
+        }
+    }
+    std::fflush(stdout);
+    waveform.close();
+
+    events        = s->event_count() - events;
+    double second = std::chrono::duration<double>(elapsed).count();
+    std::fprintf(stderr,
+        "vectors: %zu, ticks: %zu, events: %llu, time: %.6f s\n"
+        "simulation time: %.6f s, ticks/s: %.0f, events/s: %.0f\n",
+        vector_s, ticks, static_cast<unsigned long long>(events), second,
+        s->_scheduler.now() / static_cast<double>(Scheduler::SECOND),
+        second > 0 ? ticks / second : 0.0, second > 0 ? events / second : 0.0);
+    return 0;
+}
@@ -4,6 +4,11 @@
 #include <filesystem>
 #include <fstream>
 #include <sstream>
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace fs = std::filesystem;
 
@@ -15,7 +20,6 @@ fs::path LOCAL;
 fs::path CACHE;
 fs::path MISC;
 std::string INI;
-std::ofstream __TEST_LOG__;
 
 static std::string current_path;
 bool is_testing = false;
@@ -49,7 +53,6 @@ void init_paths(bool _is_testing)
         ROOT = TMP / s_time.str();
         TMP  = TMP / s_time.str() / "tmp";
 
-        __TEST_LOG__ = std::ofstream { ROOT / "log.txt" };
         L_DEBUG("Creating testing environment at %s", ROOT.c_str());
     }
     LIBRARY = ROOT / "pkg" / "lib";
@@ -86,46 +89,86 @@ void init_paths(bool _is_testing)
             lcs::write(INI, _default_ini);
             L_DEBUG("Placing default layout");
         }
+        if (is_testing && !l_set_file(ROOT / "log.txt")) {
+            L_WARN("Failed to open the test log.");
+        }
         L_DEBUG(APPNAME_LONG " file system is ready.");
     } catch (const std::exception& e) {
         L_ERROR("Directory creation failed. %s ", e.what());
     }
 }
 
-bool write(const std::string& path, const std::string& data)
+/* Writes data to a temporary file next to path and renames it over path, so
+ * the file is never left partially written. */
+static bool _write(const std::string& path, const char* data, size_t size,
+    std::ios::openmode mode)
 {
     L_DEBUG("Save %s.", path.c_str());
     try {
-        fs::create_directories(std::string {
-            path.begin(), path.begin() + path.find_last_of("/") });
-        std::ofstream outfile { path };
-        if (outfile) {
-            outfile << data;
-            return true;
+        fs::path file_path { path };
+        if (file_path.has_parent_path()) {
+            fs::create_directories(file_path.parent_path());
+        }
+        fs::path tmp_path = file_path;
+        tmp_path += ".tmp";
+#ifndef _WIN32
+        (void)mode;
+        int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            L_ERROR("Failed to open file for writing %s.", path.c_str());
+            return false;
+        }
+        bool is_written = true;
+        for (size_t at = 0; is_written && at < size;) {
+            ssize_t count = ::write(fd, data + at, size - at);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            is_written = count > 0;
+            at += is_written ? count : 0;
         }
-        L_ERROR("Failed to open file for writing %s.", path.c_str());
+        /* The data must reach the disk before the rename does, otherwise a
+         * crash can leave an empty file in place of the previous one. */
+        is_written = is_written && ::fsync(fd) == 0;
+        is_written = ::close(fd) == 0 && is_written;
+        if (!is_written) {
+            L_ERROR("Failed to write %s.", path.c_str());
+            fs::remove(tmp_path);
+            return false;
+        }
+#else
+        {
+            std::ofstream outfile { tmp_path, mode };
+            if (!outfile) {
+                L_ERROR("Failed to open file for writing %s.", path.c_str());
+                return false;
+            }
+            outfile.write(data, size);
+            outfile.close();
+            if (!outfile) {
+                L_ERROR("Failed to write %s.", path.c_str());
+                fs::remove(tmp_path);
+                return false;
+            }
+        }
+#endif
+        fs::rename(tmp_path, file_path);
+        return true;
     } catch (const std::exception& e) {
         L_ERROR("Exception occurred while writing %s.", e.what());
     }
     return false;
 }
 
+bool write(const std::string& path, const std::string& data)
+{
+    return _write(path, data.data(), data.size(), std::ios::out);
+}
+
 bool write(const std::string& path, std::vector<unsigned char>& data)
 {
-    L_DEBUG("Save %s.", path.c_str());
-    try {
-        fs::create_directories(std::string {
-            path.begin(), path.begin() + path.find_last_of("/") });
-        std::ofstream outfile { path, std::ios::binary };
-        if (outfile) {
-            outfile.write((char*)data.data(), data.size());
-            return true;
-        }
-        L_ERROR("Failed to open file for writing %s.", path.c_str());
-    } catch (const std::exception& e) {
-        L_ERROR("Exception occurred while writing %s.", e.what());
-    }
-    return false;
+    return _write(path, reinterpret_cast<const char*>(data.data()),
+        data.size(), std::ios::out | std::ios::binary);
 }
 
 std::string read(const std::string& path)
@@ -1,8 +1,13 @@
 #include "common.h"
 #include "tinyfiledialogs.h"
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstring>
 #include <iostream>
+#include <mutex>
+#include <thread>
 
 namespace lcs {
 #define F_BOLD "\033[1m"
@@ -12,19 +17,67 @@ namespace lcs {
 #define F_BLUE "\033[34m"
 #define F_RESET "\033[0m"
 
+/* Guards the line buffer, the pending lines and the trace reader. */
+static std::mutex _lock;
 constexpr int LINE_SIZE = 200;
 static std::array<Line, LINE_SIZE> _buffer {};
 // next item slot to write
 static size_t _next = 0;
 static size_t _size = 0;
 
+/* Lines that are waiting to be written to the sinks. The logging thread
+ * writes them in batches, when the queue is half full or every
+ * SINK_INTERVAL. When the queue is full debug lines are counted and dropped,
+ * other lines wait until the queue is written. */
+constexpr size_t PENDING_SIZE = 1024;
+constexpr auto SINK_INTERVAL  = std::chrono::milliseconds(50);
+static std::array<Line, PENDING_SIZE> _pending {};
+static size_t _pending_head    = 0;
+static size_t _pending_size    = 0;
+static size_t _pending_dropped = 0;
+static std::condition_variable _ready;
+static bool _is_stopped = false;
+
+/* Guards the sinks. Always locked before _lock. */
+static std::mutex _sink_lock;
+static std::vector<Line> _batch {};
+static FILE* _stream = stdout;
+static FILE* _file   = nullptr;
+
+/* Trace messages are kept in a bounded multi-producer queue. Each slot has a
+ * sequence number that tells whether it is free for the producer at that
+ * position or holds a message for the reader at that position, so producers
+ * only contend on _trace_head. */
+constexpr size_t TRACE_SIZE = 4096;
+struct TraceSlot {
+    std::atomic<size_t> seq;
+    Trace trace;
+};
+static struct TraceRing {
+    TraceRing()
+    {
+        for (size_t i = 0; i < TRACE_SIZE; i++) {
+            slots[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+    std::array<TraceSlot, TRACE_SIZE> slots;
+} _traces;
+static std::atomic<size_t> _trace_head { 0 };
+static size_t _trace_tail = 0;
+static std::atomic<size_t> _trace_dropped { 0 };
+
 static const auto app_start_time = std::chrono::steady_clock::now();
-void Line::_set_time(void)
+static uint64_t _elapsed(void)
 {
     using namespace std::chrono;
-    uint64_t total
-        = duration_cast<milliseconds>(steady_clock::now() - app_start_time)
-              .count();
+    return duration_cast<milliseconds>(steady_clock::now() - app_start_time)
+        .count();
+}
+
+void Line::_set_time(void) { _set_time(_elapsed()); }
+
+void Line::_set_time(uint64_t total)
+{
     uint32_t hour = static_cast<uint32_t>(total / 3'600'000ULL); // 60*60*1000
     uint32_t min  = static_cast<uint32_t>((total % 3'600'000ULL) / 60'000ULL);
     uint32_t sec  = static_cast<uint32_t>((total % 60'000ULL) / 1'000ULL);
@@ -38,8 +91,158 @@ void Line::_set_time(void)
     }
 }
 
+void Line::_set_source(
+    LogLevel l, const char* file, int line, const char* _fn, Node object)
+{
+    severity = l;
+    std::strncpy(
+        log_level_str.data(), LogLevel_str(l), log_level_str.max_size() - 1);
+    std::snprintf(
+        file_line.data(), file_line.max_size() - 1, "%s:%3d", file, line);
+    _fn_parse(_fn);
+    if (object.id != 0 || object.type != 0) {
+        std::strncpy(obj.data(), object.to_str().c_str(), obj.max_size() - 1);
+        node = object;
+    }
+}
+
+Line::Line(const Trace& trace)
+{
+    _set_time(trace.time);
+    _set_source(trace.point->severity, trace.point->file, trace.point->line,
+        trace.point->fn, trace.node);
+    trace.format(expr.data(), expr.max_size() - 1, trace.fmt, trace.args);
+}
+
+void _t_push(const Trace& trace)
+{
+    size_t pos = _trace_head.load(std::memory_order_relaxed);
+    TraceSlot* slot;
+    while (true) {
+        slot       = &_traces.slots[pos % TRACE_SIZE];
+        size_t seq = slot->seq.load(std::memory_order_acquire);
+        if (seq == pos) {
+            if (_trace_head.compare_exchange_weak(
+                    pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (seq < pos) {
+            /* The reader hasn't caught up. */
+            _trace_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = _trace_head.load(std::memory_order_relaxed);
+        }
+    }
+    slot->trace      = trace;
+    slot->trace.time = _elapsed();
+    slot->seq.store(pos + 1, std::memory_order_release);
+}
+
+static void _push(Line&& line);
+
+/* Formats the trace messages that were recorded since the last call. Requires
+ * _lock. */
+static void _drain(void)
+{
+    while (true) {
+        TraceSlot& slot = _traces.slots[_trace_tail % TRACE_SIZE];
+        if (slot.seq.load(std::memory_order_acquire) != _trace_tail + 1) {
+            break;
+        }
+        Line line { slot.trace };
+        slot.seq.store(_trace_tail + TRACE_SIZE, std::memory_order_release);
+        _trace_tail++;
+        _push(std::move(line));
+    }
+    if (size_t dropped = _trace_dropped.exchange(0); dropped != 0) {
+        _push(Line { LogLevel::WARN, __FILE_NAME__, __LINE__,
+            __PRETTY_FUNCTION__, 0, "Dropped %zu trace messages.", dropped });
+    }
+}
+
+static void _write(const Line& l);
+
+/* Writes the pending lines to the sinks. The sinks are locked before the
+ * batch is taken, so the batches are written in the order they were taken. */
+static void _write_pending(void)
+{
+    std::lock_guard<std::mutex> sink_lock { _sink_lock };
+    size_t dropped = 0;
+    {
+        std::lock_guard<std::mutex> lock { _lock };
+        _batch.clear();
+        for (; _pending_size > 0; _pending_size--) {
+            _batch.push_back(std::move(_pending[_pending_head]));
+            _pending_head = (_pending_head + 1) % PENDING_SIZE;
+        }
+        dropped = std::exchange(_pending_dropped, 0);
+    }
+    if (dropped != 0) {
+        _batch.push_back(Line { LogLevel::WARN, __FILE_NAME__, __LINE__,
+            __PRETTY_FUNCTION__, 0, "Dropped %zu log lines.", dropped });
+    }
+    if (_batch.empty()) {
+        return;
+    }
+    for (const Line& l : _batch) {
+        _write(l);
+    }
+    if (_stream != nullptr) {
+        std::fflush(_stream);
+    }
+    if (_file != nullptr) {
+        std::fflush(_file);
+    }
+}
+
+static void _sink_loop(void)
+{
+    std::unique_lock<std::mutex> lock { _lock };
+    while (!_is_stopped) {
+        _ready.wait_for(lock, SINK_INTERVAL);
+        _drain();
+        lock.unlock();
+        _write_pending();
+        lock.lock();
+    }
+}
+
+/* Started by the first message. Once it is stopped at exit, messages are
+ * written by the thread that pushes them. */
+struct SinkThread {
+    SinkThread()
+        : thread { _sink_loop }
+    {
+    }
+    ~SinkThread()
+    {
+        {
+            std::lock_guard<std::mutex> lock { _lock };
+            _is_stopped = true;
+        }
+        _ready.notify_one();
+        thread.join();
+        _write_pending();
+    }
+    std::thread thread;
+};
+
+static void _start(void) { static SinkThread _sink {}; }
+
+void l_flush(void)
+{
+    {
+        std::lock_guard<std::mutex> lock { _lock };
+        _drain();
+    }
+    _write_pending();
+}
+
 void l_iterate(std::function<void(size_t, const Line& l)> fn)
 {
+    std::lock_guard<std::mutex> lock { _lock };
+    _drain();
     if (_size < LINE_SIZE) {
         for (size_t i = 0; i < _size; i++) {
             fn(i, _buffer[i]);
@@ -74,19 +277,20 @@ void Line::_fn_parse(std::string fnname)
     }
 }
 
-inline static void _log_pre(const Line& l)
+static void _write(const Line& l)
 {
-    std::ostringstream oss2 {};
-    printf(F_BLUE "[%s] " F_BOLD "%s%-6s" F_RESET F_GREEN "|" F_RESET
-                  "%-15s" F_GREEN " |%-18s|" F_RESET F_BLUE
-                  "%-25s" F_RESET F_GREEN "|" F_RESET "%s\r\n",
-        l.time_str.begin(), (l.severity == ERROR ? F_RED : F_GREEN),
-        l.log_level_str.begin(), l.file_line.begin(), l.obj.begin(),
-        l.fn.begin(), l.expr.begin());
-    if (is_testing) {
-        __TEST_LOG__ << l.log_level_str.begin() << '\t' << l.file_line.begin()
-                     << '\t' << l.obj.begin() << "\t" << l.fn.begin() << '\t'
-                     << l.expr.begin() << std::endl;
+    if (_stream != nullptr) {
+        std::fprintf(_stream,
+            F_BLUE "[%s] " F_BOLD "%s%-6s" F_RESET F_GREEN "|" F_RESET
+                   "%-15s" F_GREEN " |%-18s|" F_RESET F_BLUE
+                   "%-25s" F_RESET F_GREEN "|" F_RESET "%s\r\n",
+            l.time_str.begin(), (l.severity == ERROR ? F_RED : F_GREEN),
+            l.log_level_str.begin(), l.file_line.begin(), l.obj.begin(),
+            l.fn.begin(), l.expr.begin());
+    }
+    if (_file != nullptr) {
+        std::fprintf(_file, "%s\t%s\t%s\t%s\t%s\n", l.log_level_str.begin(),
+            l.file_line.begin(), l.obj.begin(), l.fn.begin(), l.expr.begin());
     }
 }
 
@@ -98,46 +302,106 @@ void l_push(Line&& line)
         return;
     }
 #endif
+    bool is_stopped = false;
+    bool is_full    = false;
+    {
+        std::unique_lock<std::mutex> lock { _lock };
+        /* Keeps the messages in the order they were recorded. */
+        _drain();
+        if (_pending_size == PENDING_SIZE && line.severity != DEBUG) {
+            lock.unlock();
+            _write_pending();
+            lock.lock();
+        }
+        _push(std::move(line));
+        is_stopped = _is_stopped;
+        is_full    = _pending_size >= PENDING_SIZE / 2;
+    }
+    if (is_stopped) {
+        _write_pending();
+        return;
+    }
+    _start();
+    if (is_full) {
+        _ready.notify_one();
+    }
+}
 
+static void _push(Line&& line)
+{
+    if (_pending_size < PENDING_SIZE) {
+        _pending[(_pending_head + _pending_size) % PENDING_SIZE] = line;
+        _pending_size++;
+    } else {
+        _pending_dropped++;
+    }
     if (_size < LINE_SIZE) {
         _buffer[_next] = std::move(line);
-        _log_pre(_buffer[_next]);
         _next++;
         _size++;
     } else {
         _next          = (_next + 1) % _size;
         _buffer[_next] = std::move(line);
-        _log_pre(_buffer[_next]);
     }
 }
 
 void l_clear(void)
 {
+    std::lock_guard<std::mutex> lock { _lock };
+    _drain();
     _next = 0;
     _size = 0;
 }
 
+void l_set_stream(FILE* stream)
+{
+    std::lock_guard<std::mutex> lock { _sink_lock };
+    _stream = stream;
+}
+
+bool l_set_file(const std::filesystem::path& path)
+{
+    std::lock_guard<std::mutex> lock { _sink_lock };
+    if (_file != nullptr) {
+        std::fclose(_file);
+        _file = nullptr;
+    }
+    if (path.empty()) {
+        return true;
+    }
+    _file = std::fopen(path.c_str(), "a");
+    return _file != nullptr;
+}
+
 int __expect(std::function<bool(void)> expr, const char* function,
     const char* file, int line, const char* str_expr) noexcept
 {
     static const char* _title = "Logic Circuit Simulator";
-    std::stringstream s {};
-    s << "ERROR " << file << " : " << line << "\t" << function
-      << "(...) Assertion " << str_expr << " failed!" << std::endl;
+    std::string message {};
+    int button = 0;
     try {
         if (expr()) {
             return 0;
         }
-        tinyfd_messageBox(_title, s.str().c_str(), "ok", "error", 1);
-
+        /* The message is only built on failure, so assertions stay free of
+         * allocations. */
+        std::stringstream s {};
+        s << "ERROR " << file << " : " << line << "\t" << function
+          << "(...) Assertion " << str_expr << " failed!" << std::endl;
+        message = s.str();
+        button  = 1;
     } catch (const std::exception& ex) {
-        tinyfd_messageBox(_title, ex.what(), "ok", "error", 0);
+        message = ex.what();
     } catch (const std::string& ex) {
-        tinyfd_messageBox(_title, ex.c_str(), "ok", "error", 0);
+        message = ex;
     }
 
+    /* The application exits after a failed assertion, so the pending
+     * messages are written before the dialog blocks. */
     l_push(Line { LogLevel::ERROR, file, line, function, 0,
         "Assertion %s failed!", str_expr });
+    l_flush();
+    tinyfd_messageBox(_title, message.c_str(), "ok", "error", button);
     return 1;
 }
 
@@ -0,0 +1,78 @@
+#include "worker_pool.h"
+
+namespace lcs {
+
+WorkerPool::~WorkerPool() { resize(1); }
+
+void WorkerPool::resize(size_t thread_s)
+{
+    std::lock_guard<std::mutex> run { _run_lock };
+    {
+        std::lock_guard<std::mutex> lock { _lock };
+        _is_stopping = true;
+    }
+    _wake.notify_all();
+    for (auto& w : _workers) {
+        w.join();
+    }
+    _workers.clear();
+    _is_stopping = false;
+    for (size_t i = 1; i < thread_s; i++) {
+        _workers.emplace_back([this]() { _work(); });
+    }
+}
+
+void WorkerPool::run(size_t task_s, const std::function<void(size_t)>& fn)
+{
+    std::unique_lock<std::mutex> run { _run_lock, std::try_to_lock };
+    if (!run.owns_lock() || _workers.empty()) {
+        for (size_t t = 0; t < task_s; t++) {
+            fn(t);
+        }
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock { _lock };
+        _fn     = &fn;
+        _task_s = task_s;
+        _next   = 0;
+        _active = _workers.size();
+        _generation++;
+    }
+    _wake.notify_all();
+    _drain();
+    std::unique_lock<std::mutex> lock { _lock };
+    _done.wait(lock, [this]() { return _active == 0; });
+    _fn = nullptr;
+}
+
+void WorkerPool::_drain(void)
+{
+    for (size_t t = _next++; t < _task_s; t = _next++) {
+        (*_fn)(t);
+    }
+}
+
+void WorkerPool::_work(void)
+{
+    uint64_t generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock { _lock };
+            _wake.wait(lock, [&]() {
+                return _is_stopping || _generation != generation;
+            });
+            if (_is_stopping) {
+                return;
+            }
+            generation = _generation;
+        }
+        _drain();
+        std::lock_guard<std::mutex> lock { _lock };
+        if (--_active == 0) {
+            _done.notify_one();
+        }
+    }
+}
+
+} // namespace lcs
@@ -45,6 +45,7 @@ void ComponentContext::setup(sockid input_s, sockid output_s)
     }
     _execution_input  = 0;
     _execution_output = 0;
+    _parent->invalidate();
 }
 
 Node ComponentContext::get_input(sockid id) const
@@ -82,7 +83,7 @@ State ComponentContext::get_value(Node id) const
 
 void ComponentContext::set_value(Node id, State value)
 {
-    L_INFO("%s:%d, %s\n", NodeType_to_str(id.type), id.id, State_to_str(value));
+    T_INFO("%s:%d, %s", NodeType_to_str(id.type), id.id, State_to_str(value));
     if (id.id > 0 && id.id < 64) {
         if (id.type == NodeType::COMPONENT_INPUT) {
             _execution_input[id.id - 1] = value == State::TRUE;
@@ -95,22 +96,30 @@ void ComponentContext::set_value(Node id, State value)
 
 uint64_t ComponentContext::run()
 {
-    L_INFO("Execute component: %b", _execution_input.to_ullong());
+    T_INFO("Execute component: %b", _execution_input.to_ullong());
     _execution_output = 0;
-    for (size_t i = 0; i < inputs.size(); i++) {
-        State result = _execution_input[i] ? State::TRUE : State::FALSE;
-        for (relid in : inputs[i]) {
-            _parent->signal(in, result);
+    if (_parent->mode() == SimulationMode::COMPILED) {
+        for (size_t i = 0; i < inputs.size(); i++) {
+            _parent->_netlist.set(get_input(i),
+                _execution_input[i] ? State::TRUE : State::FALSE);
+        }
+        _parent->_netlist.evaluate();
+    } else {
+        for (size_t i = 0; i < inputs.size(); i++) {
+            State result = _execution_input[i] ? State::TRUE : State::FALSE;
+            for (relid in : inputs[i]) {
+                _parent->signal(in, result);
+            }
         }
     }
 
     for (size_t i = 0; i < outputs.size(); i++) {
         if (outputs[i] != 0) {
             _execution_output.set(
-                i, _parent->get_rel(outputs[i])->value == State::TRUE);
+                i, _parent->get_value(outputs[i]) == State::TRUE);
         }
     }
-    L_INFO("Execute output: %b", _execution_output.to_ullong());
+    T_INFO("Execute output: %b", _execution_output.to_ullong());
     return _execution_output.to_ullong();
 }
 
@@ -120,9 +129,40 @@ uint64_t ComponentContext::run(uint64_t v)
     return run();
 }
 
+uint64_t ComponentContext::run(uint64_t v, InstanceState& state) const
+{
+    return _parent->_netlist.run(v, state);
+}
+
+void ComponentContext::run_batch(
+    const uint64_t* input, uint64_t* output, size_t n)
+{
+    T_INFO("Execute component batch: %zu", n);
+    std::vector<uint64_t> lane_in(inputs.size(), 0);
+    std::vector<uint64_t> lane_out(outputs.size(), 0);
+    for (size_t begin = 0; begin < n; begin += 64) {
+        size_t lane_s = std::min<size_t>(64, n - begin);
+        std::fill(lane_in.begin(), lane_in.end(), 0);
+        for (size_t lane = 0; lane < lane_s; lane++) {
+            for (size_t i = 0; i < inputs.size(); i++) {
+                lane_in[i] |= ((input[begin + lane] >> i) & 1) << lane;
+            }
+        }
+        _parent->_netlist.evaluate_lanes(lane_in.data(), lane_out.data());
+        for (size_t lane = 0; lane < lane_s; lane++) {
+            output[begin + lane] = 0;
+            for (size_t i = 0; i < outputs.size(); i++) {
+                output[begin + lane] |= ((lane_out[i] >> lane) & 1) << i;
+            }
+        }
+    }
+}
+
 ComponentNode::ComponentNode(Scene* _s, Node _id, const std::string& _path)
     : BaseNode { _s, Node { _id.id, NodeType::COMPONENT } }
+    , _is_disabled { true }
     , _output_value { 0 }
+    , _component { 0 }
 {
     if (_path != "") {
         set_component(_path);
@@ -148,6 +188,7 @@ Error ComponentNode::set_component(const std::string& _path)
     }
     inputs.clear();
     outputs.clear();
+    _parent->invalidate();
 
     for (size_t i = 0; i < ref->component_context->inputs.size(); i++) {
         inputs.push_back(0);
@@ -155,7 +196,9 @@ Error ComponentNode::set_component(const std::string& _path)
     for (size_t i = 0; i < ref->component_context->outputs.size(); i++) {
         outputs[i] = {};
     }
-    path = _path;
+    path       = _path;
+    _component = io::component::intern(_path);
+    _state     = {};
     return OK;
 }
 
@@ -180,16 +223,14 @@ void ComponentNode::on_signal()
         _is_disabled   = false;
         for (relid in : inputs) {
             if (in != 0) {
-                auto rel = _parent->get_rel(in);
-                lcs_assert(rel != nullptr);
                 input <<= 1;
-                if (rel->value == TRUE) {
+                if (_parent->get_value(in) == TRUE) {
                     input++;
                 }
             }
         }
         if (!_is_disabled) {
-            _output_value = io::component::run(path, input);
+            _output_value = io::component::run(_component, input, _state);
         }
     } else {
         _is_disabled = true;
@@ -1,5 +1,6 @@
 #include "common.h"
 #include "core.h"
+#include <algorithm>
 
 namespace lcs {
 
@@ -14,7 +15,7 @@ Rel::Rel(relid _id, Node _from_node, Node _to_node, sockid _from_sock,
     , to_node { _to_node }
     , from_sock { _from_sock }
     , to_sock { _to_sock }
-    , value { FALSE }
+    , is_oscillating { false }
 {
 }
 
@@ -22,7 +23,7 @@ Rel::Rel()
     : id { 0 }
     , from_sock { 0 }
     , to_sock { 0 }
-    , value { FALSE }
+    , is_oscillating { false }
 {
 }
 
@@ -32,24 +33,35 @@ Rel::Rel()
 
 InputNode::InputNode(Scene* _scene, Node id, std::optional<float> freq)
     : BaseNode { _scene, { id.id, NodeType::INPUT } }
-    , _freq { freq }
+    , _phase { 0 }
     , _value { false }
 {
-    if (_freq.has_value()) {
-        _parent->_timerlist.emplace(_id, 0);
+    set_clock(freq);
+}
+
+void InputNode::set_clock(std::optional<float> freq, float phase)
+{
+    if (freq.has_value() && freq.value() > 0) {
+        _freq  = std::min(freq.value(), Scheduler::MAX_FREQUENCY);
+        _phase = phase;
+        _parent->_scheduler.add(_id, _freq.value(), _phase);
+    } else {
+        _freq  = std::nullopt;
+        _phase = 0;
+        _parent->_scheduler.remove(_id);
     }
 }
 
 void InputNode::set(bool v)
 {
     _value = v;
-    on_signal();
+    _parent->evaluate(_id);
 }
 
 void InputNode::toggle()
 {
     _value = !_value;
-    on_signal();
+    _parent->evaluate(_id);
 }
 
 void InputNode::on_signal()
@@ -86,7 +98,7 @@ bool OutputNode::is_connected() const { return input != 0; }
 
 void OutputNode::on_signal()
 {
-    _value = input ? _parent->get_rel(input)->value : State::DISABLED;
+    _value = _parent->get_value(input);
     C_DEBUG("Received %s signal", State_to_str(_value));
 }
 
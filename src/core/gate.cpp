@@ -4,13 +4,6 @@
 #include "core.h"
 
 namespace lcs {
-static bool _and(const std::vector<bool>&);
-static bool _or(const std::vector<bool>&);
-static bool _xor(const std::vector<bool>&);
-static bool _nand(const std::vector<bool>&);
-static bool _nor(const std::vector<bool>&);
-static bool _xnor(const std::vector<bool>&);
-static bool _not(const std::vector<bool>&);
 
 GateNode::GateNode(Scene* _scene, Node id, GateType type, sockid _max_in)
     : BaseNode { _scene, { id.id, NodeType::GATE } }
@@ -29,9 +22,6 @@ GateNode::GateNode(Scene* _scene, Node id, GateType type, sockid _max_in)
     for (size_t i = 0; i < _max_in; i++) {
         inputs.push_back(0);
     }
-    static bool (*__functions[])(const std::vector<bool>&)
-        = { _not, _and, _or, _xor, _nand, _nor, _xnor, _not };
-    _apply = __functions[_type];
 }
 
 bool GateNode::is_connected() const
@@ -47,21 +37,18 @@ State GateNode::get(sockid) const
 
 void GateNode::on_signal()
 {
-    _value = State::DISABLED;
-    if (is_connected()) {
-        std::vector<bool> v {};
-        v.reserve(inputs.size());
-        _is_disabled = false;
-        for (relid in : inputs) {
-            auto rel = _parent->get_rel(in);
-            lcs_assert(rel != nullptr);
-            v.push_back(rel->value == TRUE ? TRUE : FALSE);
+    _value       = State::DISABLED;
+    _is_disabled = false;
+    size_t ones  = 0;
+    for (relid in : inputs) {
+        if (in == 0) {
+            _is_disabled = true;
+            break;
         }
-        if (!_is_disabled) {
-            _value = _apply(v) ? State::TRUE : State::FALSE;
-        }
-    } else {
-        _is_disabled = true;
+        ones += _parent->get_value(in) == TRUE;
+    }
+    if (!_is_disabled) {
+        _value = apply(_type, ones, inputs.size()) ? State::TRUE : State::FALSE;
     }
     for (relid& out : output) {
         C_DEBUG("Sending %s signal to rel@%d", State_to_str(get()), out);
@@ -77,6 +64,7 @@ bool GateNode::increment()
     _max_in++;
     inputs.reserve(_max_in);
     inputs.push_back(0);
+    _parent->invalidate();
     on_signal();
     return true;
 }
@@ -91,40 +79,9 @@ bool GateNode::decrement()
     }
     _max_in--;
     inputs.pop_back();
+    _parent->invalidate();
     on_signal();
     return true;
 }
 
-static bool _and(const std::vector<bool>& in)
-{
-    for (const auto& s : in) {
-        if (s == false) {
-            return false;
-        }
-    }
-    return true;
-}
-static bool _or(const std::vector<bool>& in)
-{
-    for (const auto& s : in) {
-        if (s == true) {
-            return true;
-        }
-    }
-    return false;
-}
-static bool _xor(const std::vector<bool>& in)
-{
-    bool result = false;
-    for (const auto& s : in) {
-        if (s == true) {
-            result = !result;
-        }
-    }
-    return result;
-}
-static bool _nand(const std::vector<bool>& in) { return !_and(in); }
-static bool _nor(const std::vector<bool>& in) { return !_or(in); }
-static bool _xnor(const std::vector<bool>& in) { return !_xor(in); }
-static bool _not(const std::vector<bool>& in) { return in[0] != true; }
 } // namespace lcs
@@ -1,16 +1,18 @@
 #include "core.h"
 #include "io.h"
 #include <json/json.h>
+#include <charconv>
 #include <cmath>
 
 namespace lcs {
 /** Reads a JSON document and writes its values to a map */
 template <typename T>
 Error static _json_to_map(
-    Scene* s, const Json::Value& doc, std::map<Node, T>& m, Node& last_node);
+    Scene* s, const Json::Value& doc, SlotMap<T>& m, Node& last_node);
 
 static NodeType _str_to_node(const std::string&);
 GateType _str_to_gate(const std::string&);
+static uint16_t _str_to_id(const std::string&);
 
 LCS_ERROR Point::from_json(const Json::Value& doc)
 {
@@ -82,13 +84,10 @@ LCS_ERROR ComponentNode::from_json(const Json::Value& doc)
 LCS_ERROR InputNode::from_json(const Json::Value& doc)
 {
     if (doc["freq"].isNumeric()) {
-        _freq = std::max(0.1f,
-            std::min(std::round(doc["freq"].asFloat() * 10) / 10.0f, 5.0f));
-        if (_freq <= 0) {
-            _freq = std::nullopt;
-        }
+        set_clock(doc["freq"].asFloat(),
+            doc["phase"].isNumeric() ? doc["phase"].asFloat() : 0);
     } else if (doc["data"].isBool()) {
-        set(doc["data"].asBool());
+        _value = doc["data"].asBool();
     } else {
         return ERROR(Error::INVALID_INPUT);
     }
@@ -134,14 +133,17 @@ LCS_ERROR Scene::from_json(const Json::Value& doc)
     version = doc["version"].asInt();
     if (doc["dependencies"].isArray()) {
         for (const auto& j : doc["dependencies"]) {
-            Error err = io::component::fetch(j.asString());
-            if (err) {
-                return err;
-            }
             dependencies.push_back(j.asString());
         }
+        Error err = io::component::fetch_all(dependencies);
+        if (err) {
+            return err;
+        }
     }
 
+    /* Relations are connected without propagating, the scene is settled
+     * once at the end. */
+    Batch batch { *this };
     Error err = OK;
     if (doc["component"].isObject()) {
         component_context = ComponentContext { this };
@@ -219,7 +221,7 @@ LCS_ERROR Scene::from_json(const Json::Value& doc)
 
 template <typename T>
 Error _json_to_map(
-    Scene* s, const Json::Value& doc, std::map<Node, T>& m, Node& last_node)
+    Scene* s, const Json::Value& doc, SlotMap<T>& m, Node& last_node)
 {
     Node last_id = 0;
     Error err    = OK;
@@ -227,8 +229,10 @@ Error _json_to_map(
     for (Json::Value::const_iterator iter = doc.begin(); iter != doc.end();
         iter++) {
         const Json::Value& value = *iter;
-        Node id { static_cast<uint16_t>(std::atoi(iter.key().asCString())),
-            as_node_type<T>() };
+        Node id { _str_to_id(iter.key().asString()), as_node_type<T>() };
+        if (id.id == 0) {
+            return ERROR(Error::INVALID_NODEID);
+        }
         if (id.id > last_id.id) {
             last_id = id;
         }
@@ -240,10 +244,13 @@ Error _json_to_map(
             return err;
         }
         if constexpr (std::is_same<T, GateNode>::value) {
-            if (!value["type"].isString()) {
+            GateType type = value["type"].isString()
+                ? _str_to_gate(value["type"].asString())
+                : GateType::GATE_S;
+            if (type == GateType::GATE_S) {
                 return ERROR(Error::INVALID_GATE);
             }
-            T t { s, id, _str_to_gate(value["type"].asString()) };
+            T t { s, id, type };
             err = t.from_json(value);
             if (err) {
                 return err;
@@ -260,11 +267,6 @@ Error _json_to_map(
             m.emplace(id, t);
         }
 
-        if constexpr (std::is_same<T, InputNode>::value) {
-            if (auto t = m.find(id); t != m.end() && t->second.is_timer()) {
-                s->_timerlist.emplace(id, 0);
-            }
-        }
     }
     last_node = last_id;
     return OK;
@@ -303,21 +305,29 @@ GateType _str_to_gate(const std::string& type)
         return NAND;
     } else if (type == "NOR") {
         return NOR;
-    } else {
+    } else if (type == "XNOR") {
         return XNOR;
     }
+    return GATE_S;
+}
+
+/* Parses a node id key, returns 0 when it is not a valid id. */
+static uint16_t _str_to_id(const std::string& key)
+{
+    const char* last    = key.data() + key.size();
+    unsigned long value = 0;
+    auto [end, ec]      = std::from_chars(key.data(), last, value);
+    if (ec != std::errc {} || end != last || value == 0
+        || value > UINT16_MAX) {
+        return 0;
+    }
+    return value;
 }
 
 namespace parse {
     Error load_scene(const std::string& str, Scene& scene)
     {
-        Json::Reader reader {};
-        Json::Value root;
-        bool ok = reader.parse(str, root);
-        if (!ok) {
-            return ERROR(Error::INVALID_JSON_FORMAT);
-        }
-        return scene.from_json(root);
+        return io::load_json(str.data(), str.size(), scene);
     }
 
 } // namespace parse
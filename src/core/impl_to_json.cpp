@@ -5,7 +5,7 @@
 
 namespace lcs {
 
-template <typename T> Json::Value _to_json(const std::map<Node, T>& m)
+template <typename T> Json::Value _to_json(const SlotMap<T>& m)
 {
     Json::Value doc { Json::objectValue };
     for (const auto& c : m) {
@@ -65,6 +65,9 @@ Json::Value InputNode::to_json() const
     Json::Value out;
     if (_freq.has_value()) {
         out["freq"] = _freq.value();
+        if (_phase != 0) {
+            out["phase"] = _phase;
+        }
     } else {
         out["data"] = get() == State::TRUE ? true : false;
     }
@@ -125,9 +128,12 @@ Json::Value Scene::to_json() const
     }
 
     if (!_relations.empty()) {
+        /* Relations are renumbered while saving, so ids of the removed
+         * relations are not carried over. */
         Json::Value doc { Json::objectValue };
-        for (const auto& c : _relations) {
-            doc[std::to_string(c.first)] = c.second.to_json();
+        relid id = 0;
+        for (const Rel& c : _relations) {
+            doc[std::to_string(++id)] = c.to_json();
         }
         out["rel"] = doc;
     }
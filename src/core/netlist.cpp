@@ -0,0 +1,918 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "common.h"
+#include "core.h"
+#include "io.h"
+#include "worker_pool.h"
+
+namespace lcs {
+
+static WorkerPool _pool {};
+static size_t _thread_s = 1;
+/* Netlists are numbered across all scenes, so an InstanceState can't be
+ * mistaken for the state of another component. */
+static std::atomic<uint32_t> _build_s { 0 };
+
+void Netlist::set_thread_count(size_t count)
+{
+    if (count == 0) {
+        count = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    if (count != _thread_s) {
+        L_INFO("Simulation threads: %zu", count);
+        _thread_s = count;
+        _pool.resize(count);
+    }
+}
+
+size_t Netlist::thread_count(void) { return _thread_s; }
+
+Netlist::Netlist(Scene* parent)
+    : _parent { parent }
+    , _is_dirty { true }
+    , _is_flat { false }
+    , _revision { 0 }
+    , _build { 0 }
+    , _cyclic_begin { 0 }
+    , _event_count { 0 }
+{
+}
+
+void Netlist::compile(void)
+{
+    lcs_assert(_parent != nullptr);
+    Scene& s = *_parent;
+    /* Components keep their state when the rest of the scene changes. */
+    std::unordered_map<uint64_t, InstanceState> states {};
+    for (uint32_t c = 0; c < _type.size(); c++) {
+        if (_type[c] == CELL_COMPONENT) {
+            states.emplace(
+                _key(_instance[c], _node[c]), std::move(_states[_aux[c]]));
+        }
+    }
+    _type.clear();
+    _node.clear();
+    _aux.clear();
+    _component_ids.clear();
+    _slot_in.clear();
+    _slot_out.clear();
+    _instance.clear();
+    _instances.assign(1, Instance { 0, Node {}, _parent });
+    _children.clear();
+    _cells.clear();
+    _in_offset.clear();
+    _in.clear();
+    _out_offset.clear();
+    _revision = io::component::revision();
+    _build    = ++_build_s;
+
+    /* Cells are numbered in the iteration order of the scene, and the cells
+     * of an instance follow its output cells. Signals of a cell are allocated
+     * next to each other. */
+    _add_cells(s, 0);
+    const uint32_t cell_s = _type.size();
+    uint32_t signal_s     = 0;
+    for (uint32_t c = 0; c < cell_s; c++) {
+        uint32_t out_s = _out_offset[c];
+        _out_offset[c] = signal_s;
+        signal_s += out_s;
+    }
+    _out_offset.push_back(signal_s);
+    for (uint32_t c = 0; c < cell_s; c++) {
+        _add_inputs(c);
+    }
+    _in_offset.push_back(_in.size());
+    _states.assign(_component_ids.size(), InstanceState {});
+    for (uint32_t c = 0; c < cell_s; c++) {
+        auto state = _type[c] == CELL_COMPONENT
+            ? states.find(_key(_instance[c], _node[c]))
+            : states.end();
+        if (state != states.end()) {
+            _states[_aux[c]] = std::move(state->second);
+        }
+    }
+
+    _driver.assign(signal_s, 0);
+    for (uint32_t c = 0; c < cell_s; c++) {
+        for (uint32_t sig = _out_offset[c]; sig < _out_offset[c + 1]; sig++) {
+            _driver[sig] = c;
+        }
+    }
+
+    /* Fan-out of each signal, stored as compressed rows. */
+    _fanout_offset.assign(signal_s + 1, 0);
+    for (uint32_t sig : _in) {
+        if (sig != NONE) {
+            _fanout_offset[sig + 1]++;
+        }
+    }
+    for (uint32_t sig = 0; sig < signal_s; sig++) {
+        _fanout_offset[sig + 1] += _fanout_offset[sig];
+    }
+    _fanout.assign(_fanout_offset[signal_s], 0);
+    {
+        std::vector<uint32_t> next { _fanout_offset.begin(),
+            _fanout_offset.end() - 1 };
+        for (uint32_t c = 0; c < cell_s; c++) {
+            for (uint32_t i = _in_offset[c]; i < _in_offset[c + 1]; i++) {
+                if (_in[i] != NONE) {
+                    _fanout[next[_in[i]]++] = c;
+                }
+            }
+        }
+    }
+
+    /* Relations that carry each signal, stored as compressed rows. */
+    std::vector<std::pair<uint32_t, relid>> rels {};
+    rels.reserve(s._relations.size());
+    for (const auto& rel : s._relations) {
+        rels.emplace_back(_signal_of(0, rel.id), rel.id);
+    }
+    _rel_offset.assign(signal_s + 1, 0);
+    for (const auto& rel : rels) {
+        _rel_offset[rel.first + 1]++;
+    }
+    for (uint32_t sig = 0; sig < signal_s; sig++) {
+        _rel_offset[sig + 1] += _rel_offset[sig];
+    }
+    _rels.assign(rels.size(), 0);
+    {
+        std::vector<uint32_t> next { _rel_offset.begin(),
+            _rel_offset.end() - 1 };
+        for (const auto& rel : rels) {
+            _rels[next[rel.first]++] = rel.second;
+        }
+    }
+
+    /* Signals start from the values of the scene, so only the differences are
+     * written back after the first evaluation. */
+    _read_values();
+    _initial = _value;
+
+    /* Levelize the cells with Kahn's algorithm. Cells that never reach zero
+     * in-degree are either in a feedback loop or depend on one. */
+    std::vector<uint32_t> degree(cell_s, 0);
+    std::vector<uint32_t> level(cell_s, 0);
+    std::vector<uint32_t> queue {};
+    queue.reserve(cell_s);
+    for (uint32_t c = 0; c < cell_s; c++) {
+        for (uint32_t i = _in_offset[c]; i < _in_offset[c + 1]; i++) {
+            if (_in[i] != NONE) {
+                degree[c]++;
+            }
+        }
+        if (degree[c] == 0) {
+            queue.push_back(c);
+        }
+    }
+    uint32_t level_s = 0;
+    for (size_t head = 0; head < queue.size(); head++) {
+        uint32_t c = queue[head];
+        level_s    = std::max(level_s, level[c] + 1);
+        for (uint32_t sig = _out_offset[c]; sig < _out_offset[c + 1]; sig++) {
+            for (uint32_t i = _fanout_offset[sig]; i < _fanout_offset[sig + 1];
+                i++) {
+                uint32_t r = _fanout[i];
+                level[r]   = std::max(level[r], level[c] + 1);
+                if (--degree[r] == 0) {
+                    queue.push_back(r);
+                }
+            }
+        }
+    }
+    _level_offset.assign(level_s + 1, 0);
+    for (uint32_t c : queue) {
+        _level_offset[level[c] + 1]++;
+    }
+    for (uint32_t l = 0; l < level_s; l++) {
+        _level_offset[l + 1] += _level_offset[l];
+    }
+    _order.assign(cell_s, 0);
+    {
+        std::vector<uint32_t> next { _level_offset.begin(),
+            _level_offset.end() - 1 };
+        for (uint32_t c : queue) {
+            _order[next[level[c]]++] = c;
+        }
+    }
+    _cyclic_begin = queue.size();
+    for (uint32_t c = 0, i = _cyclic_begin; c < cell_s; c++) {
+        if (degree[c] != 0) {
+            _order[i++] = c;
+        }
+    }
+
+    _pending.assign(cell_s, 1);
+    _changed.clear();
+    _changed_sinks.clear();
+    _is_dirty = false;
+    L_DEBUG("Compiled %zu cells, %zu instances into %zu levels%s.", size(),
+        instances(), levels(), is_cyclic() ? " with feedback loops" : "");
+}
+
+void Netlist::_add_cell(
+    uint32_t instance, Node id, uint8_t type, uint32_t aux, uint32_t out_s)
+{
+    _cells.emplace(_key(instance, id), _type.size());
+    _type.push_back(type);
+    _node.push_back(id);
+    _aux.push_back(aux);
+    _instance.push_back(instance);
+    if (type == CELL_COMPONENT_INPUT) {
+        _slot_in.push_back(_type.size() - 1);
+    } else if (type == CELL_COMPONENT_OUTPUT) {
+        _slot_out.push_back(_type.size() - 1);
+    }
+    /* Converted to offsets once all cells are added. */
+    _out_offset.push_back(out_s);
+}
+
+void Netlist::_add_cells(const Scene& s, uint32_t instance)
+{
+    for (const auto& in : s._inputs) {
+        _add_cell(instance, in.first, CELL_INPUT, 0, 1);
+    }
+    if (s.component_context.has_value()) {
+        uint8_t type
+            = instance == 0 ? CELL_COMPONENT_INPUT : CELL_INSTANCE_INPUT;
+        for (size_t i = 0; i < s.component_context->inputs.size(); i++) {
+            _add_cell(instance, s.component_context->get_input(i), type, i, 1);
+        }
+    }
+    for (const auto& gate : s._gates) {
+        _add_cell(instance, gate.first, gate.second.type(), 0, 1);
+    }
+    for (const auto& comp : s._components) {
+        const Scene* sub = _is_flat
+            ? _get_inlinable(comp.second.path, instance)
+            : nullptr;
+        if (sub == nullptr) {
+            _add_cell(instance, comp.first, CELL_COMPONENT,
+                _component_ids.size(), comp.second.outputs.size());
+            _component_ids.push_back(comp.second._component);
+            continue;
+        }
+        uint32_t child = _instances.size();
+        _instances.push_back(Instance { instance, comp.first, sub });
+        _children.emplace(_key(instance, comp.first), child);
+        for (size_t i = 0; i < comp.second.outputs.size(); i++) {
+            _add_cell(instance, comp.first, CELL_INSTANCE_OUTPUT, i, 1);
+        }
+        _add_cells(*sub, child);
+    }
+    for (const auto& out : s._outputs) {
+        _add_cell(instance, out.first, CELL_OUTPUT, 0, 0);
+    }
+    if (instance == 0 && s.component_context.has_value()) {
+        for (size_t i = 0; i < s.component_context->outputs.size(); i++) {
+            _add_cell(0, s.component_context->get_output(i),
+                CELL_COMPONENT_OUTPUT, i, 0);
+        }
+    }
+}
+
+void Netlist::_add_inputs(uint32_t c)
+{
+    _in_offset.push_back(_in.size());
+    uint32_t instance = _instance[c];
+    const Scene& s    = *_instances[instance].scene;
+    switch (_type[c]) {
+    case CELL_INPUT:
+    case CELL_COMPONENT_INPUT: break;
+    case CELL_INSTANCE_INPUT: {
+        /* Same packing as ComponentNode::on_signal, the first socket of the
+         * ComponentNode is the last slot of the component. */
+        const Instance& inst = _instances[instance];
+        const auto& inputs
+            = _instances[inst.parent].scene->_components.find(inst.node)
+                  ->second.inputs;
+        _in.push_back(_aux[c] < inputs.size()
+                ? _signal_of(inst.parent, inputs[inputs.size() - 1 - _aux[c]])
+                : NONE);
+        break;
+    }
+    case CELL_INSTANCE_OUTPUT: {
+        /* The signal inside the component, followed by the inputs of the
+         * ComponentNode that decide whether it is disabled. */
+        uint32_t child    = _children.at(_key(instance, _node[c]));
+        const Scene& sub  = *_instances[child].scene;
+        const auto& slots = sub.component_context->outputs;
+        _in.push_back(_aux[c] < slots.size() ? _signal_of(child, slots[_aux[c]])
+                                             : NONE);
+        for (relid r : s._components.find(_node[c])->second.inputs) {
+            _in.push_back(_signal_of(instance, r));
+        }
+        break;
+    }
+    case CELL_COMPONENT:
+        for (relid r : s._components.find(_node[c])->second.inputs) {
+            _in.push_back(_signal_of(instance, r));
+        }
+        break;
+    case CELL_OUTPUT:
+        _in.push_back(
+            _signal_of(instance, s._outputs.find(_node[c])->second.input));
+        break;
+    case CELL_COMPONENT_OUTPUT:
+        _in.push_back(
+            _signal_of(instance, s.component_context->outputs[_aux[c]]));
+        break;
+    default:
+        for (relid r : s._gates.find(_node[c])->second.inputs) {
+            _in.push_back(_signal_of(instance, r));
+        }
+        break;
+    }
+}
+
+const Scene* Netlist::_get_inlinable(
+    const std::string& path, uint32_t instance)
+{
+    if (io::component::fetch(path)) {
+        return nullptr;
+    }
+    NRef<const Scene> sub = io::component::get(path);
+    /* Clocks of a component are driven by the loaded component. */
+    if (sub == nullptr || !sub->_scheduler.empty()) {
+        return nullptr;
+    }
+    for (uint32_t i = instance;; i = _instances[i].parent) {
+        if (_instances[i].scene == &sub) {
+            L_WARN("Component %s depends on itself.", path.c_str());
+            return nullptr;
+        }
+        if (i == 0) {
+            break;
+        }
+    }
+    return &sub;
+}
+
+uint32_t Netlist::_signal_of(uint32_t instance, relid id) const
+{
+    if (id == 0) {
+        return NONE;
+    }
+    NRef<const Rel> r = _instances[instance].scene->_relations.find(id);
+    lcs_assert(r != nullptr);
+    auto c = _cells.find(_key(instance, r->from_node));
+    lcs_assert(c != _cells.end());
+    return _out_offset[c->second] + r->from_sock;
+}
+
+bool Netlist::_is_outdated(void) const
+{
+    return _is_dirty || (_is_flat && _revision != io::component::revision());
+}
+
+State Netlist::get_value(
+    const std::vector<Node>& path, Node id, sockid sock) const
+{
+    uint32_t instance = 0;
+    for (Node comp : path) {
+        auto child = _children.find(_key(instance, comp));
+        if (child == _children.end()) {
+            return State::DISABLED;
+        }
+        instance = child->second;
+    }
+    auto c = _cells.find(_key(instance, id));
+    if (c == _cells.end()) {
+        return State::DISABLED;
+    }
+    uint32_t cell = c->second;
+    uint32_t end  = cell + 1;
+    /* Each output socket of an inlined ComponentNode is a separate cell. */
+    while (_type[cell] == CELL_INSTANCE_OUTPUT && end < size()
+        && _type[end] == CELL_INSTANCE_OUTPUT
+        && _node[end].numeric() == _node[cell].numeric()
+        && _instance[end] == _instance[cell]) {
+        end++;
+    }
+    if (_out_offset[cell] == _out_offset[end]) {
+        /* Output cells show the value of their input. */
+        uint32_t in = _in[_in_offset[cell]];
+        return in == NONE ? State::DISABLED : _value[in];
+    }
+    uint32_t sig = _out_offset[cell] + sock;
+    return sig < _out_offset[end] ? _value[sig] : State::DISABLED;
+}
+
+void Netlist::set(Node id, State value)
+{
+    if (_is_outdated()) {
+        compile();
+    }
+    uint32_t cell = _cell_of(id);
+    if (cell != NONE) {
+        _set_signal(_out_offset[cell], value);
+    }
+}
+
+bool Netlist::evaluate(void)
+{
+    if (_is_outdated()) {
+        compile();
+    }
+    for (size_t l = 0; l < levels(); l++) {
+        uint32_t begin = _level_offset[l];
+        uint32_t end   = _level_offset[l + 1];
+        if (end - begin >= PARALLEL_LIMIT && thread_count() > 1) {
+            _eval_level(begin, end);
+            continue;
+        }
+        for (uint32_t i = begin; i < end; i++) {
+            if (_pending[_order[i]]) {
+                _eval(_order[i]);
+            }
+        }
+    }
+    bool is_settled = true;
+    if (is_cyclic()) {
+        is_settled = false;
+        for (size_t pass = 0; pass < CYCLE_LIMIT && !is_settled; pass++) {
+            is_settled = true;
+            for (size_t i = _cyclic_begin; i < _order.size(); i++) {
+                if (_pending[_order[i]]) {
+                    is_settled = false;
+                    _eval(_order[i]);
+                }
+            }
+        }
+        if (!is_settled) {
+            L_WARN("Feedback loop did not settle in %zu passes.", CYCLE_LIMIT);
+        }
+    }
+    _write_back();
+    return is_settled;
+}
+
+uint64_t Netlist::run(uint64_t input, InstanceState& state) const
+{
+    lcs_assert(!_is_dirty);
+    if (state.build != _build) {
+        state.values = _initial;
+        state.pending.assign(size(), 0);
+        state.children.assign(_component_ids.size(), InstanceState {});
+        state.build = _build;
+    }
+    for (uint32_t c : _slot_in) {
+        _set_signal(state, _out_offset[c],
+            (input >> _aux[c]) & 1 ? State::TRUE : State::FALSE);
+    }
+    for (size_t i = 0; i < _cyclic_begin; i++) {
+        if (state.pending[_order[i]]) {
+            _eval(_order[i], state);
+        }
+    }
+    bool is_settled = !is_cyclic();
+    for (size_t pass = 0; pass < CYCLE_LIMIT && !is_settled; pass++) {
+        is_settled = true;
+        for (size_t i = _cyclic_begin; i < _order.size(); i++) {
+            if (state.pending[_order[i]]) {
+                is_settled = false;
+                _eval(_order[i], state);
+            }
+        }
+    }
+    if (!is_settled) {
+        L_WARN("Feedback loop did not settle in %zu passes.", CYCLE_LIMIT);
+    }
+    uint64_t output = 0;
+    for (uint32_t c : _slot_out) {
+        uint32_t in = _in[_in_offset[c]];
+        output |= uint64_t { in != NONE && state.values[in] == State::TRUE }
+            << _aux[c];
+    }
+    return output;
+}
+
+void Netlist::evaluate_lanes(const uint64_t* input, uint64_t* output)
+{
+    if (_is_outdated()) {
+        compile();
+    } else if (_parent->mode() != SimulationMode::COMPILED) {
+        /* The values are only kept in sync in SimulationMode::COMPILED. */
+        _read_values();
+    }
+    _lanes.resize(_value.size());
+    for (uint32_t sig = 0; sig < _value.size(); sig++) {
+        _lanes[sig] = _value[sig] == State::TRUE ? ~uint64_t { 0 } : 0;
+    }
+    for (uint32_t c : _slot_in) {
+        _lanes[_out_offset[c]] = input[_aux[c]];
+    }
+
+    for (size_t i = 0; i < _cyclic_begin; i++) {
+        _eval_lanes(_order[i]);
+    }
+    bool is_settled = !is_cyclic();
+    for (size_t pass = 0; pass < CYCLE_LIMIT && !is_settled; pass++) {
+        is_settled = true;
+        for (size_t i = _cyclic_begin; i < _order.size(); i++) {
+            if (_eval_lanes(_order[i])) {
+                is_settled = false;
+            }
+        }
+    }
+    if (!is_settled) {
+        L_WARN("Feedback loop did not settle in %zu passes.", CYCLE_LIMIT);
+    }
+
+    for (uint32_t c : _slot_out) {
+        uint32_t in     = _in[_in_offset[c]];
+        output[_aux[c]] = in == NONE ? 0 : _lanes[in];
+    }
+}
+
+void Netlist::_read_values(void)
+{
+    _value.assign(_driver.size(), State::DISABLED);
+    for (uint32_t c = 0; c < size(); c++) {
+        /* Instances start from the state of the loaded component. */
+        const Scene& s = *_instances[_instance[c]].scene;
+        uint32_t sig   = _out_offset[c];
+        switch (_type[c]) {
+        case CELL_INPUT: {
+            /* Start from the value the relations carry, the node may have
+             * been changed right before the netlist was compiled. */
+            const InputNode& in = s._inputs.find(_node[c])->second;
+            _value[sig]         = in.output.empty() ? in.get()
+                        : s.get_value(in.output[0]);
+            break;
+        }
+        case CELL_COMPONENT_INPUT:
+            _value[sig] = s.component_context->_execution_input[_aux[c]]
+                ? State::TRUE
+                : State::FALSE;
+            break;
+        case CELL_INSTANCE_OUTPUT:
+            _value[sig] = s._components.find(_node[c])->second.get(_aux[c]);
+            break;
+        case CELL_COMPONENT: {
+            const auto& comp = s._components.find(_node[c])->second;
+            for (; sig < _out_offset[c + 1]; sig++) {
+                _value[sig] = comp.get(sig - _out_offset[c]);
+            }
+            break;
+        }
+        case CELL_INSTANCE_INPUT:
+        case CELL_OUTPUT:
+        case CELL_COMPONENT_OUTPUT: break;
+        default: _value[sig] = s._gates.find(_node[c])->second.get(); break;
+        }
+    }
+}
+
+uint32_t Netlist::_cell_of(Node id) const
+{
+    auto c = _cells.find(_key(0, id));
+    return c != _cells.end()
+            && (_type[c->second] == CELL_INPUT
+                || _type[c->second] == CELL_COMPONENT_INPUT)
+        ? c->second
+        : NONE;
+}
+
+void Netlist::_set_signal(uint32_t sig, State value, Chunk* chunk)
+{
+    if (_value[sig] == value) {
+        return;
+    } else if (chunk != nullptr) {
+        _value[sig] = value;
+        chunk->changed.push_back(sig);
+        return;
+    }
+    _value[sig] = value;
+    _mark_changed(sig);
+}
+
+void Netlist::_mark_changed(uint32_t sig)
+{
+    _event_count++;
+    _changed.push_back(sig);
+    for (uint32_t i = _fanout_offset[sig]; i < _fanout_offset[sig + 1]; i++) {
+        _pending[_fanout[i]] = 1;
+    }
+}
+
+void Netlist::_set_signal(
+    InstanceState& state, uint32_t sig, State value) const
+{
+    if (state.values[sig] == value) {
+        return;
+    }
+    state.values[sig] = value;
+    for (uint32_t i = _fanout_offset[sig]; i < _fanout_offset[sig + 1]; i++) {
+        state.pending[_fanout[i]] = 1;
+    }
+}
+
+void Netlist::_eval(uint32_t c, Chunk* chunk)
+{
+    _pending[c] = 0;
+    switch (_type[c]) {
+    case CELL_OUTPUT:
+    case CELL_COMPONENT_OUTPUT:
+        if (_instance[c] != 0) {
+            break;
+        } else if (chunk != nullptr) {
+            chunk->sinks.push_back(c);
+        } else {
+            _changed_sinks.push_back(c);
+        }
+        return;
+    case CELL_COMPONENT:
+        if (chunk != nullptr) {
+            /* Components are evaluated after the rest of their level, since
+             * the states of the component cells are not thread safe. */
+            chunk->deferred.push_back(c);
+            return;
+        }
+        break;
+    default: break;
+    }
+    State out[64];
+    uint32_t out_s = _compute(c, _value.data(), _states.data(), out);
+    for (uint32_t i = 0; i < out_s; i++) {
+        _set_signal(_out_offset[c] + i, out[i], chunk);
+    }
+}
+
+void Netlist::_eval(uint32_t c, InstanceState& state) const
+{
+    state.pending[c] = 0;
+    State out[64];
+    uint32_t out_s
+        = _compute(c, state.values.data(), state.children.data(), out);
+    for (uint32_t i = 0; i < out_s; i++) {
+        _set_signal(state, _out_offset[c] + i, out[i]);
+    }
+}
+
+/* Computes the output signals of a cell from the given signal values, and
+ * returns their number. */
+uint32_t Netlist::_compute(uint32_t c, const State* value,
+    InstanceState* states, State* out) const
+{
+    const uint32_t* begin = _in.data() + _in_offset[c];
+    const uint32_t* end   = _in.data() + _in_offset[c + 1];
+    bool is_connected     = true;
+    uint32_t ones         = 0;
+    for (const uint32_t* in = begin; in != end; in++) {
+        if (*in == NONE) {
+            is_connected = false;
+            break;
+        }
+        ones += value[*in] == State::TRUE;
+    }
+
+    switch (_type[c]) {
+    case CELL_INPUT:
+    case CELL_COMPONENT_INPUT:
+    case CELL_OUTPUT:
+    case CELL_COMPONENT_OUTPUT: return 0;
+    case CELL_INSTANCE_INPUT:
+        out[0] = ones ? State::TRUE : State::FALSE;
+        return 1;
+    case CELL_INSTANCE_OUTPUT:
+        /* A ComponentNode is disabled unless all of its inputs are
+         * connected, otherwise disabled signals are read as FALSE. */
+        out[0] = std::find(begin + 1, end, NONE) != end ? State::DISABLED
+            : *begin != NONE && value[*begin] == State::TRUE
+            ? State::TRUE
+            : State::FALSE;
+        return 1;
+    case CELL_COMPONENT: {
+        uint32_t out_s = _out_offset[c + 1] - _out_offset[c];
+        if (!is_connected) {
+            std::fill(out, out + out_s, State::DISABLED);
+            return out_s;
+        }
+        /* Same packing as ComponentNode::on_signal, the first socket is the
+         * highest bit. */
+        uint64_t input = 0;
+        for (const uint32_t* in = begin; in != end; in++) {
+            input = (input << 1) | (value[*in] == State::TRUE);
+        }
+        uint64_t result = io::component::run(
+            _component_ids[_aux[c]], input, states[_aux[c]]);
+        for (uint32_t i = 0; i < out_s; i++) {
+            out[i] = (result >> i) & 1 ? State::TRUE : State::FALSE;
+        }
+        return out_s;
+    }
+    default:
+        if (!is_connected) {
+            out[0] = State::DISABLED;
+        } else {
+            out[0] = GateNode::apply(
+                         static_cast<GateType>(_type[c]), ones, end - begin)
+                ? State::TRUE
+                : State::FALSE;
+        }
+        return 1;
+    }
+}
+
+void Netlist::_eval_level(uint32_t begin, uint32_t end)
+{
+    size_t chunk_s = (end - begin + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    if (_chunks.size() < chunk_s) {
+        _chunks.resize(chunk_s);
+    }
+    /* Every signal is driven by a single cell and cells only read the
+     * previous levels, so the cells of a level can be evaluated in any
+     * order. The side effects are applied afterwards in the order of the
+     * serial evaluation. */
+    _pool.run(chunk_s, [&](size_t t) {
+        Chunk& chunk = _chunks[t];
+        chunk.changed.clear();
+        chunk.sinks.clear();
+        chunk.deferred.clear();
+        uint32_t last = std::min<uint32_t>(end, begin + (t + 1) * CHUNK_SIZE);
+        for (uint32_t i = begin + t * CHUNK_SIZE; i < last; i++) {
+            if (_pending[_order[i]]) {
+                _eval(_order[i], &chunk);
+            }
+        }
+    });
+    for (size_t t = 0; t < chunk_s; t++) {
+        for (uint32_t sig : _chunks[t].changed) {
+            _mark_changed(sig);
+        }
+        _changed_sinks.insert(_changed_sinks.end(), _chunks[t].sinks.begin(),
+            _chunks[t].sinks.end());
+    }
+    for (size_t t = 0; t < chunk_s; t++) {
+        for (uint32_t c : _chunks[t].deferred) {
+            _eval(c);
+        }
+    }
+}
+
+bool Netlist::_set_lane(uint32_t sig, uint64_t value)
+{
+    if (_lanes[sig] == value) {
+        return false;
+    }
+    _lanes[sig] = value;
+    return true;
+}
+
+bool Netlist::_eval_lanes(uint32_t c)
+{
+    const uint32_t* begin = _in.data() + _in_offset[c];
+    const uint32_t* end   = _in.data() + _in_offset[c + 1];
+    bool is_connected     = std::none_of(
+        begin, end, [](uint32_t in) { return in == NONE; });
+
+    switch (_type[c]) {
+    case CELL_INPUT:
+    case CELL_COMPONENT_INPUT:
+    case CELL_OUTPUT:
+    case CELL_COMPONENT_OUTPUT: return false;
+    case CELL_INSTANCE_INPUT:
+        return _set_lane(_out_offset[c], is_connected ? _lanes[*begin] : 0);
+    case CELL_INSTANCE_OUTPUT:
+        if (std::find(begin + 1, end, NONE) != end || *begin == NONE) {
+            return _set_lane(_out_offset[c], 0);
+        }
+        return _set_lane(_out_offset[c], _lanes[*begin]);
+    case CELL_COMPONENT: {
+        uint32_t out   = _out_offset[c];
+        uint32_t out_s = _out_offset[c + 1] - out;
+        bool changed   = false;
+        if (!is_connected) {
+            for (uint32_t i = 0; i < out_s; i++) {
+                changed |= _set_lane(out + i, 0);
+            }
+            return changed;
+        }
+        /* Components are evaluated per pattern with the packing of
+         * ComponentNode::on_signal, so the lanes are transposed. */
+        uint64_t input[64];
+        uint64_t result[64];
+        for (uint32_t lane = 0; lane < 64; lane++) {
+            input[lane] = 0;
+            for (const uint32_t* in = begin; in != end; in++) {
+                input[lane] = (input[lane] << 1) | ((_lanes[*in] >> lane) & 1);
+            }
+        }
+        io::component::run_batch(
+            _component_ids[_aux[c]], input, result, 64);
+        for (uint32_t i = 0; i < out_s; i++) {
+            uint64_t value = 0;
+            for (uint32_t lane = 0; lane < 64; lane++) {
+                value |= ((result[lane] >> i) & 1) << lane;
+            }
+            changed |= _set_lane(out + i, value);
+        }
+        return changed;
+    }
+    default: {
+        if (!is_connected) {
+            return _set_lane(_out_offset[c], 0);
+        }
+        uint64_t value = _lanes[*begin];
+        switch (_type[c]) {
+        case GateType::AND:
+        case GateType::NAND:
+            for (const uint32_t* in = begin + 1; in != end; in++) {
+                value &= _lanes[*in];
+            }
+            break;
+        case GateType::OR:
+        case GateType::NOR:
+            for (const uint32_t* in = begin + 1; in != end; in++) {
+                value |= _lanes[*in];
+            }
+            break;
+        case GateType::XOR:
+        case GateType::XNOR:
+            for (const uint32_t* in = begin + 1; in != end; in++) {
+                value ^= _lanes[*in];
+            }
+            break;
+        default: break;
+        }
+        switch (_type[c]) {
+        case GateType::NOT:
+        case GateType::NAND:
+        case GateType::NOR:
+        case GateType::XNOR: value = ~value; break;
+        default: break;
+        }
+        return _set_lane(_out_offset[c], value);
+    }
+    }
+}
+
+void Netlist::_write_back(void)
+{
+    Scene& s = *_parent;
+    for (uint32_t sig : _changed) {
+        uint32_t c = _driver[sig];
+        if (_instance[c] != 0) {
+            /* Loaded components are shared, instances only keep their values
+             * in the netlist. */
+            continue;
+        }
+        switch (_type[c]) {
+        case CELL_INPUT:
+        case CELL_COMPONENT_INPUT: break;
+        case CELL_INSTANCE_OUTPUT: {
+            auto comp          = s.get_node<ComponentNode>(_node[c]);
+            comp->_is_disabled = _value[sig] == State::DISABLED;
+            if (_value[sig] == State::TRUE) {
+                comp->_output_value |= uint64_t { 1 } << _aux[c];
+            } else {
+                comp->_output_value &= ~(uint64_t { 1 } << _aux[c]);
+            }
+            break;
+        }
+        case CELL_COMPONENT: {
+            auto comp           = s.get_node<ComponentNode>(_node[c]);
+            uint32_t out        = _out_offset[c];
+            comp->_is_disabled  = _value[out] == State::DISABLED;
+            comp->_output_value = 0;
+            for (uint32_t i = out; i < _out_offset[c + 1]; i++) {
+                comp->_output_value
+                    |= uint64_t { _value[i] == State::TRUE } << (i - out);
+            }
+            break;
+        }
+        default: {
+            auto gate          = s.get_node<GateNode>(_node[c]);
+            gate->_value       = _value[sig];
+            gate->_is_disabled = _value[sig] == State::DISABLED;
+            break;
+        }
+        }
+        for (uint32_t i = _rel_offset[sig]; i < _rel_offset[sig + 1]; i++) {
+            s._relations.set_value(_rels[i], _value[sig]);
+            if (s._waveform != nullptr) {
+                s._waveform->record(_rels[i], _value[sig]);
+            }
+        }
+    }
+    for (uint32_t c : _changed_sinks) {
+        uint32_t in = _in[_in_offset[c]];
+        State value = in == NONE ? State::DISABLED : _value[in];
+        if (_type[c] == CELL_OUTPUT) {
+            s.get_node<OutputNode>(_node[c])->_value = value;
+        } else {
+            s.component_context->_execution_output[_aux[c]]
+                = value == State::TRUE;
+        }
+    }
+    _changed.clear();
+    _changed_sinks.clear();
+}
+
+} // namespace lcs
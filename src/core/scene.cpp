@@ -11,13 +11,18 @@ namespace lcs {
 
 Scene::Scene(const std::string& _name, const std::string& _author,
         const std::string& _description, int _version) :
-        version { _version }, component_context { std::nullopt }, _last_node {
+        version { _version }, component_context { std::nullopt },
+        _scheduler { this }, _netlist { this }, _waveform { nullptr },
+        _last_node {
             Node { 0, NodeType::GATE },
             Node { 0, NodeType::COMPONENT },
             Node { 0, NodeType::INPUT },
             Node { 0, NodeType::OUTPUT },
         },
-        _last_rel { 0 }
+        _last_rel { 0 }, _mode { SimulationMode::INTERPRETED },
+        _event_budget { EVENT_BUDGET }, _event_count { 0 },
+        _batch_depth { 0 }, _is_propagating { false },
+        _is_budget_exceeded { false }
 {
     std::strncpy(name.data(), _name.c_str(), name.size() - 1);
     std::strncpy(author.data(), _author.c_str(), author.size() - 1);
@@ -27,13 +32,18 @@ Scene::Scene(const std::string& _name, const std::string& _author,
 
 Scene::Scene(ComponentContext ctx, const std::string& _name,
         const std::string& _author, const std::string& _description, int _version) :
-        version { _version }, component_context { ctx }, _last_node {
+        version { _version }, component_context { ctx },
+        _scheduler { this }, _netlist { this }, _waveform { nullptr },
+        _last_node {
             Node { 0, NodeType::GATE },
             Node { 0, NodeType::COMPONENT },
             Node { 0, NodeType::INPUT },
             Node { 0, NodeType::OUTPUT },
         },
-        _last_rel { 0 }
+        _last_rel { 0 }, _mode { SimulationMode::INTERPRETED },
+        _event_budget { EVENT_BUDGET }, _event_count { 0 },
+        _batch_depth { 0 }, _is_propagating { false },
+        _is_budget_exceeded { false }
 {
     std::strncpy(name.data(), _name.c_str(), name.size() - 1);
     std::strncpy(author.data(), _author.c_str(), author.size() - 1);
@@ -63,17 +73,26 @@ void Scene::_move_from(Scene&& other)
     author            = std::move(other.author);
     version           = other.version;
     dependencies      = std::move(other.dependencies);
-    _timerlist        = std::move(other._timerlist);
+    _scheduler        = std::move(other._scheduler);
     _gates            = std::move(other._gates);
     _components       = std::move(other._components);
     _inputs           = std::move(other._inputs);
     _outputs          = std::move(other._outputs);
     _relations        = std::move(other._relations);
+    _netlist          = std::move(other._netlist);
+    _waveform         = other._waveform;
+    _mode             = other._mode;
+    _event_budget     = other._event_budget;
+    _event_count      = other._event_count;
+    _oscillating      = std::move(other._oscillating);
     component_context = std::move(other.component_context);
     for (size_t i = 0; i < NodeType::NODE_S; i++) {
         _last_node[i] = other._last_node[i];
     }
-    _last_rel = other._last_rel;
+    _last_rel           = other._last_rel;
+    _batch_depth        = other._batch_depth;
+    _is_propagating     = false;
+    _is_budget_exceeded = false;
 
     for (auto& gate : _gates) {
         gate.second.reload(this);
@@ -90,6 +109,8 @@ void Scene::_move_from(Scene&& other)
     if (component_context.has_value()) {
         component_context->reload(this);
     }
+    _netlist.reload(this);
+    _scheduler.reload(this);
 }
 
 void Scene::remove_node(Node id)
@@ -97,6 +118,7 @@ void Scene::remove_node(Node id)
     if (id.id == 0) {
         lcs_assert(id.id != 0);
     }
+    _netlist.invalidate();
     switch (id.type) {
     case NodeType::GATE: {
         lcs_assert(id.id <= _last_node[NodeType::GATE].id);
@@ -139,7 +161,7 @@ void Scene::remove_node(Node id)
         auto i = _inputs.find(id);
         lcs_assert(i != _inputs.end());
         if (i->second.is_timer()) {
-            _timerlist.erase(i->first);
+            _scheduler.remove(i->first);
         }
         for (auto r : i->second.output) {
             if (r != 0) {
@@ -168,9 +190,8 @@ NRef<Rel> Scene::get_rel(relid idx)
     if (idx == 0 || idx > _last_rel) {
         return nullptr;
     }
-    auto n = _relations.find(idx);
-    return n != _relations.end() ? &n->second
-                                 : (S_ERROR("Rel not found", nullptr));
+    return _relations.contains(idx) ? &*_relations.find(idx)
+                                    : (S_ERROR("Rel not found", nullptr));
 }
 
 Error Scene::_connect_with_id(
@@ -233,20 +254,18 @@ Error Scene::_connect_with_id(
     if (!is_connected) {
         return ERROR(Error::ALREADY_CONNECTED);
     }
-    _relations.emplace(id, Rel { id, from_node, to_node, from_sock, to_sock });
+    _relations.emplace(Rel { id, from_node, to_node, from_sock, to_sock });
+    _netlist.invalidate();
 
     switch (from_node.type) {
     case NodeType::GATE:
         get_node<GateNode>(from_node)->output.push_back(id);
-        get_node<GateNode>(from_node)->on_signal();
         break;
     case NodeType::COMPONENT:
         get_node<ComponentNode>(from_node)->outputs[from_sock].push_back(id);
-        get_node<ComponentNode>(from_node)->on_signal();
         break;
     case NodeType::INPUT:
         get_node<InputNode>(from_node)->output.push_back(id);
-        get_node<InputNode>(from_node)->on_signal();
         break;
     case NodeType::COMPONENT_INPUT: /* Component input is not handled
                                      here. */
@@ -265,6 +284,16 @@ Error Scene::_connect_with_id(
         break;
     default: return ERROR(Error::INVALID_TO_TYPE);
     }
+    if (_batch_depth != 0) {
+        /* Scene::commit evaluates every node. */
+        return OK;
+    }
+    if (NRef<BaseNode> from = get_base(from_node); from != nullptr) {
+        from->on_signal();
+    }
+    /* The value of the source may not have changed, but the target has not
+     * received it yet. */
+    _notify(*_relations.find(id));
     return OK;
 }
 
@@ -283,73 +312,74 @@ Error Scene::disconnect(relid id)
         return ERROR(Error::INVALID_RELID);
     }
     auto remove_fn = [id](relid i) { return i == id; };
-    auto r         = _relations.find(id);
-    if (r == _relations.end()) {
+    NRef<Rel> r    = _relations.find(id);
+    if (r == nullptr) {
         return ERROR(Error::REL_NOT_FOUND);
     }
+    _netlist.invalidate();
 
-    switch (r->second.from_node.type) {
+    switch (r->from_node.type) {
     case NodeType::GATE: {
-        auto& v = get_node<GateNode>(r->second.from_node)->output;
+        auto& v = get_node<GateNode>(r->from_node)->output;
         v.erase(std::remove_if(v.begin(), v.end(), remove_fn));
         break;
     }
     case NodeType::COMPONENT: {
-        auto& v = get_node<ComponentNode>(r->second.from_node)
-                      ->outputs[r->second.from_sock];
+        auto& v = get_node<ComponentNode>(r->from_node)
+                      ->outputs[r->from_sock];
         v.erase(std::remove_if(v.begin(), v.end(), remove_fn));
         break;
     }
     case NodeType::INPUT: {
-        auto& v = get_node<InputNode>(r->second.from_node)->output;
+        auto& v = get_node<InputNode>(r->from_node)->output;
         v.erase(std::remove_if(v.begin(), v.end(), remove_fn));
         break;
     }
     case NodeType::COMPONENT_INPUT: {
         lcs_assert(component_context.has_value());
-        if (component_context->inputs.size() > r->second.from_node.id - 1) {
-            auto& v = component_context->inputs[r->second.from_node.id - 1];
+        if (component_context->inputs.size() > r->from_node.id - 1) {
+            auto& v = component_context->inputs[r->from_node.id - 1];
             v.erase(std::remove_if(v.begin(), v.end(), remove_fn));
         } else {
             return ERROR(Error::NOT_CONNECTED);
         }
         break;
     }
-    default: lcs_assert(r->second.from_node.type == NodeType::OUTPUT); break;
+    default: lcs_assert(r->from_node.type == NodeType::OUTPUT); break;
     }
 
-    switch (r->second.to_node.type) {
+    switch (r->to_node.type) {
     case NodeType::GATE: {
-        auto g = get_node<GateNode>(r->second.to_node);
+        auto g = get_node<GateNode>(r->to_node);
 
-        g->inputs[r->second.to_sock] = 0;
+        g->inputs[r->to_sock] = 0;
         g->on_signal();
         break;
     }
     case NodeType::COMPONENT: {
-        auto c = get_node<ComponentNode>(r->second.to_node);
+        auto c = get_node<ComponentNode>(r->to_node);
 
-        c->inputs[r->second.to_sock] = 0;
+        c->inputs[r->to_sock] = 0;
         c->on_signal();
         break;
     }
     case NodeType::OUTPUT: {
-        auto o   = get_node<OutputNode>(r->second.to_node);
+        auto o   = get_node<OutputNode>(r->to_node);
         o->input = 0;
         o->on_signal();
         break;
     }
     case NodeType::COMPONENT_OUTPUT: {
         lcs_assert(component_context.has_value());
-        if (component_context->outputs.size() > r->second.to_node.id - 1) {
-            component_context->outputs[r->second.to_node.id - 1] = 0;
+        if (component_context->outputs.size() > r->to_node.id - 1) {
+            component_context->outputs[r->to_node.id - 1] = 0;
             component_context->run();
         } else {
             return ERROR(Error::NOT_CONNECTED);
         }
         break;
     }
-    default: lcs_assert(r->second.from_node.type == NodeType::INPUT); break;
+    default: lcs_assert(r->from_node.type == NodeType::INPUT); break;
     }
     _relations.erase(id);
     return OK;
@@ -360,20 +390,179 @@ void Scene::signal(relid id, State value)
     if (id == 0) {
         return;
     }
-    if (auto r = _relations.find(id); r != _relations.end()) {
-        if (r->second.value != value) {
-            r->second.value = value;
-            if (r->second.to_node.type != NodeType::COMPONENT_OUTPUT) {
-                auto n = get_base(r->second.to_node);
-                if (n != nullptr) {
-                    n->on_signal();
-                }
-            } else {
-                component_context->set_value(
-                    r->second.to_node.id, r->second.value);
+    if (_relations.contains(id) && _relations.value(id) != value) {
+        _event_count++;
+        _relations.set_value(id, value);
+        if (_waveform != nullptr) {
+            _waveform->record(id, value);
+        }
+        Rel& rel = *_relations.find(id);
+        if (_is_budget_exceeded && !rel.is_oscillating) {
+            rel.is_oscillating = true;
+            _oscillating.push_back(id);
+        }
+        _notify(rel);
+    }
+}
+
+void Scene::_notify(Rel& rel)
+{
+    if (rel.to_node.type == NodeType::COMPONENT_OUTPUT) {
+        component_context->set_value(
+            rel.to_node.id, _relations.value(rel.id));
+        return;
+    }
+    _worklist.push_back(rel.to_node);
+    if (!_is_propagating && _batch_depth == 0) {
+        _propagate();
+    }
+}
+
+void Scene::_propagate(void)
+{
+    _is_propagating = true;
+    for (relid id : _oscillating) {
+        if (NRef<Rel> r = _relations.find(id); r != nullptr) {
+            r->is_oscillating = false;
+        }
+    }
+    _oscillating.clear();
+
+    size_t budget = _event_budget;
+    for (size_t head = 0; head < _worklist.size(); head++) {
+        if (budget == 0) {
+            if (_is_budget_exceeded) {
+                break;
+            }
+            /* Keep running for a while to find out which relations are
+             * still changing. */
+            _is_budget_exceeded = true;
+            budget = std::min(_event_budget, 2 * _relations.size() + 1);
+        }
+        budget--;
+        NRef<BaseNode> node = get_base(_worklist[head]);
+        if (node != nullptr) {
+            node->on_signal();
+        }
+    }
+    if (_is_budget_exceeded) {
+        L_WARN("Signals did not settle in %zu events, %zu relations are "
+               "oscillating.",
+            _event_budget, _oscillating.size());
+    }
+    _worklist.clear();
+    _is_propagating     = false;
+    _is_budget_exceeded = false;
+}
+
+void Scene::begin(void) { _batch_depth++; }
+
+void Scene::commit(void)
+{
+    lcs_assert(_batch_depth > 0);
+    if (--_batch_depth == 0) {
+        _settle();
+    }
+}
+
+/* Whether the node is stored in the node maps of the scene. */
+static bool _is_scene_node(Node id)
+{
+    return id.type == NodeType::GATE || id.type == NodeType::COMPONENT
+        || id.type == NodeType::INPUT || id.type == NodeType::OUTPUT;
+}
+
+void Scene::_settle(void)
+{
+    if (_is_propagating) {
+        return;
+    }
+    /* Number of inputs of each node whose source is not evaluated yet. */
+    std::array<std::vector<uint32_t>, NodeType::NODE_S> pending;
+    auto reserve = [&](const auto& nodes) {
+        for (const auto& node : nodes) {
+            std::vector<uint32_t>& p = pending[node.first.type];
+            if (node.first.id >= p.size()) {
+                p.resize(node.first.id + 1, 0);
+            }
+        }
+    };
+    reserve(_gates);
+    reserve(_components);
+    reserve(_inputs);
+    reserve(_outputs);
+    for (const Rel& r : _relations) {
+        if (_is_scene_node(r.from_node) && _is_scene_node(r.to_node)) {
+            pending[r.to_node.type][r.to_node.id]++;
+        }
+    }
+
+    std::vector<Node> order;
+    order.reserve(_gates.size() + _components.size() + _inputs.size()
+        + _outputs.size());
+    auto push_ready = [&](const auto& nodes) {
+        for (const auto& node : nodes) {
+            if (pending[node.first.type][node.first.id] == 0) {
+                order.push_back(node.first);
+            }
+        }
+    };
+    push_ready(_inputs);
+    push_ready(_gates);
+    push_ready(_components);
+    push_ready(_outputs);
+
+    auto release = [&](const std::vector<relid>& outputs) {
+        for (relid out : outputs) {
+            NRef<Rel> r = _relations.find(out);
+            if (r != nullptr && _is_scene_node(r->to_node)
+                && --pending[r->to_node.type][r->to_node.id] == 0) {
+                order.push_back(r->to_node);
+            }
+        }
+    };
+    /* Signals only update the relations here, every target is evaluated
+     * after its sources anyway. */
+    _is_propagating = true;
+    for (size_t head = 0; head < order.size(); head++) {
+        Node id = order[head];
+        get_base(id)->on_signal();
+        switch (id.type) {
+        case NodeType::GATE: release(get_node<GateNode>(id)->output); break;
+        case NodeType::INPUT: release(get_node<InputNode>(id)->output); break;
+        case NodeType::COMPONENT:
+            for (const auto& out : get_node<ComponentNode>(id)->outputs) {
+                release(out.second);
             }
+            break;
+        default: break;
         }
     }
+    _worklist.clear();
+    _is_propagating = false;
+
+    if (component_context.has_value()) {
+        for (relid out : component_context->outputs) {
+            if (NRef<Rel> r = _relations.find(out); r != nullptr) {
+                _notify(*r);
+            }
+        }
+    }
+    /* Nodes that are part of a cycle, or depend on one, settle through the
+     * regular propagation. */
+    auto push_pending = [&](const auto& nodes) {
+        for (const auto& node : nodes) {
+            if (pending[node.first.type][node.first.id] != 0) {
+                _worklist.push_back(node.first);
+            }
+        }
+    };
+    push_pending(_gates);
+    push_pending(_components);
+    push_pending(_outputs);
+    if (!_worklist.empty()) {
+        _propagate();
+    }
 }
 
 std::ostream& operator<<(std::ostream& os, const Scene& s)
@@ -416,13 +605,7 @@ std::string Scene::to_dependency() const
 
 Error Scene::load_dependencies(void)
 {
-    for (const std::string& dep : dependencies) {
-        Error err = io::component::fetch(dep);
-        if (err) {
-            return err;
-        }
-    }
-    return OK;
+    return io::component::fetch_all(dependencies);
 }
 
 std::string Scene::to_filepath(void) const
@@ -440,15 +623,21 @@ std::string Scene::to_filepath(void) const
     return p;
 }
 
-void Scene::run_timers(void)
+void Scene::set_mode(SimulationMode mode)
 {
-    for (auto& timer : _timerlist) {
-        NRef<InputNode> node = get_node<InputNode>(timer.first);
-        timer.second += node->_freq.value_or(0) / 60;
-        if (timer.second > 1) {
-            timer.second--;
-            node->toggle();
-        }
+    _mode = mode;
+    _netlist.invalidate();
+}
+
+void Scene::evaluate(Node id)
+{
+    NRef<BaseNode> node = get_base(id);
+    lcs_assert(node != nullptr);
+    if (_mode == SimulationMode::COMPILED) {
+        _netlist.set(id, node->get());
+        _netlist.evaluate();
+    } else {
+        node->on_signal();
     }
 }
 
@@ -0,0 +1,92 @@
+#include "common.h"
+#include "core.h"
+#include "io.h"
+#include <algorithm>
+#include <cmath>
+
+namespace lcs {
+
+/* std::push_heap keeps the largest item on top, so the later events are the
+ * smaller ones. */
+template <typename E> static bool _is_later(const E& a, const E& b)
+{
+    return a.time != b.time ? a.time > b.time : b.id < a.id;
+}
+
+template <typename C> static uint64_t _time_of(const C& clock, uint64_t step)
+{
+    return std::llround(clock.offset + step * clock.half_period);
+}
+
+Scheduler::Scheduler(Scene* parent)
+    : _parent { parent }
+    , _now { 0 }
+    , _seq { 0 }
+{
+}
+
+void Scheduler::add(Node id, float freq, float phase)
+{
+    lcs_assert(freq > 0);
+    Clock& clock      = _clocks[id];
+    clock.half_period = SECOND / static_cast<double>(freq);
+    clock.offset      = (phase - std::floor(phase)) * 2 * clock.half_period;
+    clock.seq         = ++_seq;
+
+    /* First toggle after the current time. */
+    double k      = std::floor((_now - clock.offset) / clock.half_period) + 1;
+    uint64_t step = std::max(k, 1.0);
+    while (_time_of(clock, step) <= _now) {
+        step++;
+    }
+    _queue.push_back(Event { _time_of(clock, step), step, id, clock.seq });
+    std::push_heap(_queue.begin(), _queue.end(), _is_later<Event>);
+}
+
+void Scheduler::remove(Node id) { _clocks.erase(id); }
+
+uint64_t Scheduler::next(void)
+{
+    _prune();
+    return _queue.empty() ? UINT64_MAX : _queue.front().time;
+}
+
+size_t Scheduler::run_until(uint64_t time)
+{
+    size_t toggles = 0;
+    for (_prune(); !_queue.empty() && _queue.front().time <= time; _prune()) {
+        std::pop_heap(_queue.begin(), _queue.end(), _is_later<Event>);
+        Event& event = _queue.back();
+        _now         = event.time;
+        if (_parent->_waveform != nullptr) {
+            _parent->_waveform->set_time(_now);
+        }
+        Node id = event.id;
+        event.step++;
+        event.time = _time_of(_clocks.find(id)->second, event.step);
+        std::push_heap(_queue.begin(), _queue.end(), _is_later<Event>);
+
+        _parent->get_node<InputNode>(id)->toggle();
+        toggles++;
+    }
+    _now = std::max(_now, time);
+    if (_parent->_waveform != nullptr) {
+        _parent->_waveform->set_time(_now);
+    }
+    return toggles;
+}
+
+void Scheduler::_prune(void)
+{
+    while (!_queue.empty()) {
+        const Event& top = _queue.front();
+        auto clock       = _clocks.find(top.id);
+        if (clock != _clocks.end() && clock->second.seq == top.seq) {
+            return;
+        }
+        std::pop_heap(_queue.begin(), _queue.end(), _is_later<Event>);
+        _queue.pop_back();
+    }
+}
+
+} // namespace lcs
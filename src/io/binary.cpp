@@ -0,0 +1,721 @@
+#include "common.h"
+#include "core.h"
+#include "io.h"
+#include <json/json.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <map>
+
+namespace lcs::io::binary {
+
+/* Sections of a binary scene, in the order they are stored. */
+enum Section {
+    DEPENDENCY,
+    GATE,
+    INPUT,
+    OUTPUT,
+    COMPONENT,
+    RELATION,
+    POSITION,
+
+    SECTION_S
+};
+
+static constexpr size_t HEADER_SIZE = 56;
+/* Size of a record in each section. */
+static constexpr size_t RECORD_SIZE[SECTION_S] = { 4, 4, 12, 4, 8, 12, 8 };
+/* Offset of the count of each section in the header. The positions section
+ * has a position for every node. */
+static constexpr size_t COUNT_OFFSET = 32;
+/* Marks an absent string, such as an empty description. */
+static constexpr uint32_t NO_STRING = UINT32_MAX;
+
+/* Flags of the input records. */
+static constexpr uint8_t INPUT_VALUE = 1 << 0;
+static constexpr uint8_t INPUT_CLOCK = 1 << 1;
+
+static constexpr size_t _align(size_t size)
+{
+    return (size + 3) & ~size_t { 3 };
+}
+
+/** Appends little-endian values to a buffer. */
+class Writer {
+public:
+    explicit Writer(std::vector<unsigned char>& data)
+        : _data { data }
+    {
+    }
+
+    void u8(uint8_t v) { _data.push_back(v); }
+    void u16(uint16_t v)
+    {
+        u8(v & 0xFF);
+        u8(v >> 8);
+    }
+    void u32(uint32_t v)
+    {
+        u16(v & 0xFFFF);
+        u16(v >> 16);
+    }
+    void i32(int32_t v) { u32(static_cast<uint32_t>(v)); }
+    void f32(float v)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        u32(bits);
+    }
+    void bytes(const void* data, size_t size)
+    {
+        const unsigned char* begin = static_cast<const unsigned char*>(data);
+        _data.insert(_data.end(), begin, begin + size);
+    }
+
+private:
+    std::vector<unsigned char>& _data;
+};
+
+/** Reads little-endian values in place. Bounds are checked by Layout. */
+static inline uint8_t _u8(const unsigned char* p) { return p[0]; }
+static inline uint16_t _u16(const unsigned char* p)
+{
+    return p[0] | (uint16_t { p[1] } << 8);
+}
+static inline uint32_t _u32(const unsigned char* p)
+{
+    return _u16(p) | (uint32_t { _u16(p + 2) } << 16);
+}
+static inline int32_t _i32(const unsigned char* p)
+{
+    return static_cast<int32_t>(_u32(p));
+}
+static inline float _f32(const unsigned char* p)
+{
+    uint32_t bits = _u32(p);
+    float v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+/** Locations of the sections of a binary scene, validated against the size
+ * of the data. */
+struct Layout {
+    LCS_ERROR parse(const unsigned char* data, size_t size)
+    {
+        if (!is_binary(data, size)) {
+            return ERROR(Error::INVALID_BINARY_FORMAT);
+        }
+        _data = data;
+        if (_u16(data + 4) > FORMAT_VERSION) {
+            L_ERROR("Binary scene version %d is not supported.",
+                _u16(data + 4));
+            return ERROR(Error::INVALID_BINARY_FORMAT);
+        }
+        flags     = _u16(data + 6);
+        strings_s = _u32(data + 8);
+        if (strings_s == 0 || strings_s % 4 != 0
+            || HEADER_SIZE + strings_s > size
+            || data[HEADER_SIZE + strings_s - 1] != '\0') {
+            return ERROR(Error::INVALID_BINARY_FORMAT);
+        }
+        size_t node_s = 0;
+        size_t offset = HEADER_SIZE + strings_s;
+        for (size_t s = 0; s < POSITION; s++) {
+            count[s] = _u32(data + COUNT_OFFSET + 4 * s);
+            if (s >= GATE && s <= COMPONENT) {
+                node_s += count[s];
+            }
+        }
+        count[POSITION] = flags & HAS_POSITIONS ? node_s : 0;
+        for (size_t s = 0; s < SECTION_S; s++) {
+            section[s] = offset;
+            offset += count[s] * RECORD_SIZE[s];
+            if (offset > size) {
+                return ERROR(Error::INVALID_BINARY_FORMAT);
+            }
+        }
+        for (const uint32_t str :
+            { _u32(data + 12), _u32(data + 16), _u32(data + 20) }) {
+            if (str != NO_STRING && str >= strings_s) {
+                return ERROR(Error::INVALID_BINARY_FORMAT);
+            }
+        }
+        return OK;
+    }
+
+    /* Returns the string at offset, nullptr if it is out of bounds. */
+    const char* string(uint32_t offset) const
+    {
+        if (offset >= strings_s) {
+            return nullptr;
+        }
+        return reinterpret_cast<const char*>(_data + HEADER_SIZE + offset);
+    }
+    const unsigned char* record(Section s, size_t i) const
+    {
+        return _data + section[s] + i * RECORD_SIZE[s];
+    }
+    /* Returns the position of the ith node of a node section. */
+    Point position(Section s, size_t i) const
+    {
+        if (!(flags & HAS_POSITIONS)) {
+            return Point { 0, 0 };
+        }
+        for (size_t prev = GATE; prev < s; prev++) {
+            i += count[prev];
+        }
+        const unsigned char* p = record(POSITION, i);
+        return Point { _i32(p), _i32(p + 4) };
+    }
+    const char* name(void) const { return string(_u32(_data + 12)); }
+    const char* author(void) const { return string(_u32(_data + 16)); }
+    const char* description(void) const { return string(_u32(_data + 20)); }
+    int32_t version(void) const { return _i32(_data + 24); }
+    uint16_t component_inputs(void) const { return _u16(_data + 28); }
+    uint16_t component_outputs(void) const { return _u16(_data + 30); }
+
+    uint16_t flags;
+    uint32_t strings_s;
+    size_t count[SECTION_S];
+    size_t section[SECTION_S];
+
+private:
+    const unsigned char* _data;
+};
+
+/* Reads a node reference of a relation record. */
+static Error _read_node(const unsigned char* p, Node& node)
+{
+    if (_u8(p + 2) >= NodeType::NODE_S) {
+        return ERROR(Error::INVALID_BINARY_FORMAT);
+    }
+    node = Node { _u16(p), static_cast<NodeType>(_u8(p + 2)) };
+    return OK;
+}
+
+bool is_binary(const unsigned char* data, size_t size)
+{
+    return size >= HEADER_SIZE && std::memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+bool is_binary_path(const std::string& path)
+{
+    size_t suffix_s = std::strlen(SUFFIX);
+    return path.size() >= suffix_s
+        && path.compare(path.size() - suffix_s, suffix_s, SUFFIX) == 0;
+}
+
+/* Strings of a binary scene, each distinct string is stored once. */
+class StringTable {
+public:
+    uint32_t add(const std::string& str)
+    {
+        auto [iter, is_new] = _offsets.emplace(str, _data.size());
+        if (is_new) {
+            _data.insert(_data.end(), str.begin(), str.end());
+            _data.push_back('\0');
+        }
+        return iter->second;
+    }
+    std::string& data(void)
+    {
+        _data.resize(_align(_data.size()), '\0');
+        return _data;
+    }
+
+private:
+    std::map<std::string, uint32_t> _offsets;
+    std::string _data;
+};
+
+Error from_json(const Json::Value& doc, std::vector<unsigned char>& data)
+{
+    static constexpr NodeType _types[] = { NodeType::GATE, NodeType::INPUT,
+        NodeType::OUTPUT, NodeType::COMPONENT };
+    if (!(doc.isObject() && doc["nodes"].isObject() && doc["name"].isString()
+            && doc["author"].isString() && doc["version"].isInt())) {
+        return ERROR(Error::INVALID_SCENE);
+    }
+    StringTable strings;
+    uint32_t name        = strings.add(doc["name"].asString());
+    uint32_t author      = strings.add(doc["author"].asString());
+    uint32_t description = doc["description"].isString()
+        ? strings.add(doc["description"].asString())
+        : NO_STRING;
+    uint16_t flags           = 0;
+    const Json::Value& nodes = doc["nodes"];
+    const Json::Value& rel   = doc["rel"];
+    const Json::Value& deps  = doc["dependencies"];
+
+    std::vector<unsigned char> records[SECTION_S];
+    for (const Json::Value& dep : deps) {
+        if (!dep.isString()) {
+            return ERROR(Error::INVALID_DEPENDENCY_FORMAT);
+        }
+        Writer { records[DEPENDENCY] }.u32(strings.add(dep.asString()));
+    }
+    for (size_t t = 0; t < 4; t++) {
+        Section section = static_cast<Section>(GATE + t);
+        const Json::Value& map = nodes[NodeType_to_str(_types[t])];
+        if (!map.isNull() && !map.isObject()) {
+            return ERROR(Error::INVALID_NODE);
+        }
+        for (auto iter = map.begin(); iter != map.end(); iter++) {
+            const Json::Value& value = *iter;
+            long id = std::atol(iter.key().asCString());
+            if (id <= 0 || id > UINT16_MAX) {
+                return ERROR(Error::INVALID_NODE);
+            }
+            Writer w { records[section] };
+            w.u16(id);
+            Point point { 0, 0 };
+            if (value["pos"].isObject()) {
+                (void)point.from_json(value["pos"]);
+            }
+            Writer { records[POSITION] }.i32(point.x);
+            Writer { records[POSITION] }.i32(point.y);
+            if (point.x != 0 || point.y != 0) {
+                flags |= HAS_POSITIONS;
+            }
+
+            if (section == GATE) {
+                if (!value["type"].isString()) {
+                    return ERROR(Error::INVALID_GATE);
+                }
+                size_t type = 0;
+                while (type < GateType::GATE_S
+                    && value["type"].asString()
+                        != GateType_to_str(static_cast<GateType>(type))) {
+                    type++;
+                }
+                if (type == GateType::GATE_S
+                    || (value["size"].isInt()
+                        && (value["size"].asInt() < 1
+                            || value["size"].asInt() > UINT8_MAX))) {
+                    return ERROR(Error::INVALID_GATE);
+                }
+                w.u8(type);
+                w.u8(value["size"].isInt() ? value["size"].asInt() : 0);
+            } else if (section == INPUT) {
+                if (value["freq"].isNumeric()) {
+                    w.u8(INPUT_CLOCK);
+                    w.u8(0);
+                    w.f32(value["freq"].asFloat());
+                    w.f32(value["phase"].isNumeric()
+                            ? value["phase"].asFloat()
+                            : 0);
+                } else if (value["data"].isBool()) {
+                    w.u8(value["data"].asBool() ? INPUT_VALUE : 0);
+                    w.u8(0);
+                    w.f32(0);
+                    w.f32(0);
+                } else {
+                    return ERROR(Error::INVALID_INPUT);
+                }
+            } else if (section == OUTPUT) {
+                w.u16(0);
+            } else if (section == COMPONENT) {
+                if (!value["use"].isString()) {
+                    return ERROR(Error::INVALID_COMPONENT);
+                }
+                w.u16(0);
+                w.u32(strings.add(value["use"].asString()));
+            }
+        }
+    }
+    if (!(flags & HAS_POSITIONS)) {
+        records[POSITION].clear();
+    }
+    for (auto iter = rel.begin(); iter != rel.end(); iter++) {
+        Rel r;
+        if (Error err = r.from_json(*iter); err) {
+            return err;
+        }
+        Writer w { records[RELATION] };
+        w.u32(std::atol(iter.key().asCString()));
+        for (const auto& [node, sock] :
+            { std::pair { r.from_node, r.from_sock },
+                std::pair { r.to_node, r.to_sock } }) {
+            w.u16(node.id);
+            w.u8(node.type);
+            w.u8(sock);
+        }
+    }
+    uint16_t component_in = 0, component_out = 0;
+    if (doc["component"].isObject()) {
+        const Json::Value& ctx = doc["component"];
+        if (!(ctx["in"].isInt() && ctx["out"].isInt())) {
+            return ERROR(Error::INVALID_COMPONENT);
+        }
+        flags |= IS_COMPONENT;
+        component_in  = ctx["in"].asInt();
+        component_out = ctx["out"].asInt();
+    }
+
+    const std::string& table = strings.data();
+    data.clear();
+    Writer w { data };
+    w.bytes(MAGIC, sizeof(MAGIC));
+    w.u16(FORMAT_VERSION);
+    w.u16(flags);
+    w.u32(table.size());
+    w.u32(name);
+    w.u32(author);
+    w.u32(description);
+    w.i32(doc["version"].asInt());
+    w.u16(component_in);
+    w.u16(component_out);
+    for (size_t s = 0; s < POSITION; s++) {
+        w.u32(records[s].size() / RECORD_SIZE[s]);
+    }
+    lcs_assert(data.size() == HEADER_SIZE);
+    w.bytes(table.data(), table.size());
+    for (size_t s = 0; s < SECTION_S; s++) {
+        w.bytes(records[s].data(), records[s].size());
+    }
+    return OK;
+}
+
+Error to_json(const unsigned char* data, size_t size, Json::Value& doc)
+{
+    static constexpr NodeType _types[] = { NodeType::GATE, NodeType::INPUT,
+        NodeType::OUTPUT, NodeType::COMPONENT };
+    Layout l;
+    if (Error err = l.parse(data, size); err) {
+        return err;
+    }
+    doc           = Json::Value { Json::objectValue };
+    doc["name"]   = l.name();
+    doc["author"] = l.author();
+    if (l.description() != nullptr) {
+        doc["description"] = l.description();
+    }
+    doc["version"] = l.version();
+    if (l.count[DEPENDENCY] != 0) {
+        Json::Value deps { Json::arrayValue };
+        for (size_t i = 0; i < l.count[DEPENDENCY]; i++) {
+            const char* dep = l.string(_u32(l.record(DEPENDENCY, i)));
+            if (dep == nullptr) {
+                return ERROR(Error::INVALID_BINARY_FORMAT);
+            }
+            deps.append(dep);
+        }
+        doc["dependencies"] = deps;
+    }
+
+    doc["nodes"] = Json::Value { Json::objectValue };
+    for (size_t t = 0; t < 4; t++) {
+        Section section = static_cast<Section>(GATE + t);
+        if (l.count[section] == 0) {
+            continue;
+        }
+        Json::Value map { Json::objectValue };
+        for (size_t i = 0; i < l.count[section]; i++) {
+            const unsigned char* p = l.record(section, i);
+            Json::Value value;
+            if (section == GATE) {
+                if (_u8(p + 2) >= GateType::GATE_S) {
+                    return ERROR(Error::INVALID_BINARY_FORMAT);
+                }
+                value["type"] = GateType_to_str(static_cast<GateType>(p[2]));
+                if (_u8(p + 3) != 0) {
+                    value["size"] = _u8(p + 3);
+                }
+            } else if (section == INPUT) {
+                if (_u8(p + 2) & INPUT_CLOCK) {
+                    value["freq"] = _f32(p + 4);
+                    if (_f32(p + 8) != 0) {
+                        value["phase"] = _f32(p + 8);
+                    }
+                } else {
+                    value["data"] = (_u8(p + 2) & INPUT_VALUE) != 0;
+                }
+            } else if (section == COMPONENT) {
+                const char* use = l.string(_u32(p + 4));
+                if (use == nullptr) {
+                    return ERROR(Error::INVALID_BINARY_FORMAT);
+                }
+                value["use"] = use;
+            }
+            Point point = l.position(section, i);
+            if (point.x != 0 || point.y != 0) {
+                value["pos"] = point.to_json();
+            }
+            map[std::to_string(_u16(p))] = value;
+        }
+        doc["nodes"][NodeType_to_str(_types[t])] = map;
+    }
+
+    if (l.count[RELATION] != 0) {
+        Json::Value rels { Json::objectValue };
+        for (size_t i = 0; i < l.count[RELATION]; i++) {
+            const unsigned char* p = l.record(RELATION, i);
+            Rel r;
+            if (Error err = _read_node(p + 4, r.from_node); err) {
+                return err;
+            }
+            if (Error err = _read_node(p + 8, r.to_node); err) {
+                return err;
+            }
+            r.from_sock                   = _u8(p + 7);
+            r.to_sock                     = _u8(p + 11);
+            rels[std::to_string(_u32(p))] = r.to_json();
+        }
+        doc["rel"] = rels;
+    }
+    if (l.flags & IS_COMPONENT) {
+        Json::Value ctx { Json::objectValue };
+        ctx["in"]        = l.component_inputs();
+        ctx["out"]       = l.component_outputs();
+        doc["component"] = ctx;
+    }
+    return OK;
+}
+
+/* Copies a string of the header to a fixed size field of the scene. */
+template <size_t N>
+static Error _copy(const char* str, std::array<char, N>& field, Error err)
+{
+    if (str == nullptr) {
+        return ERROR(Error::INVALID_BINARY_FORMAT);
+    }
+    size_t len = std::strlen(str);
+    if (len >= N) {
+        return ERROR(err);
+    }
+    std::copy(str, str + len, field.begin());
+    return OK;
+}
+
+/* Inserts the nodes of a section, keeping the position of each node. init
+ * creates the node from its record. */
+template <typename T, typename F>
+static Error _load_nodes(
+    Scene& scene, const Layout& l, Section section, SlotMap<T>& map, F init)
+{
+    constexpr NodeType type = as_node_type<T>();
+    if (l.count[section] == 0) {
+        return OK;
+    }
+    Node last_id { 0, type };
+    Error err = OK;
+    for (size_t i = 0; i < l.count[section]; i++) {
+        const unsigned char* p = l.record(section, i);
+        Node id { _u16(p), type };
+        if (id.id > last_id.id) {
+            last_id = id;
+        }
+        auto [iter, is_new] = map.emplace(id, init(id, p, err));
+        if (err) {
+            return err;
+        }
+        if (!is_new) {
+            return ERROR(Error::INVALID_BINARY_FORMAT);
+        }
+        iter->second.point = l.position(section, i);
+        if constexpr (std::is_same<T, InputNode>::value) {
+            if (!iter->second.is_timer() && (_u8(p + 2) & INPUT_VALUE)) {
+                iter->second.set(true);
+            }
+        }
+    }
+    scene._last_node[type] = last_id;
+    return OK;
+}
+
+/* Reads the dependencies of a binary scene without loading it. Scenes that
+ * can't be read have no dependencies, loading them reports the error. */
+void _read_dependencies(const unsigned char* data, size_t size,
+    std::vector<std::string>& dependencies)
+{
+    Layout l;
+    if (l.parse(data, size)) {
+        return;
+    }
+    for (size_t i = 0; i < l.count[DEPENDENCY]; i++) {
+        const char* dep = l.string(_u32(l.record(DEPENDENCY, i)));
+        dependencies.push_back(dep != nullptr ? dep : "");
+    }
+}
+
+/* Reads the header of a binary component into entry without loading its
+ * nodes or its dependencies. Returns false if the file is not a component. */
+bool _read_header(
+    const unsigned char* data, size_t size, component::Entry& entry)
+{
+    Layout l;
+    decltype(Scene::name) name {};
+    decltype(Scene::author) author {};
+    if (l.parse(data, size) || !(l.flags & IS_COMPONENT)
+        || _copy(l.name(), name, Error::INVALID_SCENE_NAME)
+        || _copy(l.author(), author, Error::INVALID_AUTHOR_NAME)) {
+        return false;
+    }
+    entry.dependencies.clear();
+    for (size_t i = 0; i < l.count[DEPENDENCY]; i++) {
+        const char* dep = l.string(_u32(l.record(DEPENDENCY, i)));
+        if (dep == nullptr) {
+            return false;
+        }
+        entry.dependencies.push_back(dep);
+    }
+    entry.name     = name.data();
+    entry.author   = author.data();
+    entry.version  = l.version();
+    entry.input_s  = l.component_inputs();
+    entry.output_s = l.component_outputs();
+    return true;
+}
+
+Error load(const unsigned char* data, size_t size, Scene& scene)
+{
+    Layout l;
+    if (Error err = l.parse(data, size); err) {
+        return err;
+    }
+    if (Error err = _copy(l.name(), scene.name, Error::INVALID_SCENE_NAME);
+        err) {
+        return err;
+    }
+    if (Error err
+        = _copy(l.author(), scene.author, Error::INVALID_AUTHOR_NAME);
+        err) {
+        return err;
+    }
+    if (l.description() != nullptr) {
+        if (Error err = _copy(
+                l.description(), scene.description, INVALID_DESCRIPTION);
+            err) {
+            return err;
+        }
+    }
+    scene.version = l.version();
+    for (size_t i = 0; i < l.count[DEPENDENCY]; i++) {
+        const char* dep = l.string(_u32(l.record(DEPENDENCY, i)));
+        if (dep == nullptr) {
+            return ERROR(Error::INVALID_BINARY_FORMAT);
+        }
+        scene.dependencies.push_back(dep);
+    }
+    if (Error err = io::component::fetch_all(scene.dependencies); err) {
+        return err;
+    }
+
+    /* Relations are connected without propagating, the scene is settled
+     * once at the end. */
+    Scene::Batch batch { scene };
+    if (l.flags & IS_COMPONENT) {
+        scene.component_context = ComponentContext { &scene };
+        scene.component_context->setup(
+            l.component_inputs(), l.component_outputs());
+    }
+    Error err = _load_nodes<GateNode>(scene, l, GATE, scene._gates,
+        [&](Node id, const unsigned char* p, Error& err) {
+            if (_u8(p + 2) >= GateType::GATE_S) {
+                L_ERROR("Invalid gate type %d.", _u8(p + 2));
+                err = Error::INVALID_BINARY_FORMAT;
+                return GateNode { &scene, id, GateType::NOT };
+            }
+            GateNode gate { &scene, id, static_cast<GateType>(_u8(p + 2)) };
+            while (gate.inputs.size() < _u8(p + 3) && gate.increment()) { }
+            return gate;
+        });
+    if (err) {
+        return err;
+    }
+    err = _load_nodes<ComponentNode>(scene, l, COMPONENT, scene._components,
+        [&](Node id, const unsigned char* p, Error& err) {
+            ComponentNode comp { &scene, id };
+            const char* use = l.string(_u32(p + 4));
+            if (use == nullptr) {
+                L_ERROR("Invalid component path.");
+                err = Error::INVALID_BINARY_FORMAT;
+            } else {
+                err = comp.set_component(use);
+            }
+            return comp;
+        });
+    if (err) {
+        return err;
+    }
+    err = _load_nodes<InputNode>(scene, l, INPUT, scene._inputs,
+        [&](Node id, const unsigned char* p, Error&) {
+            InputNode input { &scene, id };
+            if (_u8(p + 2) & INPUT_CLOCK) {
+                input.set_clock(_f32(p + 4), _f32(p + 8));
+            }
+            return input;
+        });
+    if (err) {
+        return err;
+    }
+    err = _load_nodes<OutputNode>(scene, l, OUTPUT, scene._outputs,
+        [&](Node id, const unsigned char*, Error&) {
+            return OutputNode { &scene, id };
+        });
+    if (err) {
+        return err;
+    }
+
+    for (size_t i = 0; i < l.count[RELATION]; i++) {
+        const unsigned char* p = l.record(RELATION, i);
+        Node from, to;
+        if (Error err = _read_node(p + 4, from); err) {
+            return err;
+        }
+        if (Error err = _read_node(p + 8, to); err) {
+            return err;
+        }
+        relid id = _u32(p);
+        if (id > scene._last_rel) {
+            scene._last_rel = id;
+        }
+        if (scene._connect_with_id(id, to, _u8(p + 11), from, _u8(p + 7))) {
+            return ERROR(Error::REL_CONNECT_ERROR);
+        }
+    }
+
+    for (auto& comp : scene._components) {
+        if (std::find(scene.dependencies.begin(), scene.dependencies.end(),
+                comp.second.path)
+            == scene.dependencies.end()) {
+            return ERROR(Error::UNDEFINED_DEPENDENCY);
+        }
+    }
+    return OK;
+}
+
+Error convert(const std::string& from, const std::string& to)
+{
+    std::vector<unsigned char> data;
+    if (!read(from, data) || data.empty()) {
+        return ERROR(Error::NOT_FOUND);
+    }
+    Json::Value doc;
+    if (is_binary(data.data(), data.size())) {
+        if (Error err = to_json(data.data(), data.size(), doc); err) {
+            return err;
+        }
+    } else {
+        Json::Reader reader {};
+        const char* begin = reinterpret_cast<const char*>(data.data());
+        if (!reader.parse(begin, begin + data.size(), doc)) {
+            return ERROR(Error::INVALID_JSON_FORMAT);
+        }
+    }
+
+    if (is_binary_path(to)) {
+        if (Error err = from_json(doc, data); err) {
+            return err;
+        }
+        if (!write(to, data)) {
+            return ERROR(Error::WRITE_FAILED);
+        }
+    } else if (!write(to, doc.toStyledString())) {
+        return ERROR(Error::WRITE_FAILED);
+    }
+    return OK;
+}
+
+} // namespace lcs::io::binary
@@ -1,11 +1,31 @@
 #include "io.h"
 #include "common.h"
 #include "core.h"
+#include "worker_pool.h"
 #include <base64.h>
 #include <json/json.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <shared_mutex>
 #include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace lcs::io {
 
@@ -23,27 +43,252 @@ struct Inode {
     Scene scene;
 };
 static std::string current_path;
-static std::map<std::string, Scene> COMPONENT_STORAGE;
+/* Loaded components are shared with the versions that may still be running
+ * them, see component::Version. */
+static std::map<std::string, std::shared_ptr<Scene>> COMPONENT_STORAGE;
+/* Serializes loading components against threads that resolve a component
+ * while another one is loaded. Recursive, since installing a component
+ * evaluates the components it depends on. */
+static std::recursive_mutex _storage_lock;
+/* Guards the map itself. It is only held for a lookup or an insertion, so
+ * it can be taken by the loader threads while _storage_lock is held. */
+static std::shared_mutex _map_lock;
+
+/* Returns the loaded component, nullptr if it is not loaded. */
+static std::shared_ptr<Scene> _find(const std::string& name)
+{
+    std::shared_lock<std::shared_mutex> lock { _map_lock };
+    auto cmp = COMPONENT_STORAGE.find(name);
+    return cmp != COMPONENT_STORAGE.end() ? cmp->second : nullptr;
+}
+
+static void _install(const std::string& name, std::shared_ptr<Scene> scene)
+{
+    std::unique_lock<std::shared_mutex> lock { _map_lock };
+    COMPONENT_STORAGE.insert_or_assign(name, std::move(scene));
+}
+
+/* Serializes the runs and the clock toggles of a loaded component with
+ * clocks. Kept for each scene, since every version of the component shares
+ * its scene. */
+static std::mutex& _clock_lock(const Scene* scene)
+{
+    static std::mutex lock;
+    static std::unordered_map<const Scene*, std::unique_ptr<std::mutex>> locks;
+    std::lock_guard<std::mutex> guard { lock };
+    auto& clock_lock = locks[scene];
+    if (clock_lock == nullptr) {
+        clock_lock = std::make_unique<std::mutex>();
+    }
+    return *clock_lock;
+}
+
+namespace component {
+    /* A loaded component and its truth table, as io::component::run sees
+     * them. Reloading a component publishes a new version instead of
+     * modifying this one, so threads that still run it keep it alive. */
+    struct Version {
+        compid id           = 0;
+        uint32_t generation = 0;
+        /* nullptr if the component couldn't be loaded. */
+        std::shared_ptr<Scene> scene;
+        /* Results indexed by the input. An empty table marks a component
+         * that is simulated on each run. */
+        std::vector<uint64_t> table;
+        /* Lock of the scene if the component has clocks, nullptr
+         * otherwise, see _clock_lock. */
+        std::mutex* clock_lock = nullptr;
+    };
+} // namespace component
+
+/* A component name that was interned by io::component::intern. */
+struct Interned {
+    std::string name;
+    /* Current version, only accessed with std::atomic_load and
+     * std::atomic_store. */
+    std::shared_ptr<const component::Version> version;
+};
+/* Interned components are allocated in chunks that never move, so an id is
+ * resolved without a lock while other threads intern new names. */
+constexpr size_t INTERN_CHUNK = 1024;
+static std::unique_ptr<Interned[]> INTERNED[1024];
+static std::atomic<compid> _interned_s { 1 };
+static std::unordered_map<std::string, compid> _interned_ids;
+static std::mutex _intern_lock;
+static size_t _truth_table_limit = component::TRUTH_TABLE_LIMIT;
+static std::atomic<uint32_t> _revision { 0 };
+/* Since components can depend on each other, versions of every component are
+ * outdated when a component is reloaded. */
+static std::atomic<uint32_t> _generation { 1 };
+
+/* Called whenever a loaded component is replaced. */
+static void _on_component_reload(void)
+{
+    _revision++;
+    _generation++;
+}
 static std::vector<Inode> SCENE_STORAGE;
 static size_t active_scene = SIZE_MAX;
 static bool _has_changes   = false;
 
+static bool _is_turbo         = false;
+static uint32_t _turbo_budget = scene::TURBO_BUDGET;
+static std::optional<std::chrono::steady_clock::time_point> _last_frame;
+
+/* While the simulation thread is running, SCENE_STORAGE and active_scene are
+ * only modified on it. Other threads queue their changes as edits and wait
+ * for them, so they can keep reading the scenes without a lock. */
+struct Edit {
+    std::function<void(void)> run;
+    std::promise<void> done;
+};
+static std::thread _simulation;
+static std::mutex _edit_lock;
+static std::condition_variable _wake;
+static std::vector<Edit> _edits;
+static bool _is_running = false;
+
+/* Snapshots of the active scene. The simulation thread captures to the back
+ * buffer and swaps it with the middle one, the reader swaps the middle one
+ * with the front buffer when it has been published since its last read. */
+static constexpr uint8_t SNAPSHOT_NEW = 4;
+static std::array<scene::Snapshot, 3> _snapshots;
+static std::atomic<uint8_t> _snapshot_middle { 1 };
+static uint8_t _snapshot_back      = 2;
+static uint8_t _snapshot_front     = 0;
+static uint64_t _snapshot_revision = 0;
+
+/* Runs fn on the simulation thread and waits for it. Runs fn immediately if
+ * the simulation thread is not running or fn is called from it. */
+static void _sync(std::function<void(void)> fn)
+{
+    if (!_simulation.joinable()
+        || std::this_thread::get_id() == _simulation.get_id()) {
+        fn();
+        return;
+    }
+    std::future<void> done;
+    {
+        std::lock_guard<std::mutex> lock { _edit_lock };
+        _edits.push_back(Edit { std::move(fn), {} });
+        done = _edits.back().done.get_future();
+    }
+    _wake.notify_one();
+    done.wait();
+}
+
+/* Saves that are written in the background, in the order they were started.
+ * Every write, including the synchronous ones, waits for the previous one in
+ * _last_write, so the last save of a file is the one that remains. */
+struct PendingSave {
+    std::string path;
+    std::shared_future<bool> is_written;
+};
+static std::mutex _save_lock;
+static std::vector<PendingSave> _saves;
+static std::shared_future<bool> _last_write;
+
 Error load(const std::string& data, Scene& s)
 {
     if (data == "") {
         return ERROR(Error::NOT_FOUND);
     }
-    Json::Reader reader {};
-    Json::Value root;
-    if (!reader.parse(data, root)) {
-        return ERROR(Error::INVALID_JSON_FORMAT);
+    return load_json(data.data(), data.size(), s);
+}
+
+/* A read-only view of a file. Files are mapped to memory where supported, so
+ * they are parsed without copying them first. */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path)
+    {
+#ifdef _WIN32
+        if (read(path, _buffer)) {
+            _data = _buffer.data();
+            _size = _buffer.size();
+        }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* map
+                = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                _data = static_cast<const unsigned char*>(map);
+                _size = st.st_size;
+            }
+        }
+        ::close(fd);
+#endif
     }
-    return s.from_json(root);
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile(MappedFile&&)                 = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&)      = delete;
+    ~MappedFile()
+    {
+#ifndef _WIN32
+        if (_data != nullptr) {
+            munmap(const_cast<unsigned char*>(_data), _size);
+        }
+#endif
+    }
+
+    inline const unsigned char* data(void) const { return _data; }
+    inline size_t size(void) const { return _size; }
+
+private:
+    const unsigned char* _data = nullptr;
+    size_t _size               = 0;
+#ifdef _WIN32
+    std::vector<unsigned char> _buffer;
+#endif
+};
+
+Error load_file(const std::string& path, Scene& s)
+{
+    MappedFile file { path };
+    if (file.size() == 0) {
+        return ERROR(Error::NOT_FOUND);
+    }
+    if (binary::is_binary(file.data(), file.size())) {
+        return binary::load(file.data(), file.size(), s);
+    }
+    return load_json(
+        reinterpret_cast<const char*>(file.data()), file.size(), s);
+}
+
+/* Writes a scene document to path, in the binary format if path has
+ * io::binary::SUFFIX. Components are only read from the library, so their
+ * JSON is minified. */
+static bool _write_doc(const std::string& path, const Json::Value& doc)
+{
+    if (!binary::is_binary_path(path)) {
+        return write(path,
+            to_text(doc, doc.isMember("component") ? MINIFIED : STYLED));
+    }
+    std::vector<unsigned char> data;
+    if (binary::from_json(doc, data)) {
+        return false;
+    }
+    return write(path, data);
+}
+
+/* Returns the library path of a component, keeping the binary format if
+ * the component is already stored in it. */
+static std::string _component_path(const Scene& s)
+{
+    fs::path path = s.to_filepath();
+    path.replace_extension(binary::SUFFIX);
+    return fs::exists(path) ? path.string() : s.to_filepath();
 }
 
 namespace scene {
 
-    Error open(const std::string& path, size_t& idx)
+    static Error _open(const std::string& path, size_t& idx)
     {
         for (size_t i = 0; i < SCENE_STORAGE.size(); i++) {
             if (SCENE_STORAGE[i].path == path) {
@@ -56,8 +301,7 @@ namespace scene {
             }
         }
         Inode inode { true, path, Scene {} };
-        std::string data = read(path);
-        Error err        = io::load(data, inode.scene);
+        Error err = io::load_file(path, inode.scene);
         if (err) {
             return err;
         }
@@ -68,7 +312,14 @@ namespace scene {
         return OK;
     }
 
-    Error close(size_t idx)
+    Error open(const std::string& path, size_t& idx)
+    {
+        Error err = OK;
+        _sync([&]() { err = _open(path, idx); });
+        return err;
+    }
+
+    static void _close(size_t idx)
     {
         if (idx == SIZE_MAX) {
             idx = active_scene;
@@ -79,6 +330,11 @@ namespace scene {
             active_scene--;
             _has_changes = true;
         }
+    }
+
+    Error close(size_t idx)
+    {
+        _sync([&]() { _close(idx); });
         return OK;
     }
 
@@ -102,7 +358,12 @@ namespace scene {
         return SCENE_STORAGE[idx].is_saved;
     }
 
-    Error save(size_t idx)
+    /* Serializes the scene at idx to be saved. Components are saved to their
+     * library path, and dependency is set if their loaded copy has to be
+     * replaced once they are written. path is left empty if the scene has no
+     * changes. */
+    static Error _serialize(size_t idx, std::string& path, Json::Value& doc,
+        std::string& dependency)
     {
         if (idx == SIZE_MAX) {
             idx = active_scene;
@@ -115,31 +376,41 @@ namespace scene {
         }
 
         if (inode.scene.component_context.has_value()) {
-            inode.path = inode.scene.to_filepath();
+            inode.path = _component_path(inode.scene);
         }
-
-        if (!write(inode.path, inode.scene.to_json().toStyledString())) {
+        if (inode.path.empty()) {
             return ERROR(Error::NO_SAVE_PATH_DEFINED);
         }
+        doc            = inode.scene.to_json();
+        path           = inode.path;
         inode.is_saved = true;
-        // Reload component storage if saved scene is a component
         if (inode.scene.component_context.has_value()) {
-            std::string dependency_string = inode.scene.to_dependency();
-            if (auto compiter = COMPONENT_STORAGE.find(dependency_string);
-                compiter != COMPONENT_STORAGE.end()) {
-                COMPONENT_STORAGE.insert_or_assign(dependency_string, Scene {});
-                Scene s;
-                Error err = COMPONENT_STORAGE[dependency_string].from_json(
-                    inode.scene.to_json());
-                if (err) { // FIXME later
-                    return err;
-                }
-            }
+            dependency = inode.scene.to_dependency();
         }
         return OK;
     }
 
-    Error save_as(const std::string& new_path, size_t idx)
+    /* Replaces the loaded copy of a component after it is written. */
+    static void _reload(const std::string& dependency, const Json::Value& doc)
+    {
+        std::lock_guard<std::recursive_mutex> lock { _storage_lock };
+        if (_find(dependency) == nullptr) {
+            return;
+        }
+        /* Parsed before it is installed, so other threads never see a
+         * partially loaded component. */
+        auto comp = std::make_shared<Scene>();
+        if (comp->from_json(doc)) {
+            L_ERROR("Failed to reload %s.", dependency.c_str());
+            return;
+        }
+        _install(dependency, comp);
+        _on_component_reload();
+    }
+
+    /* Moves the scene at idx to new_path. Returns false if it is already
+     * there. */
+    static bool _move(const std::string& new_path, size_t idx)
     {
         if (idx == SIZE_MAX) {
             idx = active_scene;
@@ -147,17 +418,158 @@ namespace scene {
         lcs_assert(idx < SCENE_STORAGE.size());
         Inode& inode = SCENE_STORAGE[idx];
         if (inode.path == new_path) {
-            return OK;
+            return false;
         }
         inode.path     = new_path;
         inode.is_saved = false;
-        Error err      = save(idx);
-        if (err) {
+        return true;
+    }
+
+    /* Marks the scenes at path as unsaved after their write has failed. */
+    static void _on_save_failed(const std::string& path)
+    {
+        _sync([&]() {
+            for (Inode& inode : SCENE_STORAGE) {
+                if (inode.path == path) {
+                    inode.is_saved = false;
+                    _has_changes   = true;
+                }
+            }
+        });
+    }
+
+    static Error _write(const std::string& path, const Json::Value& doc,
+        const std::string& dependency)
+    {
+        std::promise<bool> is_written;
+        std::shared_future<bool> last;
+        {
+            std::lock_guard<std::mutex> lock { _save_lock };
+            last        = _last_write;
+            _last_write = is_written.get_future().share();
+        }
+        if (last.valid()) {
+            last.wait();
+        }
+        bool is_ok = _write_doc(path, doc);
+        if (is_ok && !dependency.empty()) {
+            _reload(dependency, doc);
+        }
+        is_written.set_value(is_ok);
+        if (!is_ok) {
+            _on_save_failed(path);
+            return ERROR(Error::WRITE_FAILED);
+        }
+        return OK;
+    }
+
+    static void _write_async(
+        const std::string& path, Json::Value doc, std::string dependency)
+    {
+        std::lock_guard<std::mutex> lock { _save_lock };
+        _saves.push_back(PendingSave { path,
+            std::async(std::launch::async,
+                [path, last = _last_write, doc = std::move(doc),
+                    dependency = std::move(dependency)]() {
+                    if (last.valid()) {
+                        last.wait();
+                    }
+                    bool is_ok = _write_doc(path, doc);
+                    if (is_ok && !dependency.empty()) {
+                        _reload(dependency, doc);
+                    }
+                    return is_ok;
+                })
+                .share() });
+        _last_write = _saves.back().is_written;
+    }
+
+    /* Serializes the scene at idx on the simulation thread, after moving it
+     * to new_path if one is given. The rest of the save runs on the calling
+     * thread or in the background. */
+    static Error _prepare(const std::string* new_path, size_t idx,
+        std::string& path, Json::Value& doc, std::string& dependency)
+    {
+        Error err = OK;
+        _sync([&]() {
+            if (new_path == nullptr || _move(*new_path, idx)) {
+                err = _serialize(idx, path, doc, dependency);
+            }
+        });
+        return err;
+    }
+
+    Error save(size_t idx)
+    {
+        std::string path, dependency;
+        Json::Value doc;
+        if (Error err = _prepare(nullptr, idx, path, doc, dependency); err) {
             return err;
         }
+        return path.empty() ? OK : _write(path, doc, dependency);
+    }
+
+    Error save_as(const std::string& new_path, size_t idx)
+    {
+        std::string path, dependency;
+        Json::Value doc;
+        if (Error err = _prepare(&new_path, idx, path, doc, dependency);
+            err) {
+            return err;
+        }
+        return path.empty() ? OK : _write(path, doc, dependency);
+    }
+
+    Error save_async(size_t idx)
+    {
+        std::string path, dependency;
+        Json::Value doc;
+        if (Error err = _prepare(nullptr, idx, path, doc, dependency); err) {
+            return err;
+        }
+        if (!path.empty()) {
+            _write_async(path, std::move(doc), std::move(dependency));
+        }
+        return OK;
+    }
+
+    Error save_as_async(const std::string& new_path, size_t idx)
+    {
+        std::string path, dependency;
+        Json::Value doc;
+        if (Error err = _prepare(&new_path, idx, path, doc, dependency);
+            err) {
+            return err;
+        }
+        if (!path.empty()) {
+            _write_async(path, std::move(doc), std::move(dependency));
+        }
         return OK;
     }
 
+    bool poll_save(SaveResult& result)
+    {
+        PendingSave save;
+        {
+            std::lock_guard<std::mutex> lock { _save_lock };
+            if (_saves.empty()
+                || _saves.front().is_written.wait_for(std::chrono::seconds(0))
+                    != std::future_status::ready) {
+                return false;
+            }
+            save = std::move(_saves.front());
+            _saves.erase(_saves.begin());
+        }
+        result.path = save.path;
+        result.err  = OK;
+        if (!save.is_written.get()) {
+            _on_save_failed(save.path);
+            result.err = Error::WRITE_FAILED;
+            L_ERROR("Failed to save %s.", save.path.c_str());
+        }
+        return true;
+    }
+
     NRef<Scene> get(size_t idx)
     {
         if (idx == SIZE_MAX) {
@@ -168,19 +580,25 @@ namespace scene {
         }
         if (idx != active_scene) {
             L_INFO("idx != active_scene");
-            _has_changes = true;
+            _sync([&]() {
+                active_scene = idx;
+                _has_changes = true;
+            });
         }
-        active_scene = idx;
         return &SCENE_STORAGE[idx].scene;
     }
 
     size_t create(const std::string& name, const std::string& author,
         const std::string& description, int version)
     {
-        SCENE_STORAGE.emplace_back(
-            false, "", Scene { name, author, description, version });
-        _has_changes = true;
-        return SCENE_STORAGE.size() - 1;
+        size_t idx = 0;
+        _sync([&]() {
+            SCENE_STORAGE.emplace_back(
+                false, "", Scene { name, author, description, version });
+            _has_changes = true;
+            idx          = SCENE_STORAGE.size() - 1;
+        });
+        return idx;
     }
 
     void iterate(std::function<bool(std::string_view name,
@@ -196,24 +614,227 @@ namespace scene {
             };
         }
         if (active_scene != updated_scene) {
-            _has_changes = true;
+            _sync([&]() {
+                active_scene = updated_scene;
+                _has_changes = true;
+            });
+        }
+    }
+
+    /* Advances the scene and the components it depends on to the given
+     * simulation time. */
+    /* Loaded components with clocks that the scene uses, directly or
+     * through other components. */
+    static std::vector<std::shared_ptr<Scene>> _clocked(const Scene& s)
+    {
+        std::vector<std::shared_ptr<Scene>> found;
+        std::unordered_set<std::string> visited;
+        auto visit = [&](const Scene& scene) {
+            for (const auto& compname : scene.dependencies) {
+                if (!visited.insert(compname).second) {
+                    continue;
+                }
+                if (auto comp = _find(compname); comp != nullptr) {
+                    found.push_back(std::move(comp));
+                }
+            }
+        };
+        visit(s);
+        for (size_t i = 0; i < found.size(); i++) {
+            visit(*found[i]);
+        }
+        found.erase(std::remove_if(found.begin(), found.end(),
+                        [](const auto& comp) {
+                            return comp->_scheduler.empty();
+                        }),
+            found.end());
+        return found;
+    }
+
+    static void _run_until(Scene& s,
+        const std::vector<std::shared_ptr<Scene>>& clocked, uint64_t time)
+    {
+        s.run_timers(time);
+        for (const auto& comp : clocked) {
+            std::lock_guard<std::mutex> lock { _clock_lock(comp.get()) };
+            comp->run_timers(time);
         }
-        active_scene = updated_scene;
+    }
+
+    /* Time of the next toggle of the scene and its components. */
+    static uint64_t _next(
+        Scene& s, const std::vector<std::shared_ptr<Scene>>& clocked)
+    {
+        uint64_t next = s._scheduler.next();
+        for (const auto& comp : clocked) {
+            std::lock_guard<std::mutex> lock { _clock_lock(comp.get()) };
+            next = std::min(next, comp->_scheduler.next());
+        }
+        return next;
+    }
+
+    static bool _step(
+        Scene& s, const std::vector<std::shared_ptr<Scene>>& clocked)
+    {
+        uint64_t next = _next(s, clocked);
+        if (next == UINT64_MAX) {
+            return false;
+        }
+        _run_until(s, clocked, next);
+        return true;
     }
 
     void run_frame(size_t idx)
     {
+        using namespace std::chrono;
         if (idx == SIZE_MAX) {
             idx = active_scene;
         }
         if (idx >= SCENE_STORAGE.size()) {
             return;
         }
-        SCENE_STORAGE[idx].scene.run_timers();
-        for (auto compname : SCENE_STORAGE[idx].scene.dependencies) {
-            COMPONENT_STORAGE.find(compname)->second.run_timers();
-            // FIX Component may not be fetched correctly
+        auto now      = steady_clock::now();
+        auto deadline = now + microseconds { _turbo_budget };
+        Scene& s      = SCENE_STORAGE[idx].scene;
+        auto clocked  = _clocked(s);
+        if (_is_turbo) {
+            while (_step(s, clocked) && steady_clock::now() < deadline) { }
+        } else if (_last_frame.has_value()) {
+            auto delta      = duration_cast<nanoseconds>(now - *_last_frame);
+            uint64_t target = s._scheduler.now()
+                + std::min<uint64_t>(delta.count(), FRAME_LIMIT);
+            /* Toggles are bounded by the time budget of the turbo mode. */
+            uint64_t next = _next(s, clocked);
+            for (; next <= target && steady_clock::now() < deadline;
+                next = _next(s, clocked)) {
+                _run_until(s, clocked, next);
+            }
+            if (next > target) {
+                _run_until(s, clocked, target);
+            }
         }
+        _last_frame = now;
+    }
+
+    bool step(size_t idx)
+    {
+        if (idx == SIZE_MAX) {
+            idx = active_scene;
+        }
+        if (idx >= SCENE_STORAGE.size()) {
+            return false;
+        }
+        Scene& s = SCENE_STORAGE[idx].scene;
+        return _step(s, _clocked(s));
+    }
+
+    void set_turbo(bool is_enabled, uint32_t budget)
+    {
+        _sync([&]() {
+            _is_turbo     = is_enabled;
+            _turbo_budget = budget;
+        });
+    }
+
+    bool is_turbo(void) { return _is_turbo; }
+
+    /* Captures the active scene to the back buffer and publishes it. */
+    static void _publish(void)
+    {
+        Snapshot& back = _snapshots[_snapshot_back];
+        if (active_scene < SCENE_STORAGE.size()) {
+            back.capture(SCENE_STORAGE[active_scene].scene);
+        }
+        back.revision  = _snapshot_revision++;
+        _snapshot_back = _snapshot_middle.exchange(
+                             _snapshot_back | SNAPSHOT_NEW,
+                             std::memory_order_acq_rel)
+            & ~SNAPSHOT_NEW;
+    }
+
+    /* Body of the simulation thread. */
+    static void _simulate(void)
+    {
+        std::vector<Edit> edits;
+        std::unique_lock<std::mutex> lock { _edit_lock };
+        while (true) {
+            bool is_running = _is_running;
+            edits.swap(_edits);
+            lock.unlock();
+            for (Edit& edit : edits) {
+                edit.run();
+            }
+            if (is_running) {
+                run_frame();
+            }
+            _publish();
+            for (Edit& edit : edits) {
+                edit.done.set_value();
+            }
+            edits.clear();
+            if (!is_running) {
+                break;
+            }
+            lock.lock();
+            if (_is_running && _edits.empty() && !_is_turbo) {
+                _wake.wait_for(
+                    lock, std::chrono::microseconds { FRAME_INTERVAL });
+            }
+        }
+    }
+
+    void start(void)
+    {
+        if (_simulation.joinable()) {
+            return;
+        }
+        _is_running = true;
+        _last_frame.reset();
+        _simulation = std::thread { _simulate };
+        L_INFO("Started the simulation thread.");
+    }
+
+    void stop(void)
+    {
+        if (!_simulation.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock { _edit_lock };
+            _is_running = false;
+        }
+        _wake.notify_one();
+        _simulation.join();
+        L_INFO("Stopped the simulation thread.");
+    }
+
+    bool is_running(void) { return _simulation.joinable(); }
+
+    void post(std::function<void(Scene&)> edit)
+    {
+        _sync([&]() {
+            if (active_scene < SCENE_STORAGE.size()) {
+                edit(SCENE_STORAGE[active_scene].scene);
+            }
+        });
+    }
+
+    NRef<const Snapshot> snapshot(void)
+    {
+        if (active_scene >= SCENE_STORAGE.size()) {
+            return nullptr;
+        }
+        if (!_simulation.joinable()) {
+            _snapshots[_snapshot_front].capture(
+                SCENE_STORAGE[active_scene].scene);
+            _snapshots[_snapshot_front].revision = _snapshot_revision++;
+        } else if (_snapshot_middle.load(std::memory_order_acquire)
+            & SNAPSHOT_NEW) {
+            _snapshot_front = _snapshot_middle.exchange(
+                                  _snapshot_front, std::memory_order_acq_rel)
+                & ~SNAPSHOT_NEW;
+        }
+        return &_snapshots[_snapshot_front];
     }
 
     bool has_changes(void)
@@ -229,70 +850,218 @@ namespace scene {
 
 } // namespace scene
 
+void _read_dependencies(
+    const char* data, size_t size, std::vector<std::string>& dependencies);
+namespace binary {
+    void _read_dependencies(const unsigned char* data, size_t size,
+        std::vector<std::string>& dependencies);
+} // namespace binary
+
 namespace component {
 
     void _load_stdlib(void);
+    bool _find_indexed(const std::string& name, std::string& path);
+
+    /* Returns the path of a component that is not in the index. */
+    static fs::path _library_path(const std::vector<std::string>& tokens)
+    {
+        /* Same file name as Scene::to_filepath. */
+        std::string file_name
+            = base64_encode(tokens[1] + "/" + tokens[2], true);
+        fs::path path;
+        if (tokens[0] == "local") {
+            path = LOCAL / file_name;
+        } else {
+            path = LIBRARY / tokens[0] / file_name;
+        }
+        /* Components that are stored in the binary format are preferred. */
+        if (fs::exists(path.string() + binary::SUFFIX)) {
+            path += binary::SUFFIX;
+        } else {
+            path += ".json";
+        }
+        return path;
+    }
+
+    Error _check_src(const std::string&) { return NOT_FOUND; }
+
+    /* A component that is being loaded by io::component::fetch_all. */
+    struct Pending {
+        std::vector<unsigned char> data;
+        std::vector<std::string> dependencies;
+        Scene scene;
+        Error err         = OK;
+        bool is_installed = false;
+    };
 
-    Error _check_fs(const std::string& name)
+    /* Threads that read and parse the components. */
+    static WorkerPool& _loader(void)
+    {
+        static WorkerPool pool {};
+        static std::once_flag is_started;
+        std::call_once(is_started, []() {
+            pool.resize(
+                std::max<size_t>(1, std::thread::hardware_concurrency()));
+        });
+        return pool;
+    }
+
+    /* Reads the file of a component and the dependencies it lists. */
+    static void _read(const std::string& name, Pending& p)
     {
         std::string n { name };
         std::vector<std::string> tokens = split(n, '/');
         if (tokens.size() != 3) {
-            return ERROR(Error::INVALID_DEPENDENCY_FORMAT);
+            p.err = (ERROR(Error::INVALID_DEPENDENCY_FORMAT));
+            return;
         }
         std::string path;
-        Scene s;
-        if (tokens[0] == "local") {
-            path = LOCAL
-                / (base64_encode(tokens[1] + "/" + tokens[2]) + ".json");
-        } else {
-            path = LIBRARY / tokens[0]
-                / (base64_encode(tokens[1] + "/" + tokens[2]) + ".json");
+        if (!_find_indexed(name, path) || !read(path, p.data)) {
+            /* Components that were added after the last index update. */
+            if (!read(_library_path(tokens).string(), p.data)) {
+                p.err = (ERROR(Error::COMPONENT_NOT_FOUND));
+                return;
+            }
         }
-        std::string data = read(path);
-        if (data == "") {
-            return ERROR(Error::COMPONENT_NOT_FOUND);
+        if (binary::is_binary(p.data.data(), p.data.size())) {
+            binary::_read_dependencies(
+                p.data.data(), p.data.size(), p.dependencies);
+        } else {
+            _read_dependencies(reinterpret_cast<const char*>(p.data.data()),
+                p.data.size(), p.dependencies);
         }
-        Error err = load(data, s);
-        if (err) {
-            return err;
+    }
+
+    /* Set while a loader thread parses a component. */
+    static thread_local bool _is_loading = false;
+
+    /* Parses a component whose dependencies are loaded. */
+    static void _parse(Pending& p)
+    {
+        /* Committed once the component is installed, so components are not
+         * evaluated on the loader threads. */
+        p.scene.begin();
+        _is_loading = true;
+        if (binary::is_binary(p.data.data(), p.data.size())) {
+            p.err = binary::load(p.data.data(), p.data.size(), p.scene);
+        } else {
+            p.err = load_json(reinterpret_cast<const char*>(p.data.data()),
+                p.data.size(), p.scene);
         }
-        if (!s.component_context.has_value()) {
-            return ERROR(Error::NOT_A_COMPONENT);
+        _is_loading = false;
+        if (!p.err && !p.scene.component_context.has_value()) {
+            p.err = (ERROR(Error::NOT_A_COMPONENT));
         }
-        COMPONENT_STORAGE.insert_or_assign(s.to_dependency(), std::move(s));
-        return OK;
+        p.data.clear();
     }
 
-    Error _check_src(const std::string&) { return NOT_FOUND; }
-
-    Error fetch(const std::string& name, bool invalidate)
+    /* Loads the components and their dependencies. The components in names
+     * are loaded again if invalidate is set.
+     *
+     * Files are read level by level of the dependency graph, then the
+     * components that only depend on loaded components are parsed together
+     * until all are loaded. Components are only added to COMPONENT_STORAGE
+     * between the parses, while no loader thread reads it. */
+    static Error _fetch(const std::vector<std::string>& names, bool invalidate)
     {
-        if (!invalidate) {
-            if (auto cmp = COMPONENT_STORAGE.find(name);
-                cmp != COMPONENT_STORAGE.end()) {
-                return OK;
+        if (_is_loading) {
+            /* Dependencies are installed before the components that need
+             * them are parsed. */
+            return OK;
+        }
+        std::lock_guard<std::recursive_mutex> lock { _storage_lock };
+        std::map<std::string, Pending> pending;
+        std::vector<std::string> level;
+        auto enqueue = [&](const std::string& name, bool is_forced) {
+            if ((is_forced || _find(name) == nullptr)
+                && pending.emplace(name, Pending {}).second) {
+                level.push_back(name);
             }
+        };
+        for (const std::string& name : names) {
+            enqueue(name, invalidate);
         }
-        Error err = _check_fs(name);
-        if (err == COMPONENT_NOT_FOUND) {
-            err = _check_src(name);
+        while (!level.empty()) {
+            std::vector<std::string> names_read = std::move(level);
+            level.clear();
+            _loader().run(names_read.size(), [&](size_t t) {
+                _read(names_read[t], pending.at(names_read[t]));
+            });
+            for (const std::string& name : names_read) {
+                Pending& p = pending.at(name);
+                if (p.err == Error::COMPONENT_NOT_FOUND) {
+                    p.err = _check_src(name);
+                }
+                if (p.err) {
+                    return p.err;
+                }
+                for (const std::string& dep : p.dependencies) {
+                    enqueue(dep, false);
+                }
+            }
         }
-        if (err) {
-            return err;
+
+        size_t installed_s = 0;
+        while (installed_s < pending.size()) {
+            std::vector<std::pair<const std::string, Pending>*> ready;
+            for (auto& item : pending) {
+                bool is_ready = !item.second.is_installed;
+                for (const std::string& dep : item.second.dependencies) {
+                    auto p   = pending.find(dep);
+                    is_ready = is_ready
+                        && (p == pending.end() || p->second.is_installed);
+                }
+                if (is_ready) {
+                    ready.push_back(&item);
+                }
+            }
+            if (ready.empty()) {
+                for (const auto& [name, p] : pending) {
+                    if (!p.is_installed) {
+                        L_ERROR("%s is a part of a dependency cycle.",
+                            name.c_str());
+                    }
+                }
+                return ERROR(Error::CYCLIC_DEPENDENCY);
+            }
+            _loader().run(
+                ready.size(), [&](size_t t) { _parse(ready[t]->second); });
+            for (auto* item : ready) {
+                if (item->second.err) {
+                    return item->second.err;
+                }
+                item->second.scene.commit();
+                _install(item->first,
+                    std::make_shared<Scene>(std::move(item->second.scene)));
+                item->second.is_installed = true;
+            }
+            installed_s += ready.size();
+            _on_component_reload();
         }
         return OK;
     }
 
+    Error fetch(const std::string& name, bool invalidate)
+    {
+        std::lock_guard<std::recursive_mutex> lock { _storage_lock };
+        if (!invalidate && _find(name) != nullptr) {
+            return OK;
+        }
+        return _fetch({ name }, invalidate);
+    }
+
+    Error fetch_all(const std::vector<std::string>& names)
+    {
+        return _fetch(names, false);
+    }
+
     Error fetch(
         const std::string& name, const std::string& data, bool invalidate)
     {
         L_DEBUG("Fetching %s", name.c_str());
-        if (!invalidate) {
-            if (auto cmp = COMPONENT_STORAGE.find(name);
-                cmp != COMPONENT_STORAGE.end()) {
-                return OK;
-            }
+        std::lock_guard<std::recursive_mutex> lock { _storage_lock };
+        if (!invalidate && _find(name) != nullptr) {
+            return OK;
         }
         Scene s;
         if (Error err = load(data, s); err) {
@@ -301,25 +1070,231 @@ namespace component {
         if (!s.component_context.has_value()) {
             return ERROR(Error::NOT_A_COMPONENT);
         }
-        COMPONENT_STORAGE.insert_or_assign(name, std::move(s));
+        _install(name, std::make_shared<Scene>(std::move(s)));
+        _on_component_reload();
         return OK;
     }
 
+    /* Whether the outputs of a loaded component only depend on its current
+     * inputs. Clocks, feedback loops and components that are not
+     * combinational themselves may keep a state between runs. */
+    /* Components that are used more than once are checked once, visited
+     * also ends the recursion if the components depend on each other. */
+    static bool _is_combinational(
+        Scene& s, std::unordered_set<std::string>& visited)
+    {
+        if (!s._scheduler.empty()) {
+            return false;
+        }
+        if (s._netlist.is_dirty()) {
+            s._netlist.compile();
+        }
+        if (s._netlist.is_cyclic()) {
+            return false;
+        }
+        for (const auto& comp : s._components) {
+            if (!visited.insert(comp.second.path).second) {
+                continue;
+            }
+            std::shared_ptr<Scene> sub;
+            if (fetch(comp.second.path)
+                || (sub = _find(comp.second.path)) == nullptr
+                || !_is_combinational(*sub, visited)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool _is_combinational(Scene& s)
+    {
+        std::unordered_set<std::string> visited { s.to_dependency() };
+        return _is_combinational(s, visited);
+    }
+
+    static Interned& _interned(compid id)
+    {
+        return INTERNED[id / INTERN_CHUNK][id % INTERN_CHUNK];
+    }
+
+    compid intern(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock { _intern_lock };
+        compid next       = _interned_s;
+        auto [id, is_new] = _interned_ids.emplace(name, next);
+        if (is_new) {
+            lcs_assert(next / INTERN_CHUNK < std::size(INTERNED));
+            auto& chunk = INTERNED[next / INTERN_CHUNK];
+            if (chunk == nullptr) {
+                chunk = std::make_unique<Interned[]>(INTERN_CHUNK);
+            }
+            _interned(next).name = name;
+            _interned_s          = next + 1;
+        }
+        return id->second;
+    }
+
+    /* Builds the truth table of a loaded component. */
+    static void _build_truth_table(Scene& s, std::vector<uint64_t>& table)
+    {
+        size_t input_s = s.component_context->inputs.size();
+        if (input_s > _truth_table_limit || !_is_combinational(s)) {
+            return;
+        }
+        std::vector<uint64_t> input(size_t { 1 } << input_s);
+        for (size_t i = 0; i < input.size(); i++) {
+            input[i] = i;
+        }
+        table.resize(input.size());
+        s.component_context->run_batch(
+            input.data(), table.data(), input.size());
+    }
+
+    /* Returns the current version of an interned component, loading it
+     * again after a reload. Readers only take a lock when the version is
+     * outdated. */
+    static std::shared_ptr<const Version> _resolve(compid id)
+    {
+        Interned& c  = _interned(id);
+        auto version = std::atomic_load(&c.version);
+        if (version != nullptr && version->generation == _generation) {
+            return version;
+        }
+        std::lock_guard<std::recursive_mutex> lock { _storage_lock };
+        version = std::atomic_load(&c.version);
+        if (version != nullptr && version->generation == _generation) {
+            return version;
+        }
+        auto next = std::make_shared<Version>();
+        next->id  = id;
+        if (!fetch(c.name)) {
+            next->scene = _find(c.name);
+            /* Compiled before it is published, Netlist::run only reads
+             * it. */
+            if (next->scene->_netlist.is_dirty()) {
+                next->scene->_netlist.compile();
+            }
+            _build_truth_table(*next->scene, next->table);
+            if (!next->scene->_scheduler.empty()) {
+                next->clock_lock = &_clock_lock(next->scene.get());
+            }
+            if (!next->table.empty()) {
+                L_DEBUG("Built a truth table of %zu entries for %s",
+                    next->table.size(), c.name.c_str());
+            }
+        }
+        /* Loading the component or its dependencies starts a new
+         * generation, so the version is tagged once they are loaded. */
+        next->generation = _generation;
+        std::atomic_store(&c.version, std::shared_ptr<const Version> { next });
+        return next;
+    }
+
+    static uint64_t _lookup(const Version& v, uint64_t input)
+    {
+        return v.table[input & (v.table.size() - 1)];
+    }
+
+    uint64_t run(compid id, uint64_t input)
+    {
+        if (id == 0 || id >= _interned_s) {
+            return 0;
+        }
+        auto version = _resolve(id);
+        if (version->scene == nullptr) {
+            return 0;
+        } else if (!version->table.empty()) {
+            return _lookup(*version, input);
+        } else if (version->clock_lock != nullptr) {
+            std::lock_guard<std::mutex> lock { *version->clock_lock };
+            return version->scene->component_context->run(input);
+        }
+        return version->scene->component_context->run(input);
+    }
+
     uint64_t run(const std::string& name, uint64_t input)
     {
-        if (fetch(name)) {
+        return run(intern(name), input);
+    }
+
+    uint64_t run(compid id, uint64_t input, InstanceState& state)
+    {
+        if (id == 0 || id >= _interned_s) {
             return 0;
         }
-        return COMPONENT_STORAGE[name].component_context->run(input);
+        /* The instance runs the version it has until the next reload, so
+         * the common case is a single atomic load. */
+        if (state.component == nullptr || state.component->id != id
+            || state.component->generation != _generation) {
+            state.component = _resolve(id);
+        }
+        const Version& version = *state.component;
+        if (version.scene == nullptr) {
+            return 0;
+        } else if (!version.table.empty()) {
+            return _lookup(version, input);
+        } else if (version.clock_lock != nullptr) {
+            /* Clocks are toggled on the loaded component by
+             * io::scene::run_frame, so components with clocks run on it
+             * instead of keeping a state for each instance. */
+            std::lock_guard<std::mutex> lock { *version.clock_lock };
+            return version.scene->component_context->run(input);
+        }
+        return version.scene->component_context->run(input, state);
+    }
+
+    void run_batch(
+        compid id, const uint64_t* input, uint64_t* output, size_t n)
+    {
+        if (id == 0 || id >= _interned_s) {
+            std::fill(output, output + n, 0);
+            return;
+        }
+        auto version = _resolve(id);
+        if (version->scene == nullptr) {
+            std::fill(output, output + n, 0);
+        } else if (!version->table.empty()) {
+            for (size_t i = 0; i < n; i++) {
+                output[i] = _lookup(*version, input[i]);
+            }
+        } else if (version->clock_lock != nullptr) {
+            std::lock_guard<std::mutex> lock { *version->clock_lock };
+            version->scene->component_context->run_batch(input, output, n);
+        } else {
+            version->scene->component_context->run_batch(input, output, n);
+        }
+    }
+
+    void run_batch(const std::string& name, const uint64_t* input,
+        uint64_t* output, size_t n)
+    {
+        run_batch(intern(name), input, output, n);
     }
 
     NRef<const Scene> get(const std::string& name)
     {
-        if (auto cmp = COMPONENT_STORAGE.find(name);
-            cmp != COMPONENT_STORAGE.end()) {
-            return &cmp->second;
+        return _find(name).get();
+    }
+
+    void set_truth_table_limit(size_t limit)
+    {
+        if (limit > TRUTH_TABLE_MAX) {
+            L_WARN("Truth table limit %zu is larger than %zu.", limit,
+                TRUTH_TABLE_MAX);
+            limit = TRUTH_TABLE_MAX;
         }
-        return nullptr;
+        std::lock_guard<std::recursive_mutex> lock { _storage_lock };
+        _truth_table_limit = limit;
+        _generation++;
     }
+
+    bool has_truth_table(const std::string& name)
+    {
+        auto version = std::atomic_load(&_interned(intern(name)).version);
+        return version != nullptr && version->generation == _generation
+            && !version->table.empty();
+    }
+
+    uint32_t revision(void) { return _revision; }
 } // namespace component
 } // namespace lcs::io
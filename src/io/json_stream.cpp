@@ -0,0 +1,829 @@
+#include "common.h"
+#include "core.h"
+#include "io.h"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string_view>
+
+namespace lcs::io {
+
+/**
+ * Tokenizes JSON text in place. Values are either read as scalars or walked
+ * with JsonStream::object and JsonStream::array, the rest are skipped. Accepts
+ * the same documents as Json::Reader, including comments.
+ */
+class JsonStream {
+public:
+    enum Type { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT, INVALID };
+
+    /** A scalar value. Arrays and objects only have their type. */
+    struct Scalar {
+        Type type = NUL;
+        bool boolean;
+        double number;
+        std::string string;
+
+        /** Same as Json::Value::isInt. */
+        inline bool is_int(void) const
+        {
+            return type == NUMBER && std::floor(number) == number
+                && number >= INT32_MIN && number <= INT32_MAX;
+        }
+        inline int as_int(void) const { return static_cast<int>(number); }
+    };
+
+    JsonStream(const char* begin, const char* end)
+        : _it { begin }
+        , _end { end }
+    {
+    }
+
+    /** Returns the type of the next value without consuming it. */
+    Type peek(void)
+    {
+        _skip_space();
+        if (_it == _end) {
+            return INVALID;
+        }
+        switch (*_it) {
+        case '{': return OBJECT;
+        case '[': return ARRAY;
+        case '"': return STRING;
+        case 't':
+        case 'f': return BOOL;
+        case 'n': return NUL;
+        default: break;
+        }
+        return *_it == '-' || (*_it >= '0' && *_it <= '9') ? NUMBER : INVALID;
+    }
+
+    /** Reads a scalar, or skips an array or an object. */
+    bool value(Scalar& out)
+    {
+        out.type = peek();
+        switch (out.type) {
+        case STRING: return string(out.string);
+        case NUMBER: return _number(out.number);
+        case BOOL:
+            out.boolean = *_it == 't';
+            return _literal(out.boolean ? "true" : "false");
+        case NUL: return _literal("null");
+        case ARRAY:
+        case OBJECT: return skip();
+        default: return false;
+        }
+    }
+
+    /** Skips the next value. */
+    bool skip(void)
+    {
+        Scalar scalar;
+        switch (peek()) {
+        case OBJECT:
+            return object([&](const std::string&) { return skip(); });
+        case ARRAY: return array([&]() { return skip(); });
+        case INVALID: return false;
+        default: return value(scalar);
+        }
+    }
+
+    /** Walks an object, calling on_key for each key. on_key has to consume
+     * the value. */
+    template <typename F> bool object(F on_key)
+    {
+        if (peek() != OBJECT) {
+            return false;
+        }
+        _it++;
+        if (_consume('}')) {
+            return true;
+        }
+        std::string key;
+        do {
+            if (peek() != STRING || !string(key) || !_consume(':')
+                || !on_key(key)) {
+                return false;
+            }
+        } while (_consume(','));
+        return _consume('}');
+    }
+
+    /** Walks an array, calling on_item for each item. on_item has to consume
+     * the item. */
+    template <typename F> bool array(F on_item)
+    {
+        if (peek() != ARRAY) {
+            return false;
+        }
+        _it++;
+        if (_consume(']')) {
+            return true;
+        }
+        do {
+            if (!on_item()) {
+                return false;
+            }
+        } while (_consume(','));
+        return _consume(']');
+    }
+
+    bool string(std::string& out)
+    {
+        out.clear();
+        if (peek() != STRING) {
+            return false;
+        }
+        _it++;
+        const char* begin = _it;
+        while (_it != _end && *_it != '"' && *_it != '\\') {
+            _it++;
+        }
+        out.assign(begin, _it);
+        while (_it != _end && *_it != '"') {
+            if (*_it != '\\') {
+                out.push_back(*_it++);
+            } else if (!_escape(out)) {
+                return false;
+            }
+        }
+        if (_it == _end) {
+            return false;
+        }
+        _it++;
+        return true;
+    }
+
+private:
+    void _skip_space(void)
+    {
+        while (_it != _end) {
+            if (*_it == ' ' || *_it == '\t' || *_it == '\n' || *_it == '\r') {
+                _it++;
+            } else if (*_it == '/' && _end - _it > 1 && _it[1] == '/') {
+                while (_it != _end && *_it != '\n') {
+                    _it++;
+                }
+            } else if (*_it == '/' && _end - _it > 1 && _it[1] == '*') {
+                _it += 2;
+                while (_end - _it > 1 && !(_it[0] == '*' && _it[1] == '/')) {
+                    _it++;
+                }
+                _it = _end - _it > 1 ? _it + 2 : _end;
+            } else {
+                break;
+            }
+        }
+    }
+
+    bool _consume(char c)
+    {
+        _skip_space();
+        if (_it != _end && *_it == c) {
+            _it++;
+            return true;
+        }
+        return false;
+    }
+
+    bool _literal(const char* literal)
+    {
+        size_t size = std::strlen(literal);
+        if (static_cast<size_t>(_end - _it) < size
+            || std::memcmp(_it, literal, size) != 0) {
+            return false;
+        }
+        _it += size;
+        return true;
+    }
+
+    bool _number(double& out)
+    {
+        std::array<char, 64> buffer {};
+        size_t i = 0;
+        while (_it != _end && i < buffer.size() - 1
+            && (std::strchr("+-.eE", *_it) != nullptr
+                || (*_it >= '0' && *_it <= '9'))) {
+            buffer[i++] = *_it++;
+        }
+        char* end = nullptr;
+        out       = std::strtod(buffer.data(), &end);
+        return i != 0 && end == buffer.data() + i;
+    }
+
+    static int _hex(char c)
+    {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    bool _code_unit(uint32_t& unit)
+    {
+        if (_end - _it < 4) {
+            return false;
+        }
+        unit = 0;
+        for (int i = 0; i < 4; i++) {
+            int digit = _hex(*_it++);
+            if (digit < 0) {
+                return false;
+            }
+            unit = (unit << 4) | digit;
+        }
+        return true;
+    }
+
+    bool _escape(std::string& out)
+    {
+        _it++;
+        if (_it == _end) {
+            return false;
+        }
+        char c = *_it++;
+        switch (c) {
+        case '"':
+        case '\\':
+        case '/': out.push_back(c); return true;
+        case 'b': out.push_back('\b'); return true;
+        case 'f': out.push_back('\f'); return true;
+        case 'n': out.push_back('\n'); return true;
+        case 'r': out.push_back('\r'); return true;
+        case 't': out.push_back('\t'); return true;
+        case 'u': break;
+        default: return false;
+        }
+        uint32_t code = 0;
+        if (!_code_unit(code)) {
+            return false;
+        }
+        if (code >= 0xD800 && code <= 0xDBFF) {
+            uint32_t low = 0;
+            if (!_literal("\\u") || !_code_unit(low) || low < 0xDC00
+                || low > 0xDFFF) {
+                return false;
+            }
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+        }
+        if (code < 0x80) {
+            out.push_back(code);
+        } else if (code < 0x800) {
+            out.push_back(0xC0 | (code >> 6));
+            out.push_back(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out.push_back(0xE0 | (code >> 12));
+            out.push_back(0x80 | ((code >> 6) & 0x3F));
+            out.push_back(0x80 | (code & 0x3F));
+        } else {
+            out.push_back(0xF0 | (code >> 18));
+            out.push_back(0x80 | ((code >> 12) & 0x3F));
+            out.push_back(0x80 | ((code >> 6) & 0x3F));
+            out.push_back(0x80 | (code & 0x3F));
+        }
+        return true;
+    }
+
+    const char* _it;
+    const char* _end;
+};
+
+/* Fields of a node, collected before the node is created since the keys of an
+ * object can be in any order. */
+struct NodeFields {
+    Point point { 0, 0 };
+    std::optional<std::string> type;
+    std::optional<int> size;
+    std::optional<float> freq;
+    float phase = 0;
+    std::optional<bool> data;
+    std::optional<std::string> use;
+};
+
+/* Builds a scene while a document is tokenized. Gates, inputs and outputs
+ * are inserted as soon as they are read, components once their dependencies
+ * are loaded and relations once all nodes exist. */
+class SceneStream {
+public:
+    SceneStream(const char* begin, const char* end, Scene& scene)
+        : _json { begin, end }
+        , _scene { scene }
+    {
+    }
+
+    Error run(void)
+    {
+        if (_json.peek() != JsonStream::OBJECT) {
+            if (!_json.skip()) {
+                return ERROR(Error::INVALID_JSON_FORMAT);
+            }
+            return ERROR(Error::INVALID_SCENE);
+        }
+        Scene::Batch batch { _scene };
+        if (!_json.object([&](const std::string& key) { return _root(key); })) {
+            if (_err) {
+                return _err;
+            }
+            return ERROR(Error::INVALID_JSON_FORMAT);
+        }
+        if (!(_has_nodes && _has_name && _has_author && _has_version)) {
+            return ERROR(Error::INVALID_SCENE);
+        }
+        for (auto& [id, fields] : _pending_components) {
+            ComponentNode comp { &_scene, id };
+            if (!fields.use.has_value()) {
+                return ERROR(Error::INVALID_COMPONENT);
+            }
+            if (Error err = comp.set_component(*fields.use); err) {
+                return err;
+            }
+            comp.point = fields.point;
+            _scene._components.emplace(id, std::move(comp));
+        }
+        for (const Rel& r : _relations) {
+            if (_scene._connect_with_id(
+                    r.id, r.to_node, r.to_sock, r.from_node, r.from_sock)) {
+                return ERROR(Error::REL_CONNECT_ERROR);
+            }
+        }
+        for (auto& comp : _scene._components) {
+            if (std::find(_scene.dependencies.begin(),
+                    _scene.dependencies.end(), comp.second.path)
+                == _scene.dependencies.end()) {
+                return ERROR(Error::UNDEFINED_DEPENDENCY);
+            }
+        }
+        return OK;
+    }
+
+private:
+    /* Stops the walk with an error that is not a syntax error. */
+    bool _fail(Error err)
+    {
+        _err = err;
+        return false;
+    }
+
+    template <size_t N>
+    bool _text(std::array<char, N>& field, Error err, bool& has_field)
+    {
+        JsonStream::Scalar value;
+        if (!_json.value(value)) {
+            return false;
+        }
+        if (value.type != JsonStream::STRING) {
+            return true;
+        }
+        if (value.string.size() >= N) {
+            return _fail((ERROR(err)));
+        }
+        std::copy(value.string.begin(), value.string.end(), field.begin());
+        has_field = true;
+        return true;
+    }
+
+    bool _root(const std::string& key)
+    {
+        bool ignored = false;
+        if (key == "name") {
+            return _text(_scene.name, Error::INVALID_SCENE_NAME, _has_name);
+        } else if (key == "author") {
+            return _text(
+                _scene.author, Error::INVALID_AUTHOR_NAME, _has_author);
+        } else if (key == "description") {
+            return _text(
+                _scene.description, Error::INVALID_DESCRIPTION, ignored);
+        } else if (key == "version") {
+            JsonStream::Scalar value;
+            if (!_json.value(value)) {
+                return false;
+            }
+            _has_version   = value.is_int();
+            _scene.version = _has_version ? value.as_int() : _scene.version;
+            return true;
+        } else if (key == "dependencies") {
+            if (_json.peek() != JsonStream::ARRAY) {
+                return _json.skip();
+            }
+            if (!_json.array([&]() { return _dependency(); })) {
+                return false;
+            }
+            if (Error err = io::component::fetch_all(_scene.dependencies);
+                err) {
+                return _fail(err);
+            }
+            return true;
+        } else if (key == "component") {
+            return _component();
+        } else if (key == "nodes") {
+            if (_json.peek() != JsonStream::OBJECT) {
+                return _json.skip();
+            }
+            _has_nodes = true;
+            return _json.object(
+                [&](const std::string& type) { return _nodes(type); });
+        } else if (key == "rel") {
+            if (_json.peek() != JsonStream::OBJECT) {
+                return _json.skip();
+            }
+            return _json.object(
+                [&](const std::string& id) { return _relation(id); });
+        }
+        return _json.skip();
+    }
+
+    bool _dependency(void)
+    {
+        JsonStream::Scalar value;
+        if (!_json.value(value)) {
+            return false;
+        }
+        if (value.type != JsonStream::STRING) {
+            value.string.clear();
+        }
+        _scene.dependencies.push_back(value.string);
+        return true;
+    }
+
+    bool _component(void)
+    {
+        if (_json.peek() != JsonStream::OBJECT) {
+            return _json.skip();
+        }
+        std::optional<int> in, out;
+        bool is_valid = _json.object([&](const std::string& key) {
+            JsonStream::Scalar value;
+            if (!_json.value(value)) {
+                return false;
+            }
+            if (key == "in" && value.is_int()) {
+                in = value.as_int();
+            } else if (key == "out" && value.is_int()) {
+                out = value.as_int();
+            }
+            return true;
+        });
+        if (!is_valid) {
+            return false;
+        }
+        _scene.component_context = ComponentContext { &_scene };
+        if (!(in.has_value() && out.has_value())) {
+            return _fail((ERROR(Error::INVALID_COMPONENT)));
+        }
+        _scene.component_context->setup(*in, *out);
+        return true;
+    }
+
+    bool _nodes(const std::string& type_str)
+    {
+        NodeType type = NodeType::NODE_S;
+        for (NodeType t :
+            { NodeType::GATE, NodeType::COMPONENT, NodeType::INPUT,
+                NodeType::OUTPUT }) {
+            if (type_str == NodeType_to_str(t)) {
+                type = t;
+            }
+        }
+        if (type == NodeType::NODE_S || _json.peek() != JsonStream::OBJECT) {
+            return _json.skip();
+        }
+        Node last_id  = 0;
+        bool is_valid = _json.object([&](const std::string& key) {
+            NodeFields fields;
+            if (!_node_fields(fields)) {
+                return false;
+            }
+            Node id { _node_id(key), type };
+            if (id.id == 0) {
+                return _fail((ERROR(Error::INVALID_NODEID)));
+            }
+            if (id.id > last_id.id) {
+                last_id = id;
+            }
+            return _insert(id, fields);
+        });
+        _scene._last_node[type] = last_id;
+        return is_valid;
+    }
+
+    /* Parses a node id key, returns 0 when it is not a valid id. */
+    static uint16_t _node_id(const std::string& key)
+    {
+        const char* last    = key.data() + key.size();
+        unsigned long value = 0;
+        auto [end, ec]      = std::from_chars(key.data(), last, value);
+        if (ec != std::errc {} || end != last || value == 0
+            || value > UINT16_MAX) {
+            return 0;
+        }
+        return value;
+    }
+
+    bool _node_fields(NodeFields& fields)
+    {
+        if (_json.peek() != JsonStream::OBJECT) {
+            return _json.skip();
+        }
+        return _json.object([&](const std::string& key) {
+            if (key == "pos") {
+                return _point(fields.point);
+            }
+            JsonStream::Scalar value;
+            if (!_json.value(value)) {
+                return false;
+            }
+            bool is_number = value.type == JsonStream::NUMBER;
+            if (key == "type" && value.type == JsonStream::STRING) {
+                fields.type = std::move(value.string);
+            } else if (key == "use" && value.type == JsonStream::STRING) {
+                fields.use = std::move(value.string);
+            } else if (key == "size" && value.is_int()) {
+                fields.size = value.as_int();
+            } else if (key == "freq" && is_number) {
+                fields.freq = value.number;
+            } else if (key == "phase" && is_number) {
+                fields.phase = value.number;
+            } else if (key == "data" && value.type == JsonStream::BOOL) {
+                fields.data = value.boolean;
+            }
+            return true;
+        });
+    }
+
+    bool _point(Point& point)
+    {
+        if (_json.peek() != JsonStream::OBJECT) {
+            return _json.skip();
+        }
+        return _json.object([&](const std::string& key) {
+            JsonStream::Scalar value;
+            if (!_json.value(value)) {
+                return false;
+            }
+            int coord = value.is_int() ? value.as_int() : 0;
+            if (key == "x") {
+                point.x = coord;
+            } else if (key == "y") {
+                point.y = coord;
+            }
+            return true;
+        });
+    }
+
+    bool _insert(Node id, NodeFields& fields)
+    {
+        switch (id.type) {
+        case NodeType::GATE: {
+            if (!fields.type.has_value()) {
+                return _fail((ERROR(Error::INVALID_GATE)));
+            }
+            GateType type = GateType::GATE_S;
+            for (size_t t = 0; t < GateType::GATE_S; t++) {
+                if (*fields.type == GateType_to_str(static_cast<GateType>(t))) {
+                    type = static_cast<GateType>(t);
+                }
+            }
+            if (type == GateType::GATE_S) {
+                return _fail((ERROR(Error::INVALID_GATE)));
+            }
+            GateNode gate { &_scene, id, type };
+            if (fields.size.has_value()) {
+                size_t size = *fields.size;
+                while (gate.inputs.size() < size && gate.increment()) { }
+            }
+            gate.point = fields.point;
+            _scene._gates.emplace(id, std::move(gate));
+            return true;
+        }
+        case NodeType::INPUT: {
+            InputNode input { &_scene, id };
+            if (fields.freq.has_value()) {
+                input.set_clock(fields.freq, fields.phase);
+            } else if (!fields.data.has_value()) {
+                return _fail((ERROR(Error::INVALID_INPUT)));
+            }
+            input.point = fields.point;
+            auto iter   = _scene._inputs.emplace(id, std::move(input)).first;
+            if (!fields.freq.has_value() && *fields.data) {
+                iter->second.set(true);
+            }
+            return true;
+        }
+        case NodeType::OUTPUT: {
+            OutputNode output { &_scene, id };
+            output.point = fields.point;
+            _scene._outputs.emplace(id, std::move(output));
+            return true;
+        }
+        case NodeType::COMPONENT:
+            /* Created at the end, dependencies may follow the nodes. */
+            _pending_components.emplace_back(id, std::move(fields));
+            return true;
+        default: break;
+        }
+        return true;
+    }
+
+    bool _relation(const std::string& key)
+    {
+        Rel r;
+        r.id         = std::atol(key.c_str());
+        bool is_from = false, is_to = false;
+        if (_json.peek() != JsonStream::OBJECT) {
+            return _json.skip() && _fail(Error::INVALID_NODE);
+        }
+        bool is_valid = _json.object([&](const std::string& end) {
+            if (end == "from") {
+                is_from = _json.peek() == JsonStream::OBJECT;
+                return _rel_end(r.from_node, r.from_sock);
+            } else if (end == "to") {
+                is_to = _json.peek() == JsonStream::OBJECT;
+                return _rel_end(r.to_node, r.to_sock);
+            }
+            return _json.skip();
+        });
+        if (!is_valid) {
+            return false;
+        }
+        if (!(is_from && is_to)) {
+            return _fail(Error::INVALID_NODE);
+        }
+        if (r.id > _scene._last_rel) {
+            _scene._last_rel = r.id;
+        }
+        _relations.push_back(r);
+        return true;
+    }
+
+    bool _rel_end(Node& node, sockid& sock)
+    {
+        if (_json.peek() != JsonStream::OBJECT) {
+            return _json.skip();
+        }
+        bool has_id   = false;
+        bool is_valid = _json.object([&](const std::string& key) {
+            JsonStream::Scalar value;
+            if (!_json.value(value)) {
+                return false;
+            }
+            if (key == "sock") {
+                sock = value.is_int() ? value.as_int() : 0;
+            } else if (key == "id") {
+                has_id = _node_id(value, node);
+            }
+            return true;
+        });
+        if (!is_valid) {
+            return false;
+        }
+        if (!has_id) {
+            return _fail((ERROR(Error::INVALID_NODE)));
+        }
+        return true;
+    }
+
+    /* Parses a node reference, same as Node::from_json. */
+    static bool _node_id(const JsonStream::Scalar& value, Node& node)
+    {
+        if (value.is_int()) {
+            node.id = value.as_int();
+            return true;
+        } else if (value.type != JsonStream::STRING) {
+            return false;
+        }
+        size_t at_idx = value.string.find('@');
+        if (at_idx == std::string::npos) {
+            return false;
+        }
+        std::string_view type { value.string.data(), at_idx };
+        for (size_t t = 0; t < NodeType::NODE_S; t++) {
+            if (type == NodeType_to_str(static_cast<NodeType>(t))) {
+                node.type = static_cast<NodeType>(t);
+                node.id   = std::atol(value.string.c_str() + at_idx + 1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    JsonStream _json;
+    Scene& _scene;
+    Error _err        = OK;
+    bool _has_nodes   = false;
+    bool _has_name    = false;
+    bool _has_author  = false;
+    bool _has_version = false;
+    std::vector<std::pair<Node, NodeFields>> _pending_components;
+    /* Relations are small, so they are kept until all nodes are inserted. */
+    std::vector<Rel> _relations;
+};
+
+Error load_json(const char* data, size_t size, Scene& scene)
+{
+    return SceneStream { data, data + size, scene }.run();
+}
+
+/* Reads the dependencies of a JSON scene without loading it. Documents that
+ * can't be read have no dependencies, loading them reports the error. */
+void _read_dependencies(
+    const char* data, size_t size, std::vector<std::string>& dependencies)
+{
+    JsonStream json { data, data + size };
+    bool is_valid = json.object([&](const std::string& key) {
+        if (key != "dependencies" || json.peek() != JsonStream::ARRAY) {
+            return json.skip();
+        }
+        return json.array([&]() {
+            JsonStream::Scalar value;
+            if (!json.value(value)) {
+                return false;
+            }
+            dependencies.push_back(
+                value.type == JsonStream::STRING ? value.string : "");
+            return true;
+        });
+    });
+    if (!is_valid) {
+        dependencies.clear();
+    }
+}
+
+/* Reads the header of a JSON component into entry without loading its nodes
+ * or its dependencies. Returns false if the document is not a component. */
+bool _read_header(const char* data, size_t size, component::Entry& entry)
+{
+    JsonStream json { data, data + size };
+    bool has_name = false, has_author = false, has_version = false;
+    std::optional<int> in, out;
+    entry.dependencies.clear();
+    auto text = [&](std::string& field, size_t capacity, bool& has_field) {
+        JsonStream::Scalar value;
+        if (!json.value(value)) {
+            return false;
+        }
+        if (value.type == JsonStream::STRING) {
+            field     = std::move(value.string);
+            has_field = field.size() < capacity;
+        }
+        return true;
+    };
+    bool is_valid = json.object([&](const std::string& key) {
+        if (key == "name") {
+            return text(entry.name,
+                std::tuple_size<decltype(Scene::name)>::value, has_name);
+        } else if (key == "author") {
+            return text(entry.author,
+                std::tuple_size<decltype(Scene::author)>::value, has_author);
+        } else if (key == "version") {
+            JsonStream::Scalar value;
+            if (!json.value(value)) {
+                return false;
+            }
+            has_version   = value.is_int();
+            entry.version = has_version ? value.as_int() : entry.version;
+            return true;
+        } else if (key == "dependencies"
+            && json.peek() == JsonStream::ARRAY) {
+            return json.array([&]() {
+                JsonStream::Scalar value;
+                if (!json.value(value)) {
+                    return false;
+                }
+                entry.dependencies.push_back(
+                    value.type == JsonStream::STRING ? value.string : "");
+                return true;
+            });
+        } else if (key == "component" && json.peek() == JsonStream::OBJECT) {
+            return json.object([&](const std::string& key) {
+                JsonStream::Scalar value;
+                if (!json.value(value)) {
+                    return false;
+                }
+                if (key == "in" && value.is_int()) {
+                    in = value.as_int();
+                } else if (key == "out" && value.is_int()) {
+                    out = value.as_int();
+                }
+                return true;
+            });
+        }
+        return json.skip();
+    });
+    if (!(is_valid && has_name && has_author && has_version
+            && in.has_value() && out.has_value())) {
+        return false;
+    }
+    entry.input_s  = *in;
+    entry.output_s = *out;
+    return true;
+}
+
+} // namespace lcs::io
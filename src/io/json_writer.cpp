@@ -0,0 +1,122 @@
+#include "common.h"
+#include "io.h"
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <json/json.h>
+
+namespace lcs::io {
+
+/* Appends a JSON string, only escaping what the grammar requires. UTF-8 is
+ * written as is. */
+static void _quote(std::string& out, const char* begin, const char* end)
+{
+    out.push_back('"');
+    for (const char* c = begin; c < end; c++) {
+        switch (*c) {
+        case '"': out.append("\\\""); break;
+        case '\\': out.append("\\\\"); break;
+        case '\b': out.append("\\b"); break;
+        case '\f': out.append("\\f"); break;
+        case '\n': out.append("\\n"); break;
+        case '\r': out.append("\\r"); break;
+        case '\t': out.append("\\t"); break;
+        default:
+            if (static_cast<unsigned char>(*c) < 0x20) {
+                char buffer[8];
+                std::snprintf(buffer, sizeof(buffer), "\\u%04x", *c);
+                out.append(buffer);
+            } else {
+                out.push_back(*c);
+            }
+        }
+    }
+    out.push_back('"');
+}
+
+/* Appends a number the same way Json::Value::toStyledString does, so both
+ * styles read back to the same value. */
+static void _real(std::string& out, double value)
+{
+    if (std::isnan(value)) {
+        out.append("null");
+        return;
+    } else if (std::isinf(value)) {
+        out.append(value < 0 ? "-1e+9999" : "1e+9999");
+        return;
+    }
+    char buffer[32];
+    int n = std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+    for (int i = 0; i < n; i++) {
+        if (buffer[i] == ',') {
+            buffer[i] = '.';
+        }
+    }
+    out.append(buffer, n);
+    if (out.find_first_of(".e", out.size() - n) == std::string::npos) {
+        out.append(".0");
+    }
+}
+
+template <typename T> static void _integer(std::string& out, T value)
+{
+    char buffer[24];
+    auto res = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, res.ptr);
+}
+
+static void _minify(std::string& out, const Json::Value& value)
+{
+    switch (value.type()) {
+    case Json::nullValue: out.append("null"); break;
+    case Json::intValue: _integer(out, value.asLargestInt()); break;
+    case Json::uintValue: _integer(out, value.asLargestUInt()); break;
+    case Json::realValue: _real(out, value.asDouble()); break;
+    case Json::booleanValue: out.append(value.asBool() ? "true" : "false");
+        break;
+    case Json::stringValue: {
+        const char* begin = nullptr;
+        const char* end   = nullptr;
+        value.getString(&begin, &end);
+        _quote(out, begin, end);
+        break;
+    }
+    case Json::arrayValue:
+        out.push_back('[');
+        for (Json::ArrayIndex i = 0; i < value.size(); i++) {
+            if (i != 0) {
+                out.push_back(',');
+            }
+            _minify(out, value[i]);
+        }
+        out.push_back(']');
+        break;
+    case Json::objectValue:
+        out.push_back('{');
+        for (auto it = value.begin(); it != value.end(); ++it) {
+            if (it != value.begin()) {
+                out.push_back(',');
+            }
+            const char* end   = nullptr;
+            const char* begin = it.memberName(&end);
+            _quote(out, begin, end);
+            out.push_back(':');
+            _minify(out, *it);
+        }
+        out.push_back('}');
+        break;
+    }
+}
+
+std::string to_text(const Json::Value& doc, JsonStyle style)
+{
+    if (style == JsonStyle::STYLED) {
+        return doc.toStyledString();
+    }
+    std::string out;
+    out.reserve(4096);
+    _minify(out, doc);
+    return out;
+}
+
+} // namespace lcs::io
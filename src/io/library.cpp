@@ -0,0 +1,250 @@
+#include "common.h"
+#include "core.h"
+#include "io.h"
+#include <json/json.h>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+namespace lcs::io {
+bool _read_header(const char* data, size_t size, component::Entry& entry);
+namespace binary {
+    bool _read_header(
+        const unsigned char* data, size_t size, component::Entry& entry);
+} // namespace binary
+} // namespace lcs::io
+
+namespace lcs::io::component {
+namespace fs = std::filesystem;
+
+/* Format of the index file, files of other versions are rebuilt. */
+constexpr int INDEX_VERSION = 2;
+
+/* Guards the index. Files are read without it, so lookups from the loader
+ * threads don't wait for an update. */
+static std::mutex _index_lock;
+/* Serializes update_index. */
+static std::mutex _update_lock;
+/* Entries by their path, relative to ROOT. */
+static std::map<std::string, Entry> _index;
+/* Paths by dependency string, binary files are preferred. */
+static std::unordered_map<std::string, std::string> _paths;
+static bool _is_index_loaded = false;
+
+static fs::path _index_path(void) { return CACHE / "components.json"; }
+
+/* FNV-1a hash of the file contents. */
+static uint64_t _hash(const std::vector<unsigned char>& data)
+{
+    uint64_t hash = 0xcbf29ce484222325;
+    for (unsigned char c : data) {
+        hash = (hash ^ c) * 0x100000001b3;
+    }
+    return hash;
+}
+
+/* Rebuilds _paths from _index. Binary files are preferred, same as
+ * io::component::fetch. */
+static void _update_paths(void)
+{
+    _paths.clear();
+    for (const auto& [key, entry] : _index) {
+        auto [it, is_new] = _paths.emplace(entry.dependency, entry.path);
+        if (!is_new && binary::is_binary_path(entry.path)) {
+            it->second = entry.path;
+        }
+    }
+}
+
+/* Reads the index from CACHE once. A missing or invalid index is rebuilt by
+ * update_index. */
+static void _load_index(void)
+{
+    if (_is_index_loaded) {
+        return;
+    }
+    _is_index_loaded = true;
+    std::string data = read(_index_path());
+    Json::Reader reader {};
+    Json::Value doc;
+    if (data.empty() || !reader.parse(data, doc) || !doc.isObject()
+        || doc["version"] != INDEX_VERSION || !doc["files"].isObject()) {
+        return;
+    }
+    const Json::Value& files = doc["files"];
+    for (auto it = files.begin(); it != files.end(); ++it) {
+        const Json::Value& e = *it;
+        if (!e["dependency"].isString() || !e["hash"].isString()) {
+            continue;
+        }
+        Entry entry;
+        entry.path       = (ROOT / it.name()).string();
+        entry.dependency = e["dependency"].asString();
+        entry.name       = e["name"].asString();
+        entry.author     = e["author"].asString();
+        entry.version    = e["version"].asInt();
+        entry.input_s    = e["in"].asUInt();
+        entry.output_s   = e["out"].asUInt();
+        entry.hash       = std::strtoull(e["hash"].asCString(), nullptr, 16);
+        entry.mtime      = e["mtime"].asInt64();
+        entry.size       = e["size"].asUInt64();
+        for (const Json::Value& dep : e["dependencies"]) {
+            entry.dependencies.push_back(dep.asString());
+        }
+        _index.emplace(it.name(), std::move(entry));
+    }
+    _update_paths();
+}
+
+static void _save_index(void)
+{
+    Json::Value doc;
+    doc["version"] = INDEX_VERSION;
+    doc["files"]   = Json::objectValue;
+    for (const auto& [key, entry] : _index) {
+        Json::Value e;
+        char hash[17];
+        std::snprintf(hash, sizeof(hash), "%016llx",
+            static_cast<unsigned long long>(entry.hash));
+        e["dependency"] = entry.dependency;
+        e["name"]       = entry.name;
+        e["author"]     = entry.author;
+        e["version"]    = entry.version;
+        e["in"]         = entry.input_s;
+        e["out"]        = entry.output_s;
+        e["hash"]       = hash;
+        e["mtime"]      = static_cast<Json::Int64>(entry.mtime);
+        e["size"]       = static_cast<Json::UInt64>(entry.size);
+
+        e["dependencies"] = Json::arrayValue;
+        for (const std::string& dep : entry.dependencies) {
+            e["dependencies"].append(dep);
+        }
+
+        doc["files"][key] = e;
+    }
+    if (!write(_index_path(), to_text(doc))) {
+        L_WARN("Failed to write the component index.");
+    }
+}
+
+/* Reads the header of the component at path into entry. Its dependencies
+ * are not loaded, so files whose dependencies are missing are still indexed.
+ * Returns false if the file is not a component. */
+static bool _read_entry(const fs::path& path, Entry& entry)
+{
+    std::vector<unsigned char> data;
+    if (!read(path.string(), data)) {
+        return false;
+    }
+    uint64_t hash = _hash(data);
+    if (hash == entry.hash && !entry.dependency.empty()) {
+        return true;
+    }
+    bool is_component = binary::is_binary(data.data(), data.size())
+        ? binary::_read_header(data.data(), data.size(), entry)
+        : _read_header(
+              reinterpret_cast<const char*>(data.data()), data.size(), entry);
+    if (!is_component) {
+        return false;
+    }
+    /* Same as Scene::to_dependency. */
+    entry.dependency = (entry.author.empty() ? "local" : entry.author) + "/"
+        + entry.name + "/" + std::to_string(entry.version);
+    entry.hash = hash;
+    return true;
+}
+
+/* Indexes the component files in dir into index. Returns whether the index
+ * has changed. */
+static bool _update_dir(const fs::path& dir, std::map<std::string, Entry>& old,
+    std::map<std::string, Entry>& index)
+{
+    bool has_changes = false;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator { dir, ec };
+        !ec && it != fs::recursive_directory_iterator {}; it.increment(ec)) {
+        const fs::path& path = it->path();
+        if (!it->is_regular_file(ec)
+            || (path.extension() != ".json"
+                && path.extension() != binary::SUFFIX)) {
+            continue;
+        }
+        std::string key = path.lexically_relative(ROOT).generic_string();
+        Entry entry;
+        if (auto prev = old.find(key); prev != old.end()) {
+            entry = std::move(prev->second);
+            old.erase(prev);
+        }
+        int64_t mtime = it->last_write_time(ec).time_since_epoch().count();
+        uint64_t size = it->file_size(ec);
+        if (ec) {
+            continue;
+        }
+        if (entry.dependency.empty() || entry.mtime != mtime
+            || entry.size != size) {
+            if (!_read_entry(path, entry)) {
+                has_changes = has_changes || !entry.dependency.empty();
+                continue;
+            }
+            entry.mtime = mtime;
+            entry.size  = size;
+            has_changes = true;
+        }
+        entry.path = path.string();
+        index.emplace(std::move(key), std::move(entry));
+    }
+    return has_changes;
+}
+
+size_t update_index(void)
+{
+    std::lock_guard<std::mutex> update_lock { _update_lock };
+    std::map<std::string, Entry> old;
+    {
+        std::lock_guard<std::mutex> lock { _index_lock };
+        _load_index();
+        old = _index;
+    }
+    std::map<std::string, Entry> index;
+    bool has_changes = _update_dir(LIBRARY, old, index);
+    has_changes      = _update_dir(LOCAL, old, index) || has_changes;
+
+    std::lock_guard<std::mutex> lock { _index_lock };
+    _index = std::move(index);
+    _update_paths();
+    /* Entries that are left belong to removed files. */
+    if (has_changes || !old.empty()) {
+        _save_index();
+    }
+    return _index.size();
+}
+
+std::vector<Entry> list(void)
+{
+    std::lock_guard<std::mutex> lock { _index_lock };
+    _load_index();
+    std::vector<Entry> entries;
+    entries.reserve(_index.size());
+    for (const auto& [key, entry] : _index) {
+        entries.push_back(entry);
+    }
+    return entries;
+}
+
+bool _find_indexed(const std::string& name, std::string& path)
+{
+    std::lock_guard<std::mutex> lock { _index_lock };
+    _load_index();
+    auto it = _paths.find(name);
+    if (it == _paths.end()) {
+        return false;
+    }
+    path = it->second;
+    return true;
+}
+
+} // namespace lcs::io::component
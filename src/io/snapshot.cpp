@@ -0,0 +1,94 @@
+#include "common.h"
+#include "core.h"
+#include "io.h"
+#include <algorithm>
+
+namespace lcs::io::scene {
+
+Snapshot::Snapshot()
+    : time { 0 }
+    , revision { 0 }
+{
+}
+
+void Snapshot::capture(Scene& scene)
+{
+    time         = scene._scheduler.now();
+    size_t rel_s = 1;
+    for (const Rel& r : scene._relations) {
+        rel_s = std::max<size_t>(rel_s, r.id + 1);
+    }
+    _relations.assign(rel_s, State::DISABLED);
+    _oscillating.assign(rel_s, false);
+    for (const Rel& r : scene._relations) {
+        _relations[r.id]   = scene.get_value(r.id);
+        _oscillating[r.id] = r.is_oscillating;
+    }
+
+    auto of_state = [](State s) {
+        return Value { s == State::TRUE, s == State::DISABLED };
+    };
+    auto capture_nodes = [&](auto& nodes, NodeType type, auto value_of) {
+        std::vector<Value>& values = _nodes[type];
+        size_t node_s              = 1;
+        for (auto& node : nodes) {
+            node_s = std::max<size_t>(node_s, node.first.id + 1);
+        }
+        values.assign(node_s, Value { 0, true });
+        for (auto& node : nodes) {
+            values[node.first.id] = value_of(node.second);
+        }
+    };
+    capture_nodes(scene._gates, NodeType::GATE,
+        [&](GateNode& n) { return of_state(n.get()); });
+    capture_nodes(scene._inputs, NodeType::INPUT,
+        [&](InputNode& n) { return of_state(n.get()); });
+    capture_nodes(scene._outputs, NodeType::OUTPUT,
+        [&](OutputNode& n) { return of_state(n.get()); });
+    capture_nodes(scene._components, NodeType::COMPONENT,
+        [](ComponentNode& n) {
+            Value value { 0, n.get() == State::DISABLED };
+            for (sockid i = 0; i < n.outputs.size(); i++) {
+                value.bits |= uint64_t { n.get(i) == State::TRUE } << i;
+            }
+            return value;
+        });
+
+    std::vector<Value>& inputs  = _nodes[NodeType::COMPONENT_INPUT];
+    std::vector<Value>& outputs = _nodes[NodeType::COMPONENT_OUTPUT];
+    inputs.assign(1, Value { 0, true });
+    outputs.assign(1, Value { 0, true });
+    if (scene.component_context.has_value()) {
+        const ComponentContext& ctx = *scene.component_context;
+        for (size_t i = 0; i < ctx.inputs.size(); i++) {
+            inputs.push_back(of_state(ctx.get_value(ctx.get_input(i))));
+        }
+        for (size_t i = 0; i < ctx.outputs.size(); i++) {
+            outputs.push_back(of_state(ctx.get_value(ctx.get_output(i))));
+        }
+    }
+}
+
+State Snapshot::get(relid id) const
+{
+    return id < _relations.size() ? _relations[id] : State::DISABLED;
+}
+
+State Snapshot::get(Node id, sockid sock) const
+{
+    if (id.type >= NodeType::NODE_S || id.id >= _nodes[id.type].size()) {
+        return State::DISABLED;
+    }
+    const Value& value = _nodes[id.type][id.id];
+    if (value.is_disabled) {
+        return State::DISABLED;
+    }
+    return (value.bits >> sock) & 1 ? State::TRUE : State::FALSE;
+}
+
+bool Snapshot::is_oscillating(relid id) const
+{
+    return id < _oscillating.size() && _oscillating[id];
+}
+
+} // namespace lcs::io::scene
@@ -0,0 +1,161 @@
+#include "common.h"
+#include "core.h"
+#include "io.h"
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace lcs::io {
+
+static constexpr size_t RING_MASK = Waveform::RING_SIZE - 1;
+static_assert((Waveform::RING_SIZE & RING_MASK) == 0,
+    "Waveform::RING_SIZE has to be a power of two");
+
+/* VCD identifiers are strings of the printable characters from '!' to '~'. */
+static void _append_code(std::string& out, uint32_t code)
+{
+    code--;
+    do {
+        out += static_cast<char>('!' + code % 94);
+        code /= 94;
+    } while (code != 0);
+}
+
+static char _value_char(State value)
+{
+    return value == State::TRUE ? '1' : value == State::FALSE ? '0' : 'z';
+}
+
+Waveform::Waveform()
+    : _scene { nullptr }
+    , _file { nullptr }
+    , _is_running { false }
+    , _time { 0 }
+    , _last_time { 0 }
+    , _head { 0 }
+    , _tail { 0 }
+{
+}
+
+Waveform::~Waveform() { close(); }
+
+void Waveform::watch(relid id, const std::string& name)
+{
+    lcs_assert(_file == nullptr);
+    if (id == 0) {
+        return;
+    }
+    if (id >= _codes.size()) {
+        _codes.resize(id + 1, 0);
+    }
+    if (_codes[id] == 0) {
+        _rels.push_back(id);
+        _names.push_back(name);
+        _codes[id] = _rels.size();
+    }
+}
+
+Error Waveform::open(
+    const std::string& path, Scene& scene, const char* timescale)
+{
+    close();
+    _file = std::fopen(path.c_str(), "w");
+    if (_file == nullptr) {
+        return ERROR(Error::WRITE_FAILED);
+    }
+    std::string header = "$version " APPNAME_LONG " " VERSION " $end\n"
+                         "$timescale ";
+    header += timescale;
+    header += " $end\n$scope module ";
+    header += scene.name.begin();
+    header += " $end\n";
+    for (size_t i = 0; i < _rels.size(); i++) {
+        header += "$var wire 1 ";
+        _append_code(header, i + 1);
+        header += " " + _names[i] + " $end\n";
+    }
+    header += "$upscope $end\n$enddefinitions $end\n#";
+    header += std::to_string(_time);
+    header += "\n$dumpvars\n";
+    for (size_t i = 0; i < _rels.size(); i++) {
+        header += _value_char(scene.get_value(_rels[i]));
+        _append_code(header, i + 1);
+        header += '\n';
+    }
+    header += "$end\n";
+    std::fwrite(header.data(), 1, header.size(), _file);
+
+    _ring.resize(RING_SIZE);
+    _head.store(0, std::memory_order_relaxed);
+    _tail.store(0, std::memory_order_relaxed);
+    _last_time = _time;
+    _scene     = &scene;
+    _is_running.store(true, std::memory_order_release);
+    _writer         = std::thread { &Waveform::_write, this };
+    scene._waveform = this;
+    L_INFO("Recording %zu signals to %s.", _rels.size(), path.c_str());
+    return OK;
+}
+
+void Waveform::close(void)
+{
+    if (_file == nullptr) {
+        return;
+    }
+    _scene->_waveform = nullptr;
+    _scene            = nullptr;
+    _is_running.store(false, std::memory_order_release);
+    _writer.join();
+    /* Mark the end of the recording, so the last values are visible. */
+    if (_time != _last_time) {
+        std::fprintf(_file, "#%llu\n", static_cast<unsigned long long>(_time));
+    }
+    std::fclose(_file);
+    _file = nullptr;
+}
+
+void Waveform::_push(uint32_t code, State value)
+{
+    size_t head = _head.load(std::memory_order_relaxed);
+    while (head - _tail.load(std::memory_order_acquire) >= RING_SIZE) {
+        std::this_thread::yield();
+    }
+    _ring[head & RING_MASK] = Change { _time, code, value };
+    _head.store(head + 1, std::memory_order_release);
+}
+
+void Waveform::_write(void)
+{
+    std::string buffer;
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    while (true) {
+        /* Changes are pushed before the recording stops, so the ring is
+         * empty once it is drained after that. */
+        bool is_running = _is_running.load(std::memory_order_acquire);
+        size_t head     = _head.load(std::memory_order_acquire);
+        if (head == tail) {
+            if (!is_running) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        for (; tail != head; tail++) {
+            const Change& change = _ring[tail & RING_MASK];
+            if (change.time != _last_time) {
+                buffer += '#';
+                buffer += std::to_string(change.time);
+                buffer += '\n';
+                _last_time = change.time;
+            }
+            buffer += _value_char(change.value);
+            _append_code(buffer, change.code);
+            buffer += '\n';
+        }
+        _tail.store(tail, std::memory_order_release);
+        std::fwrite(buffer.data(), 1, buffer.size(), _file);
+        buffer.clear();
+    }
+}
+
+} // namespace lcs::io
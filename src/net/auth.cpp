@@ -345,10 +345,10 @@ void open_browser(const std::string& url)
     system(command.c_str());
 }
 
-Error upload_scene(NRef<const Scene> scene, std::string resp)
+Error upload_scene(const std::string& text, std::string& resp)
 {
     return net::post_request(ui::get_config().api_proxy + "/api/scene", resp,
-        scene->to_json().toStyledString(), _auth.access_token);
+        text, _auth.access_token);
 }
 
 } // namespace lcs::net
@@ -75,16 +75,6 @@ State ToggleButton(State state, bool clickable)
     return state;
 }
 
-void ToggleButton(NRef<InputNode> node)
-{
-    State s_old = node->get();
-
-    if (s_old != ToggleButton(node->get(), true)) {
-        node->toggle();
-        io::scene::notify_change();
-    }
-}
-
 void NodeTypeTitle(Node n)
 {
     static char buffer[256];
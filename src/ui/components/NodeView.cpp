@@ -33,7 +33,9 @@ static inline ImNodesPinShape_ to_shape(bool value, bool is_input)
     return value ? ImNodesPinShape_QuadFilled : ImNodesPinShape_Quad;
 }
 
-template <> void NodeView<ComponentContext>(NRef<ComponentContext> node, bool)
+template <>
+void NodeView<ComponentContext>(
+    NRef<ComponentContext> node, NRef<const io::scene::Snapshot>, bool)
 {
     uint32_t compin  = Node { 0, COMPONENT_INPUT }.numeric();
     uint32_t compout = Node { 0, COMPONENT_OUTPUT }.numeric();
@@ -63,7 +65,9 @@ template <> void NodeView<ComponentContext>(NRef<ComponentContext> node, bool)
     ImNodes::EndNode();
 }
 
-template <> void NodeView<InputNode>(NRef<InputNode> node, bool has_changes)
+template <>
+void NodeView<InputNode>(NRef<InputNode> node,
+    NRef<const io::scene::Snapshot> snapshot, bool has_changes)
 {
     uint32_t nodeid = node->id().numeric();
     ImNodes::BeginNode(nodeid);
@@ -77,17 +81,24 @@ template <> void NodeView<InputNode>(NRef<InputNode> node, bool has_changes)
     if (node->is_timer()) {
         float freq_value = node->_freq.value();
         ImGui::PushItemWidth(60);
-        if (ImGui::SliderFloat("Hz", &freq_value, 0.1f, 5.0f, "%.1f")) {
+        if (ImGui::DragFloat("Hz", &freq_value, freq_value / 100, 0.001f,
+                Scheduler::MAX_FREQUENCY, "%g",
+                ImGuiSliderFlags_AlwaysClamp)) {
             if (freq_value != node->_freq.value()) {
-                node->_freq = freq_value;
-                io::scene::notify_change();
+                io::scene::post([&](Scene& s) {
+                    s.get_node<InputNode>(node->id())
+                        ->set_clock(freq_value, node->_phase);
+                    io::scene::notify_change();
+                });
             }
         }
         ImGui::PopItemWidth();
     } else {
-        State old = node->get();
+        State old = snapshot->get(node->id());
         if (State t = ToggleButton(old, true); t != old) {
-            node->toggle();
+            io::scene::post([&](Scene& s) {
+                s.get_node<InputNode>(node->id())->toggle();
+            });
         }
     }
     ImGui::SameLine();
@@ -97,7 +108,9 @@ template <> void NodeView<InputNode>(NRef<InputNode> node, bool has_changes)
     ImNodes::EndNode();
 }
 
-template <> void NodeView<OutputNode>(NRef<OutputNode> node, bool has_changes)
+template <>
+void NodeView<OutputNode>(
+    NRef<OutputNode> node, NRef<const io::scene::Snapshot>, bool has_changes)
 {
     uint32_t nodeid = node->id().numeric();
     ImNodes::BeginNode(nodeid);
@@ -114,7 +127,9 @@ template <> void NodeView<OutputNode>(NRef<OutputNode> node, bool has_changes)
     ImNodes::EndNode();
 }
 
-template <> void NodeView<GateNode>(NRef<GateNode> node, bool has_changes)
+template <>
+void NodeView<GateNode>(
+    NRef<GateNode> node, NRef<const io::scene::Snapshot>, bool has_changes)
 {
     uint32_t nodeid = node->id().numeric();
     ImNodes::BeginNode(nodeid);
@@ -142,7 +157,8 @@ template <> void NodeView<GateNode>(NRef<GateNode> node, bool has_changes)
 }
 
 template <>
-void NodeView<ComponentNode>(NRef<ComponentNode> node, bool has_changes)
+void NodeView<ComponentNode>(NRef<ComponentNode> node,
+    NRef<const io::scene::Snapshot>, bool has_changes)
 {
     uint32_t nodeid = node->id().numeric();
     ImNodes::BeginNode(nodeid);
@@ -1,5 +1,6 @@
 #include "IconsLucide.h"
 #include "common.h"
+#include "core.h"
 #include "imgui_internal.h"
 #include "io.h"
 #include "json/reader.h"
@@ -34,6 +35,7 @@ Configuration& load_config(void)
         L_ERROR("Parse error.");
         _config = Configuration();
     }
+    Netlist::set_thread_count(_config.sim_threads);
     L_DEBUG("Configuration was loaded.");
     return _config;
 }
@@ -45,6 +47,7 @@ void set_config(const Configuration& cfg)
     _config            = cfg;
     _config.is_applied = false;
     _config.is_saved   = false;
+    Netlist::set_thread_count(_config.sim_threads);
 }
 
 void save_config(void)
@@ -57,16 +60,17 @@ void save_config(void)
 Json::Value Configuration::to_json() const
 {
     Json::Value v;
-    v["theme"]["light"]       = get_theme(light_theme).name;
-    v["theme"]["dark"]        = get_theme(dark_theme).name;
-    v["theme"]["prefer"]      = ThemePreference_to_str(preference);
-    v["theme"]["corners"]     = rounded_corners;
-    v["scale"]                = scale;
-    v["language"]             = language;
-    v["window"]["x"]          = startup_win_x;
-    v["window"]["y"]          = startup_win_y;
-    v["proxy"]                = api_proxy;
-    v["window"]["fullscreen"] = start_fullscreen;
+    v["theme"]["light"]        = get_theme(light_theme).name;
+    v["theme"]["dark"]         = get_theme(dark_theme).name;
+    v["theme"]["prefer"]       = ThemePreference_to_str(preference);
+    v["theme"]["corners"]      = rounded_corners;
+    v["scale"]                 = scale;
+    v["language"]              = language;
+    v["window"]["x"]           = startup_win_x;
+    v["window"]["y"]           = startup_win_y;
+    v["proxy"]                 = api_proxy;
+    v["window"]["fullscreen"]  = start_fullscreen;
+    v["simulation"]["threads"] = sim_threads;
     return v;
 }
 
@@ -94,11 +98,15 @@ LCS_ERROR Configuration::from_json(const Json::Value& v)
     startup_win_x    = v["window"]["x"].asInt();
     startup_win_y    = v["window"]["y"].asInt();
     start_fullscreen = v["window"]["fullscreen"].asBool();
-    is_saved         = true;
+    /* Added later, older configuration files don't have it. */
+    sim_threads = v["simulation"]["threads"].isInt()
+        ? v["simulation"]["threads"].asInt()
+        : 0;
+    is_saved    = true;
 
     if (!(!light_theme.empty() && !dark_theme.empty()
             && (rounded_corners >= 0 && rounded_corners <= 20)
-            && (scale >= 75 && scale <= 150))) {
+            && (scale >= 75 && scale <= 150) && sim_threads >= 0)) {
         return ERROR(INVALID_JSON_FORMAT);
     }
     return Error::OK;
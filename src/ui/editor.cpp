@@ -18,19 +18,23 @@ static ImGuiID key_sceneinfo;
 static ImGuiID key_console;
 
 namespace lcs::ui {
-void before(ImGuiIO&) { ImNodes::CreateContext(); }
+void before(ImGuiIO&)
+{
+    ImNodes::CreateContext();
+    io::scene::start();
+}
 
 bool loop(ImGuiIO&)
 {
     MenuBar();
     NRef<Scene> scene = io::scene::get();
+    /* Values are read from the snapshot, the simulation thread updates the
+     * scene while the frame is drawn. */
+    NRef<const io::scene::Snapshot> snapshot = io::scene::snapshot();
     new_flow();
-    if (scene != nullptr) {
-        io::scene::run_frame();
-    }
-    SceneInfo(&scene);
-    NodeEditor(&scene);
-    Inspector(&scene);
+    SceneInfo(&scene, &snapshot);
+    NodeEditor(&scene, &snapshot);
+    Inspector(&scene, &snapshot);
     Palette(&scene);
     Console();
 
@@ -53,12 +57,14 @@ bool loop(ImGuiIO&)
 
         ImGui::End();
     }
+    save_result_flow();
     RenderNotifications();
     return show_demo_window;
 }
 
 void after(ImGuiIO&)
 {
+    io::scene::stop();
     if (io::scene::get() != nullptr) {
         if (io::scene::is_saved()) {
             io::scene::close();
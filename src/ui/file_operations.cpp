@@ -22,22 +22,37 @@ void open_flow()
         }
     }
 }
-bool save_as_flow(const char* title)
+bool save_as_flow(const char* title, bool is_async)
 {
 
     const char* new_path = tinyfd_saveFileDialog(
         title, LOCAL.c_str(), 1, _PATH_FILTER, "Save the scene as");
     if (new_path != nullptr) {
         std::string path_as_str { new_path };
-        if (path_as_str.find(".json") != std::string::npos) {
-            return io::scene::save_as(new_path) == Error::OK;
-        } else {
-            return io::scene::save_as(path_as_str + ".json") == Error::OK;
+        if (path_as_str.find(".json") == std::string::npos) {
+            path_as_str += ".json";
+        }
+        if (is_async) {
+            return io::scene::save_as_async(path_as_str) == Error::OK;
         }
+        return io::scene::save_as(path_as_str) == Error::OK;
     }
     return false;
 }
 
+void save_result_flow(void)
+{
+    io::scene::SaveResult result;
+    while (io::scene::poll_save(result)) {
+        if (result.err) {
+            Toast(ICON_LC_TRIANGLE_ALERT, "Save Error",
+                ("Failed to save " + result.path).c_str(), true);
+        } else {
+            Toast(ICON_LC_SAVE, "Saved", result.path.c_str());
+        }
+    }
+}
+
 void close_flow(void)
 {
     if (io::scene::get() == nullptr) {
@@ -116,11 +131,13 @@ void new_flow(void)
             }
             TablePair(
                 if (ImGui::Button("Create")) {
-                    NRef<Scene> scene = io::scene::get(
+                    io::scene::get(
                         io::scene::create(name, author, description));
                     if (!is_scene) {
-                        scene->component_context.emplace(
-                            &scene, input_size, output_size);
+                        io::scene::post([&](Scene& s) {
+                            s.component_context.emplace(
+                                &s, input_size, output_size);
+                        });
                     }
                     new_flow_show = false;
                 },
@@ -11,16 +11,18 @@
 namespace lcs::ui {
 
 static void _disconnect_button_tooltip();
-static void _input_table(NRef<Scene>, const std::vector<relid>&);
+using SnapshotRef = NRef<const io::scene::Snapshot>;
+
+static void _input_table(NRef<Scene>, SnapshotRef, const std::vector<relid>&);
 static void _output_table(NRef<Scene>, const std::vector<relid>&);
-static void _inspector_input_node(NRef<Scene>, Node);
-static void _inspector_output_node(NRef<Scene>, Node);
-static void _inspector_component_node(NRef<Scene>, Node);
-static void _inspector_gate_node(NRef<Scene>, Node);
-static void _inspector_component_context_node(NRef<Scene>, Node);
-static void _inspector_tab(NRef<Scene>, Node);
+static void _inspector_input_node(NRef<Scene>, SnapshotRef, Node);
+static void _inspector_output_node(NRef<Scene>, SnapshotRef, Node);
+static void _inspector_component_node(NRef<Scene>, SnapshotRef, Node);
+static void _inspector_gate_node(NRef<Scene>, SnapshotRef, Node);
+static void _inspector_component_context_node(NRef<Scene>, SnapshotRef, Node);
+static void _inspector_tab(NRef<Scene>, SnapshotRef, Node);
 
-void Inspector(NRef<Scene> scene)
+void Inspector(NRef<Scene> scene, SnapshotRef snapshot)
 {
     static int nodeids[1 << 20] = { 0 };
     static char buffer[128];
@@ -29,7 +31,8 @@ void Inspector(NRef<Scene> scene)
         return;
     }
     if (ImGui::Begin("Inspector", &user_data.inspector)) {
-        if (scene != nullptr && ImNodes::NumSelectedNodes() > 0) {
+        if (scene != nullptr && snapshot != nullptr
+            && ImNodes::NumSelectedNodes() > 0) {
             int len = ImNodes::NumSelectedNodes();
             ImNodes::GetSelectedNodes(nodeids);
             if (len > 1) {
@@ -41,21 +44,21 @@ void Inspector(NRef<Scene> scene)
                     NodeType_to_str_full(node.type);
                     if (ImGui::BeginTabItem(
                             buffer, nullptr, ImGuiTabItemFlags_NoReorder)) {
-                        _inspector_tab(&scene, node);
+                        _inspector_tab(&scene, &snapshot, node);
                         ImGui::EndTabItem();
                     };
                 }
                 ImGui::EndTabBar();
             } else {
                 Node node = decode_pair(nodeids[0]);
-                _inspector_tab(&scene, node);
+                _inspector_tab(&scene, &snapshot, node);
             }
         }
     }
     ImGui::End();
 }
 
-static void _inspector_tab(NRef<Scene> scene, Node node)
+static void _inspector_tab(NRef<Scene> scene, SnapshotRef snapshot, Node node)
 {
     const static ImVec2 __table_l_size = ImGui::CalcTextSize("SOCKET COUNT");
 
@@ -74,7 +77,7 @@ static void _inspector_tab(NRef<Scene> scene, Node node)
         ImGui::SameLine();
         if (IconButton<NORMAL>(ICON_LC_TRASH_2, "Delete Node")) {
             ImNodes::ClearNodeSelection();
-            scene->remove_node(node);
+            io::scene::post([&](Scene& s) { s.remove_node(node); });
             EndSection();
             return;
         }
@@ -98,31 +101,57 @@ static void _inspector_tab(NRef<Scene> scene, Node node)
         }
 
         switch (node.type) {
-        case NodeType::INPUT: _inspector_input_node(&scene, node); break;
-        case NodeType::OUTPUT: _inspector_output_node(&scene, node); break;
-        case NodeType::GATE: _inspector_gate_node(&scene, node); break;
+        case NodeType::INPUT:
+            _inspector_input_node(&scene, &snapshot, node);
+            break;
+        case NodeType::OUTPUT:
+            _inspector_output_node(&scene, &snapshot, node);
+            break;
+        case NodeType::GATE:
+            _inspector_gate_node(&scene, &snapshot, node);
+            break;
         case NodeType::COMPONENT:
-            _inspector_component_node(&scene, node);
+            _inspector_component_node(&scene, &snapshot, node);
+            break;
+        default:
+            _inspector_component_context_node(&scene, &snapshot, node);
             break;
-        default: _inspector_component_context_node(&scene, node); break;
         }
     };
     EndSection();
 }
-static void _inspector_input_node(NRef<Scene> scene, Node node)
+static void _inspector_input_node(
+    NRef<Scene> scene, SnapshotRef snapshot, Node node)
 {
     auto _node                = scene->get_node<InputNode>(node);
     constexpr size_t SIZE     = 20;
     static float values[SIZE] = { 0 };
     static int frame_count    = 0;
     if (_node->is_timer()) {
-        TablePair(Field("Value"), ToggleButton(_node->get()));
+        TablePair(Field("Value"), ToggleButton(snapshot->get(node)));
         TablePair(Field("Frequency"));
         float freq_value = _node->_freq.value();
-        if (ImGui::SliderFloat("Hz", &freq_value, 0.1f, 5.0f, "%.1f")) {
+        if (ImGui::DragFloat("Hz", &freq_value, freq_value / 100, 0.001f,
+                Scheduler::MAX_FREQUENCY, "%g",
+                ImGuiSliderFlags_AlwaysClamp)) {
             if (freq_value != _node->_freq.value()) {
-                _node->_freq = freq_value;
-                io::scene::notify_change();
+                io::scene::post([&](Scene& s) {
+                    s.get_node<InputNode>(node)->set_clock(
+                        freq_value, _node->_phase);
+                    io::scene::notify_change();
+                });
+            }
+        }
+        TablePair(Field("Phase"));
+        float phase_value = _node->_phase;
+        if (ImGui::SliderFloat("##Phase", &phase_value, 0.0f, 1.0f, "%.2f",
+                ImGuiSliderFlags_AlwaysClamp)) {
+            if (phase_value != _node->_phase) {
+                io::scene::post([&](Scene& s) {
+                    s.get_node<InputNode>(node)->set_clock(
+                        _node->_freq, phase_value);
+                    io::scene::notify_change();
+                });
             }
         }
         if (++frame_count % SIZE == 0) {
@@ -130,13 +159,16 @@ static void _inspector_input_node(NRef<Scene> scene, Node node)
                 values[i - 1] = values[i];
             }
         }
-        values[SIZE - 1] = _node->get() == State::TRUE;
+        values[SIZE - 1] = snapshot->get(node) == State::TRUE;
         ImGui::PlotLines("##Frequency", values, SIZE, 0, nullptr, 0.0f, 1.0f);
     } else {
         TablePair(
-            Field("Value"), State old = _node->get();
-            if (State t = ToggleButton(old, true);
-                t != old) { _node->toggle(); });
+            Field("Value"), State old = snapshot->get(node);
+            if (State t = ToggleButton(old, true); t != old) {
+                io::scene::post([&](Scene& s) {
+                    s.get_node<InputNode>(node)->toggle();
+                });
+            });
     }
 
     TablePair(Field("Outputs"));
@@ -152,29 +184,31 @@ static void _inspector_input_node(NRef<Scene> scene, Node node)
         TablePair(Field("1"));
         _output_table(&scene, _node->output);
         ImGui::TableSetColumnIndex(2);
-        ToggleButton(_node->get());
+        ToggleButton(snapshot->get(node));
         ImGui::EndTable();
     }
     ImGui::EndTable();
 }
 
-static void _inspector_output_node(NRef<Scene> scene, Node node)
+static void _inspector_output_node(
+    NRef<Scene> scene, SnapshotRef snapshot, Node node)
 {
     auto _node = scene->get_node<OutputNode>(node);
-    TablePair(Field("Value"), ToggleButton(_node->get()));
+    TablePair(Field("Value"), ToggleButton(snapshot->get(node)));
     std::vector<relid> in;
     in.push_back(_node->input);
     TablePair(Field("Inputs"));
-    _input_table(&scene, in);
+    _input_table(&scene, &snapshot, in);
     ImGui::EndTable();
 }
 
-static void _inspector_gate_node(NRef<Scene> scene, Node node)
+static void _inspector_gate_node(
+    NRef<Scene> scene, SnapshotRef snapshot, Node node)
 {
     const static ImVec2 __selector_size = ImGui::CalcTextSize("-000000000000");
 
     auto _node = scene->get_node<GateNode>(node);
-    TablePair(Field("Value"), ToggleButton(_node->get()));
+    TablePair(Field("Value"), ToggleButton(snapshot->get(node)));
     TablePair(
         Field("Gate Type"), ImGui::Text("%s", GateType_to_str(_node->type())));
     ImGui::BeginDisabled(_node->type() == GateType::NOT);
@@ -184,20 +218,23 @@ static void _inspector_gate_node(NRef<Scene> scene, Node node)
     ImGui::PushItemWidth(__selector_size.x);
     if (ImGui::InputScalar("##SocketCount", ImGuiDataType_U8, &socket_count,
             &inc, &inc, nullptr)) {
-        bool keep = true;
-        while (socket_count != _node->inputs.size() && keep) {
-            if (socket_count > _node->inputs.size()) {
-                keep = _node->increment();
-            } else {
-                keep = _node->decrement();
+        io::scene::post([&](Scene& s) {
+            auto gate = s.get_node<GateNode>(node);
+            bool keep = true;
+            while (socket_count != gate->inputs.size() && keep) {
+                if (socket_count > gate->inputs.size()) {
+                    keep = gate->increment();
+                } else {
+                    keep = gate->decrement();
+                }
             }
-        }
+        });
     }
     ImGui::EndDisabled();
     ImGui::TableNextRow();
     ImGui::TableSetColumnIndex(0);
     TablePair(Field("Inputs"));
-    _input_table(&scene, _node->inputs);
+    _input_table(&scene, &snapshot, _node->inputs);
 
     TablePair(Field("Outputs"));
     if (ImGui::BeginTable("InputList", 3,
@@ -212,25 +249,26 @@ static void _inspector_gate_node(NRef<Scene> scene, Node node)
         TablePair(Field("1"));
         _output_table(&scene, _node->output);
         ImGui::TableSetColumnIndex(2);
-        ToggleButton(_node->get());
+        ToggleButton(snapshot->get(node));
         ImGui::EndTable();
     }
     ImGui::EndTable();
 }
 
-static void _inspector_component_node(NRef<Scene> scene, Node node)
+static void _inspector_component_node(
+    NRef<Scene> scene, SnapshotRef snapshot, Node node)
 {
     auto _node = scene->get_node<ComponentNode>(node);
     TablePair(Field("Value"));
     ImGui::Text("(");
     ImGui::SameLine();
     for (size_t i = 0; i < _node->outputs.size(); i++) {
-        ToggleButton(_node->get(i));
+        ToggleButton(snapshot->get(node, i));
         ImGui::SameLine();
     }
     ImGui::Text(")");
     TablePair(Field("Inputs"));
-    _input_table(&scene, _node->inputs);
+    _input_table(&scene, &snapshot, _node->inputs);
     TablePair(Field("Outputs"));
     if (ImGui::BeginTable("InputList", 3,
             ImGuiTableFlags_BordersInner | ImGuiTableFlags_RowBg)) {
@@ -246,7 +284,7 @@ static void _inspector_component_node(NRef<Scene> scene, Node node)
             TablePair(Field("%d", out.first));
             _output_table(&scene, out.second);
             ImGui::TableSetColumnIndex(2);
-            ToggleButton(_node->get(out.first));
+            ToggleButton(snapshot->get(node, out.first));
         }
 
         ImGui::EndTable();
@@ -254,7 +292,8 @@ static void _inspector_component_node(NRef<Scene> scene, Node node)
     ImGui::EndTable();
 }
 
-static void _inspector_component_context_node(NRef<Scene> scene, Node node)
+static void _inspector_component_context_node(
+    NRef<Scene> scene, SnapshotRef snapshot, Node node)
 {
     ComponentContext& ctx = scene->component_context.value();
     if (node.type == COMPONENT_INPUT) {
@@ -273,11 +312,14 @@ static void _inspector_component_context_node(NRef<Scene> scene, Node node)
                 TablePair(Field("%zu", i + 1));
                 _output_table(&scene, ctx.inputs[i]);
                 ImGui::TableSetColumnIndex(2);
-                State value = ctx.get_value(ctx.get_input(i));
+                State value = snapshot->get(ctx.get_input(i));
                 ImGui::PushID((std::to_string(i) + "btn").c_str());
                 if (State new_value = ToggleButton(value, true);
                     value != new_value) {
-                    ctx.set_value(ctx.get_input(i), new_value);
+                    io::scene::post([&](Scene& s) {
+                        s.component_context->set_value(
+                            ctx.get_input(i), new_value);
+                    });
                 }
                 ImGui::PopID();
             }
@@ -285,12 +327,13 @@ static void _inspector_component_context_node(NRef<Scene> scene, Node node)
         }
     } else {
         TablePair(Field("Inputs"));
-        _input_table(&scene, scene->component_context->outputs);
+        _input_table(&scene, &snapshot, scene->component_context->outputs);
     }
     ImGui::EndTable();
 }
 
-static void _input_table(NRef<Scene> scene, const std::vector<relid>& inputs)
+static void _input_table(
+    NRef<Scene> scene, SnapshotRef snapshot, const std::vector<relid>& inputs)
 {
     if (ImGui::BeginTable("Inputs", 4,
             ImGuiTableFlags_BordersInner | ImGuiTableFlags_RowBg)) {
@@ -312,14 +355,17 @@ static void _input_table(NRef<Scene> scene, const std::vector<relid>& inputs)
             if (inputs[i] != 0) {
                 NRef<Rel> r = scene->get_rel(inputs[i]);
                 NodeTypeTitle(r->from_node, r->from_sock);
-                value = r->value;
+                value = snapshot->get(inputs[i]);
             }
             ImGui::TableSetColumnIndex(2);
             ImGui::BeginDisabled(inputs[i] == 0);
             ImGui::PushID(std::to_string(i).c_str());
             if (IconButton<NORMAL>(ICON_LC_CIRCLE_SLASH_2, "")) {
-                scene->disconnect(inputs[i]);
-                io::scene::notify_change();
+                io::scene::post([&](Scene& s) {
+                    if (!s.disconnect(inputs[i])) {
+                        io::scene::notify_change();
+                    }
+                });
             }
             ImGui::PopID();
             ImGui::EndDisabled();
@@ -360,8 +406,11 @@ static void _output_table(NRef<Scene> scene, const std::vector<relid>& outputs)
             ImGui::BeginDisabled(outputs[i] == 0);
             ImGui::PushID(("output_" + std::to_string(i)).c_str());
             if (IconButton<NORMAL>(ICON_LC_CIRCLE_SLASH_2, "")) {
-                scene->disconnect(outputs[i]);
-                io::scene::notify_change();
+                io::scene::post([&](Scene& s) {
+                    if (!s.disconnect(outputs[i])) {
+                        io::scene::notify_change();
+                    }
+                });
             }
             ImGui::PopID();
             ImGui::EndDisabled();
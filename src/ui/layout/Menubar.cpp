@@ -36,13 +36,13 @@ void MenuBar(void)
                 open_flow();
             }
             if (IconButton<NORMAL>(ICON_LC_SAVE, "Save")) {
-                if (io::scene::save() == Error::NO_SAVE_PATH_DEFINED) {
-                    save_as_flow("Save scene");
+                if (io::scene::save_async() == Error::NO_SAVE_PATH_DEFINED) {
+                    save_as_flow("Save scene", true);
                 };
             }
 
             if (IconButton<NORMAL>(ICON_LC_SAVE_ALL, "Save As")) {
-                save_as_flow("Save scene as");
+                save_as_flow("Save scene as", true);
             }
             if (IconButton<NORMAL>(ICON_LC_SETTINGS_2, "Preferences")) {
                 pref_show = true;
@@ -8,13 +8,13 @@
 
 namespace lcs::ui {
 
-void NodeEditor(NRef<Scene> scene)
+void NodeEditor(NRef<Scene> scene, NRef<const io::scene::Snapshot> snapshot)
 {
     if (ImGui::Begin("Editor", nullptr,
             ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoFocusOnAppearing
                 | ImGuiWindowFlags_NoNavFocus)) {
         ImNodes::BeginNodeEditor();
-        if (scene == nullptr) {
+        if (scene == nullptr || snapshot == nullptr) {
             ImNodes::EndNodeEditor();
             ImGui::End();
             return;
@@ -23,30 +23,31 @@ void NodeEditor(NRef<Scene> scene)
         bool has_changes      = io::scene::has_changes();
         if (scene->component_context.has_value()) {
             NodeView<ComponentContext>(
-                &scene->component_context.value(), has_changes);
+                &scene->component_context.value(), &snapshot, has_changes);
         }
         for (auto& out : scene->_inputs) {
-            NodeView<InputNode>(&out.second, has_changes);
+            NodeView<InputNode>(&out.second, &snapshot, has_changes);
         }
         for (auto& out : scene->_outputs) {
-            NodeView<OutputNode>(&out.second, has_changes);
+            NodeView<OutputNode>(&out.second, &snapshot, has_changes);
         }
         for (auto& out : scene->_gates) {
-            NodeView<GateNode>(&out.second, has_changes);
+            NodeView<GateNode>(&out.second, &snapshot, has_changes);
         }
         for (auto& out : scene->_components) {
-            NodeView<ComponentNode>(&out.second, has_changes);
+            NodeView<ComponentNode>(&out.second, &snapshot, has_changes);
         }
-        for (auto& r : scene->_relations) {
-
+        for (const Rel& r : scene->_relations) {
+            State value = snapshot->get(r.id);
             ImNodes::PushColorStyle(ImNodesCol_Link,
-                r.second.value == State::TRUE ? ImGui::GetColorU32(style.green)
-                    : r.second.value == State::FALSE
+                snapshot->is_oscillating(r.id)
+                    ? ImGui::GetColorU32(style.yellow)
+                    : value == State::TRUE ? ImGui::GetColorU32(style.green)
+                    : value == State::FALSE
                     ? ImGui::GetColorU32(style.red)
                     : ImGui::GetColorU32(style.black_bright));
-            ImNodes::Link(r.first,
-                encode_pair(r.second.from_node, r.second.from_sock, true),
-                encode_pair(r.second.to_node, r.second.to_sock, false));
+            ImNodes::Link(r.id, encode_pair(r.from_node, r.from_sock, true),
+                encode_pair(r.to_node, r.to_sock, false));
             ImNodes::PopColorStyle();
         }
         ImNodes::MiniMap(0.2f, ImNodesMiniMapLocation_TopRight);
@@ -65,7 +66,10 @@ void NodeEditor(NRef<Scene> scene)
                 NodeTypeTitle(r->to_node, r->to_sock);
                 Field("Value");
                 ImGui::SameLine();
-                ToggleButton(r->value);
+                ToggleButton(snapshot->get(linkid));
+                if (snapshot->is_oscillating(linkid)) {
+                    ImGui::TextColored(style.yellow, "Oscillating");
+                }
                 EndSection();
                 ImGui::EndTooltip();
             }
@@ -88,13 +92,13 @@ void NodeEditor(NRef<Scene> scene)
                 Field("Value");
                 ImGui::SameLine();
                 if (nodeid.type != NodeType::COMPONENT) {
-                    ToggleButton(n->get());
+                    ToggleButton(snapshot->get(nodeid));
                 } else {
                     auto comp = scene->get_node<ComponentNode>(nodeid);
                     ImGui::Text("(");
                     ImGui::SameLine();
                     for (size_t i = 0; i < comp->outputs.size(); i++) {
-                        ToggleButton(comp->get(i));
+                        ToggleButton(snapshot->get(nodeid, i));
                         ImGui::SameLine();
                     }
                     ImGui::Text(")");
@@ -123,10 +127,9 @@ void NodeEditor(NRef<Scene> scene)
                     ImGui::SameLine();
                     if (nodeid.type == COMPONENT_INPUT
                         || nodeid.type == COMPONENT_OUTPUT) {
-                        ToggleButton(
-                            scene->component_context->get_value(nodeid));
+                        ToggleButton(snapshot->get(nodeid));
                     } else {
-                        ToggleButton(scene->get_base(nodeid)->get(sock));
+                        ToggleButton(snapshot->get(nodeid, sock));
                     }
                 }
                 EndSection();
@@ -139,9 +142,11 @@ void NodeEditor(NRef<Scene> scene)
             sockid from_sock = 0, to_sock = 0;
             Node from = decode_pair(start_pin_id, &from_sock);
             Node to   = decode_pair(end_pin_id, &to_sock);
-            if (!scene->connect(to, to_sock, from, from_sock)) {
-                io::scene::notify_change();
-            }
+            io::scene::post([&](Scene& s) {
+                if (!s.connect(to, to_sock, from, from_sock)) {
+                    io::scene::notify_change();
+                }
+            });
         };
         if (ImGui::IsMouseReleased(ImGuiMouseButton_Right)
             && ImNodes::NumSelectedNodes() > 0) {
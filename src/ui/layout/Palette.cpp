@@ -5,10 +5,39 @@
 #include "ui/layout.h"
 #include <imgui.h>
 #include <imnodes.h>
+#include <algorithm>
 
 namespace lcs::ui {
 static bool is_dragging = false;
 static Node dragged_node;
+
+/* Adds a node to the active scene on the simulation thread and starts
+ * dragging it. */
+template <class T, class... Args> static void _drag_new_node(Args... args)
+{
+    io::scene::post([&](Scene& s) { dragged_node = s.add_node<T>(args...); });
+    is_dragging = true;
+}
+
+static std::vector<io::component::Entry> components;
+static bool is_indexed = false;
+
+/* Adds a node of the component to the active scene and starts dragging it. */
+static void _drag_new_component(const std::string& dependency)
+{
+    io::scene::post([&](Scene& s) {
+        if (io::component::fetch(dependency) != Error::OK) {
+            return;
+        }
+        if (std::find(s.dependencies.begin(), s.dependencies.end(), dependency)
+            == s.dependencies.end()) {
+            s.dependencies.push_back(dependency);
+        }
+        dragged_node = s.add_node<ComponentNode>(dependency);
+        is_dragging  = true;
+    });
+}
+
 void Palette(NRef<Scene> scene)
 {
     if (!user_data.palette) {
@@ -25,51 +54,62 @@ void Palette(NRef<Scene> scene)
             ImGui::TableSetupColumn("##G2", ImGuiTableColumnFlags_WidthStretch);
             TablePair(
                 if (ImGui::Button("Input")) {
-                    dragged_node = scene->add_node<InputNode>();
-                    is_dragging  = true;
+                    _drag_new_node<InputNode>();
                 },
                 if (ImGui::Button("Output")) {
-                    dragged_node = scene->add_node<OutputNode>();
-                    is_dragging  = true;
+                    _drag_new_node<OutputNode>();
                 });
             TablePair(
                 if (ImGui::Button("Timer")) {
-                    dragged_node = scene->add_node<InputNode>(1.0f);
-                    is_dragging  = true;
+                    _drag_new_node<InputNode>(1.0f);
                 },
                 if (ImGui::Button("NOT Gate")) {
-                    dragged_node = scene->add_node<GateNode>(GateType::NOT);
-                    is_dragging  = true;
+                    _drag_new_node<GateNode>(GateType::NOT);
                 });
             TablePair(
                 if (ImGui::Button("AND Gate")) {
-                    dragged_node = scene->add_node<GateNode>(GateType::AND);
-                    is_dragging  = true;
+                    _drag_new_node<GateNode>(GateType::AND);
                 },
                 if (ImGui::Button("NAND Gate")) {
-                    dragged_node = scene->add_node<GateNode>(GateType::NAND);
-                    is_dragging  = true;
+                    _drag_new_node<GateNode>(GateType::NAND);
                 });
             TablePair(
                 if (ImGui::Button("OR Gate")) {
-                    dragged_node = scene->add_node<GateNode>(GateType::OR);
-                    is_dragging  = true;
+                    _drag_new_node<GateNode>(GateType::OR);
                 },
                 if (ImGui::Button("NOR Gate")) {
-                    dragged_node = scene->add_node<GateNode>(GateType::NOR);
-                    is_dragging  = true;
+                    _drag_new_node<GateNode>(GateType::NOR);
                 });
             TablePair(
                 if (ImGui::Button("XOR Gate")) {
-                    dragged_node = scene->add_node<GateNode>(GateType::XOR);
-                    is_dragging  = true;
+                    _drag_new_node<GateNode>(GateType::XOR);
                 },
                 if (ImGui::Button("XNOR Gate")) {
-                    dragged_node = scene->add_node<GateNode>(GateType::XNOR);
-                    is_dragging  = true;
+                    _drag_new_node<GateNode>(GateType::XNOR);
                 });
             ImGui::EndTable();
         }
+        if (ImGui::CollapsingHeader("Components")) {
+            /* The index only reads the files that changed since the last
+             * update. */
+            bool refresh = ImGui::Button("Refresh");
+            if (refresh || !is_indexed) {
+                io::component::update_index();
+                components = io::component::list();
+                is_indexed = true;
+            }
+            for (const io::component::Entry& c : components) {
+                ImGui::PushID(c.path.c_str());
+                if (ImGui::Button(c.name.c_str())) {
+                    _drag_new_component(c.dependency);
+                }
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("%s\n%d inputs, %d outputs",
+                        c.dependency.c_str(), c.input_s, c.output_s);
+                }
+                ImGui::PopID();
+            }
+        }
 
         if (ImGui::IsMouseDragging(ImGuiMouseButton_Left)) { }
         if (is_dragging) {
@@ -81,7 +121,8 @@ void Palette(NRef<Scene> scene)
                 dragged_node = 0;
             }
             if (ImGui::IsMouseDown(ImGuiMouseButton_Right)) {
-                scene->remove_node(dragged_node);
+                io::scene::post(
+                    [](Scene& s) { s.remove_node(dragged_node); });
                 is_dragging  = false;
                 dragged_node = 0;
             }
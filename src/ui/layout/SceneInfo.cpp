@@ -7,7 +7,7 @@
 #include "ui/layout.h"
 
 namespace lcs::ui {
-void SceneInfo(NRef<Scene> scene)
+void SceneInfo(NRef<Scene> scene, NRef<const io::scene::Snapshot> snapshot)
 {
     if (!user_data.scene_info) {
         return;
@@ -39,6 +39,19 @@ void SceneInfo(NRef<Scene> scene)
         };
         EndSection();
 
+        if (snapshot != nullptr) {
+            Section("Simulation");
+            Field("Time");
+            ImGui::SameLine();
+            ImGui::Text("%.3f s",
+                snapshot->time / static_cast<double>(Scheduler::SECOND));
+            bool is_turbo = io::scene::is_turbo();
+            if (ImGui::Checkbox("Turbo", &is_turbo)) {
+                io::scene::set_turbo(is_turbo);
+            }
+            EndSection();
+        }
+
         if (scene != nullptr && scene->component_context.has_value()) {
             Section("Component Attributes");
             Field("Input Size");
@@ -50,8 +63,10 @@ void SceneInfo(NRef<Scene> scene)
 
             if (input_size != scene->component_context->inputs.size()
                 || output_size != scene->component_context->outputs.size()) {
-                scene->component_context->setup(input_size, output_size);
-                io::scene::notify_change();
+                io::scene::post([&](Scene& s) {
+                    s.component_context->setup(input_size, output_size);
+                    io::scene::notify_change();
+                });
             }
             EndSection();
         }
@@ -108,8 +123,14 @@ void SceneInfo(NRef<Scene> scene)
             EndSection();
         }
         if (IconButton<NORMAL>(ICON_LC_UPLOAD, "Upload")) {
-            std::string resp;
-            net::upload_scene(&scene, resp);
+            /* Only the snapshot is taken on the simulation thread, it keeps
+             * running while the request is sent. */
+            std::string text, resp;
+            io::scene::post(
+                [&](Scene& s) { text = io::to_text(s.to_json()); });
+            if (Error err = net::upload_scene(text, resp); err) {
+                L_ERROR("Failed to upload the scene. %s", errmsg(err));
+            }
         }
         ImGui::EndDisabled();
     }
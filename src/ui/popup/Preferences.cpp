@@ -1,7 +1,9 @@
 #include "IconsLucide.h"
 #include "ui/components.h"
 #include "ui/configuration.h"
+#include <algorithm>
 #include <imgui.h>
+#include <thread>
 #include <tinyfiledialogs.h>
 
 namespace lcs::ui {
@@ -105,6 +107,23 @@ void Preferences(bool& pref_show)
         ImGui::EndTable();
     }
     EndSection();
+    Section("Simulation");
+    if (ImGui::BeginTable(
+            "##SimulationTable", 2, ImGuiTableFlags_BordersInnerV)) {
+        ImGui::TableSetupColumn(
+            "##Key", ImGuiTableColumnFlags_WidthFixed, __table_l_size.x);
+        ImGui::NextColumn();
+        ImGui::TableSetupColumn("##Value", ImGuiTableColumnFlags_WidthStretch);
+
+        TablePair(Field("Threads"));
+        if (ImGui::SliderInt("##Threads", &cfg.sim_threads, 0,
+                std::max(1U, std::thread::hardware_concurrency()),
+                cfg.sim_threads == 0 ? "Automatic" : "%d")) {
+            cfg.is_applied = false;
+        }
+        ImGui::EndTable();
+    }
+    EndSection();
     ImGuiIO& imio = ImGui::GetIO();
     ImGui::Text(
         "FPS: %4.f Uptime: %4.f seconds", imio.Framerate, ImGui::GetTime());
@@ -0,0 +1,23 @@
+#include "common.h"
+#include "core.h"
+#include <doctest.h>
+using namespace lcs;
+
+TEST_CASE("Gate kernels")
+{
+    for (size_t size = 2; size < 6; size++) {
+        for (size_t ones = 0; ones <= size; ones++) {
+            REQUIRE_EQ(GateNode::apply(GateType::AND, ones, size), ones == size);
+            REQUIRE_EQ(GateNode::apply(GateType::OR, ones, size), ones != 0);
+            REQUIRE_EQ(GateNode::apply(GateType::XOR, ones, size), ones % 2);
+            REQUIRE_EQ(GateNode::apply(GateType::NAND, ones, size),
+                !GateNode::apply(GateType::AND, ones, size));
+            REQUIRE_EQ(GateNode::apply(GateType::NOR, ones, size),
+                !GateNode::apply(GateType::OR, ones, size));
+            REQUIRE_EQ(GateNode::apply(GateType::XNOR, ones, size),
+                !GateNode::apply(GateType::XOR, ones, size));
+        }
+    }
+    REQUIRE(GateNode::apply(GateType::NOT, 0, 1));
+    REQUIRE_FALSE(GateNode::apply(GateType::NOT, 1, 1));
+}
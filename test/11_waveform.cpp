@@ -0,0 +1,87 @@
+#include "common.h"
+#include "core.h"
+#include "io.h"
+#include <doctest.h>
+
+using namespace lcs;
+
+static void _record(Scene& s, const std::string& path)
+{
+    auto v   = s.add_node<InputNode>();
+    auto g   = s.add_node<GateNode>(GateType::NOT);
+    auto o   = s.add_node<OutputNode>();
+    relid r1 = s.connect(g, 0, v);
+    relid r2 = s.connect(o, 0, g);
+    REQUIRE(r1);
+    REQUIRE(r2);
+
+    io::Waveform w;
+    w.watch(r1, "in");
+    w.watch(r2, "out");
+    REQUIRE_EQ(w.open(path, s, "1 us"), Error::OK);
+    REQUIRE(w.is_open());
+    for (uint64_t t = 1; t <= 3; t++) {
+        w.set_time(t * 10);
+        s.get_node<InputNode>(v)->toggle();
+    }
+    w.set_time(40);
+    w.close();
+    REQUIRE_FALSE(w.is_open());
+    REQUIRE_EQ(s._waveform, nullptr);
+}
+
+TEST_CASE("Record value changes to a VCD file")
+{
+    std::string expected = "$version " APPNAME_LONG " " VERSION " $end\n"
+                           "$timescale 1 us $end\n"
+                           "$scope module waveform $end\n"
+                           "$var wire 1 ! in $end\n"
+                           "$var wire 1 \" out $end\n"
+                           "$upscope $end\n"
+                           "$enddefinitions $end\n"
+                           "#0\n"
+                           "$dumpvars\n"
+                           "0!\n"
+                           "1\"\n"
+                           "$end\n"
+                           "#10\n1!\n0\"\n"
+                           "#20\n0!\n1\"\n"
+                           "#30\n1!\n0\"\n"
+                           "#40\n";
+
+    Scene s { "waveform" };
+    _record(s, TMP / "waveform.vcd");
+    REQUIRE_EQ(read(TMP / "waveform.vcd"), expected);
+
+    Scene compiled { "waveform" };
+    compiled.set_mode(SimulationMode::COMPILED);
+    _record(compiled, TMP / "waveform_compiled.vcd");
+    REQUIRE_EQ(read(TMP / "waveform_compiled.vcd"), expected);
+}
+
+TEST_CASE("Waveform waits for the writer when the ring is full")
+{
+    Scene s { "waveform" };
+    auto v   = s.add_node<InputNode>();
+    auto o   = s.add_node<OutputNode>();
+    relid id = s.connect(o, 0, v);
+
+    io::Waveform w;
+    w.watch(id, "in");
+    REQUIRE_EQ(w.open(TMP / "waveform_ring.vcd", s), Error::OK);
+    size_t toggle_s = 2 * io::Waveform::RING_SIZE + 1;
+    for (size_t t = 1; t <= toggle_s; t++) {
+        w.set_time(t);
+        s.get_node<InputNode>(v)->toggle();
+    }
+    w.close();
+
+    std::string data = read(TMP / "waveform_ring.vcd");
+    size_t changes   = 0;
+    for (size_t i = data.find("$end\n#1\n"); i < data.size(); i++) {
+        changes += data[i] == '!';
+    }
+    REQUIRE_EQ(changes, toggle_s);
+    REQUIRE_NE(data.find("#" + std::to_string(toggle_s) + "\n1!\n"),
+        std::string::npos);
+}
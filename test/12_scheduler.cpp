@@ -0,0 +1,95 @@
+#include "common.h"
+#include "core.h"
+#include "io.h"
+#include <doctest.h>
+#include <json/json.h>
+
+using namespace lcs;
+
+TEST_CASE("Clocks toggle in simulation time")
+{
+    Scene s;
+    auto clk = s.add_node<InputNode>(2.0f);
+    auto o   = s.add_node<OutputNode>();
+    REQUIRE(s.connect(o, 0, clk));
+    REQUIRE_EQ(s._scheduler.size(), 1);
+    REQUIRE_EQ(s._scheduler.next(), Scheduler::SECOND / 2);
+
+    REQUIRE_EQ(s.run_timers(Scheduler::SECOND / 2 - 1), 0);
+    REQUIRE_EQ(s.get_node<OutputNode>(o)->get(), State::FALSE);
+    REQUIRE_EQ(s.run_timers(Scheduler::SECOND / 2), 1);
+    REQUIRE_EQ(s.get_node<OutputNode>(o)->get(), State::TRUE);
+    REQUIRE_EQ(s.run_timers(10 * Scheduler::SECOND), 19);
+    REQUIRE_EQ(s.get_node<OutputNode>(o)->get(), State::FALSE);
+    REQUIRE_EQ(s._scheduler.now(), 10 * Scheduler::SECOND);
+    REQUIRE_EQ(s._scheduler.next(), 21 * Scheduler::SECOND / 2);
+}
+
+TEST_CASE("Clocks support arbitrary frequencies and phases")
+{
+    Scene s;
+    auto fast = s.add_node<InputNode>(1e6f);
+    auto slow = s.add_node<InputNode>();
+    s.get_node<InputNode>(slow)->set_clock(0.03125f, 0.25f);
+    REQUIRE(s.get_node<InputNode>(slow)->is_timer());
+
+    REQUIRE_EQ(s.run_timers(Scheduler::SECOND / 1000), 1000);
+    s.get_node<InputNode>(fast)->set_clock(std::nullopt);
+    REQUIRE_FALSE(s.get_node<InputNode>(fast)->is_timer());
+
+    /* 0.25 of a 64 s period, then half a period. */
+    REQUIRE_EQ(s._scheduler.next(), 48 * Scheduler::SECOND);
+    REQUIRE_EQ(s.run_timers(48 * Scheduler::SECOND - 1), 0);
+    REQUIRE_EQ(s.get_node<InputNode>(slow)->get(), State::FALSE);
+    REQUIRE_EQ(s.run_timers(48 * Scheduler::SECOND), 1);
+    REQUIRE_EQ(s.get_node<InputNode>(slow)->get(), State::TRUE);
+
+    /* Changing the frequency keeps the phase of the new period. */
+    s.get_node<InputNode>(slow)->set_clock(2.0f, 0.25f);
+    REQUIRE_EQ(s._scheduler.next(), 193 * Scheduler::SECOND / 4);
+
+    s.remove_node(slow);
+    REQUIRE(s._scheduler.empty());
+    REQUIRE_EQ(s._scheduler.next(), UINT64_MAX);
+    REQUIRE_EQ(s.run_timers(100 * Scheduler::SECOND), 0);
+}
+
+TEST_CASE("Clock frequencies are kept up to the scheduler limit")
+{
+    Scene s { "Clock frequencies are kept up to the scheduler limit" };
+    auto clk = s.add_node<InputNode>(2000.0f);
+    s.get_node<InputNode>(clk)->set_clock(2000.0f, 0.5f);
+    Json::Value doc = s.to_json();
+
+    Scene loaded;
+    REQUIRE_FALSE(loaded.from_json(doc));
+    auto node = loaded.get_node<InputNode>(clk);
+    REQUIRE_EQ(node->_freq.value(), 2000.0f);
+    REQUIRE_EQ(node->_phase, 0.5f);
+    REQUIRE_EQ(loaded._scheduler.next(), Scheduler::SECOND / 1000);
+    REQUIRE_EQ(doc.toStyledString(), loaded.to_json().toStyledString());
+
+    node->set_clock(1e9f);
+    REQUIRE_EQ(node->_freq.value(), Scheduler::MAX_FREQUENCY);
+}
+
+TEST_CASE("Step to the next toggle of the scene")
+{
+    size_t idx    = io::scene::create("Step to the next toggle", "", "", 1);
+    NRef<Scene> s = io::scene::get(idx);
+    auto c1       = s->add_node<InputNode>(4.0f);
+    auto c2       = s->add_node<InputNode>(6.0f);
+
+    for (uint64_t time :
+        { 166'666'667, 250'000'000, 333'333'333, 500'000'000, 666'666'667 }) {
+        REQUIRE(io::scene::step(idx));
+        REQUIRE_EQ(s->_scheduler.now(), time);
+    }
+    REQUIRE_EQ(s->get_node<InputNode>(c1)->get(), State::FALSE);
+    REQUIRE_EQ(s->get_node<InputNode>(c2)->get(), State::FALSE);
+
+    s->remove_node(c1);
+    s->remove_node(c2);
+    REQUIRE_FALSE(io::scene::step(idx));
+    REQUIRE_EQ(io::scene::close(idx), Error::OK);
+}
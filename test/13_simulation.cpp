@@ -0,0 +1,80 @@
+#include "common.h"
+#include "core.h"
+#include "io.h"
+#include <chrono>
+#include <doctest.h>
+#include <thread>
+
+using namespace lcs;
+
+TEST_CASE("Snapshot the values of a scene")
+{
+    size_t idx    = io::scene::create("Snapshot the values of a scene");
+    NRef<Scene> s = io::scene::get(idx);
+    auto v        = s->add_node<InputNode>();
+    auto g        = s->add_node<GateNode>(GateType::NOT);
+    auto o        = s->add_node<OutputNode>();
+    relid r1      = s->connect(g, 0, v);
+    relid r2      = s->connect(o, 0, g);
+    REQUIRE(r1);
+    REQUIRE(r2);
+
+    REQUIRE_EQ(io::scene::snapshot()->get(r1), State::FALSE);
+    REQUIRE_EQ(io::scene::snapshot()->get(r2), State::TRUE);
+    REQUIRE_EQ(io::scene::snapshot()->get(o), State::TRUE);
+    s->get_node<InputNode>(v)->toggle();
+    REQUIRE_EQ(io::scene::snapshot()->get(v), State::TRUE);
+    REQUIRE_EQ(io::scene::snapshot()->get(g), State::FALSE);
+    REQUIRE_EQ(io::scene::snapshot()->get(o), State::FALSE);
+    REQUIRE_FALSE(io::scene::snapshot()->is_oscillating(r2));
+
+    s->remove_node(g);
+    REQUIRE_EQ(io::scene::snapshot()->get(r1), State::DISABLED);
+    REQUIRE_EQ(io::scene::snapshot()->get(g), State::DISABLED);
+    REQUIRE_EQ(io::scene::snapshot()->get(o), State::DISABLED);
+    REQUIRE_EQ(io::scene::close(idx), Error::OK);
+}
+
+TEST_CASE("Simulation thread applies edits and publishes snapshots")
+{
+    size_t idx = io::scene::create("Simulation thread");
+    REQUIRE(io::scene::get(idx) != nullptr);
+    io::scene::start();
+    REQUIRE(io::scene::is_running());
+
+    Node in, out;
+    relid r = 0;
+    io::scene::post([&](Scene& s) {
+        in  = s.add_node<InputNode>();
+        out = s.add_node<OutputNode>();
+        r   = s.connect(out, 0, in);
+    });
+    REQUIRE(r);
+    REQUIRE_EQ(io::scene::snapshot()->get(r), State::FALSE);
+    REQUIRE_EQ(io::scene::snapshot()->get(out), State::FALSE);
+
+    /* Edits are visible in the snapshot once post returns. */
+    io::scene::post([&](Scene& s) { s.get_node<InputNode>(in)->toggle(); });
+    REQUIRE_EQ(io::scene::snapshot()->get(in), State::TRUE);
+    REQUIRE_EQ(io::scene::snapshot()->get(out), State::TRUE);
+
+    /* The simulation time advances without the reader. */
+    uint64_t revision = io::scene::snapshot()->revision;
+    uint64_t time     = io::scene::snapshot()->time;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (io::scene::snapshot()->time == time
+        && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    NRef<const io::scene::Snapshot> last = io::scene::snapshot();
+    bool is_advanced = last->time > time && last->revision > revision;
+
+    io::scene::stop();
+    REQUIRE_FALSE(io::scene::is_running());
+    REQUIRE(is_advanced);
+    NRef<Scene> s = io::scene::get(idx);
+    REQUIRE_EQ(s->get_node<OutputNode>(out)->get(), State::TRUE);
+    io::scene::post([&](Scene& s) { s.get_node<InputNode>(in)->toggle(); });
+    REQUIRE_EQ(s->get_node<OutputNode>(out)->get(), State::FALSE);
+    REQUIRE_EQ(io::scene::close(idx), Error::OK);
+}
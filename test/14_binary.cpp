@@ -0,0 +1,110 @@
+#include "common.h"
+#include "core.h"
+#include "io.h"
+#include <doctest.h>
+#include <filesystem>
+#include <json/json.h>
+
+using namespace lcs;
+
+TEST_CASE("Convert a scene between JSON and the binary format")
+{
+    Scene s { "Binary scene", "author", "A scene in the binary format", 3 };
+    auto clk   = s.add_node<InputNode>(2.0f);
+    auto v     = s.add_node<InputNode>();
+    auto g_and = s.add_node<GateNode>(GateType::AND, sockid { 3 });
+    auto g_not = s.add_node<GateNode>(GateType::NOT);
+    auto o     = s.add_node<OutputNode>();
+    s.get_node<InputNode>(clk)->set_clock(2.0f, 0.25f);
+    s.get_node<InputNode>(v)->set(true);
+    s.get_node<GateNode>(g_and)->point = Point { 10, -20 };
+    s.get_node<OutputNode>(o)->point   = Point { 300, 40 };
+    REQUIRE(s.connect(g_and, 0, v));
+    REQUIRE(s.connect(g_and, 1, v));
+    REQUIRE(s.connect(g_and, 2, clk));
+    REQUIRE(s.connect(g_not, 0, g_and));
+    REQUIRE(s.connect(o, 0, g_not));
+    Json::Value doc = s.to_json();
+
+    std::vector<unsigned char> data;
+    REQUIRE_EQ(io::binary::from_json(doc, data), Error::OK);
+    REQUIRE(io::binary::is_binary(data.data(), data.size()));
+    REQUIRE_LT(data.size(), doc.toStyledString().size());
+    Json::Value decoded;
+    REQUIRE_EQ(io::binary::to_json(data.data(), data.size(), decoded),
+        Error::OK);
+    REQUIRE_EQ(decoded.toStyledString(), doc.toStyledString());
+
+    Scene loaded;
+    REQUIRE_EQ(io::binary::load(data.data(), data.size(), loaded), Error::OK);
+    REQUIRE_EQ(loaded.to_json().toStyledString(), doc.toStyledString());
+    REQUIRE_EQ(loaded.get_node<OutputNode>(o)->get(), State::TRUE);
+    REQUIRE_EQ(loaded._scheduler.next(), s._scheduler.next());
+
+    REQUIRE(write(TMP / "binary.lcsb", data));
+    size_t idx = 0;
+    REQUIRE_EQ(io::scene::open(TMP / "binary.lcsb", idx), Error::OK);
+    REQUIRE_EQ(io::scene::get(idx)->to_json().toStyledString(),
+        doc.toStyledString());
+    REQUIRE_EQ(io::scene::close(idx), Error::OK);
+
+    REQUIRE_EQ(io::binary::convert(TMP / "binary.lcsb", TMP / "binary.json"),
+        Error::OK);
+    REQUIRE_EQ(read(TMP / "binary.json"), doc.toStyledString());
+}
+
+TEST_CASE("Reject invalid binary scenes")
+{
+    Scene s { "Invalid binary scene" };
+    auto v = s.add_node<InputNode>();
+    auto o = s.add_node<OutputNode>();
+    REQUIRE(s.connect(o, 0, v));
+    std::vector<unsigned char> data;
+    REQUIRE_EQ(io::binary::from_json(s.to_json(), data), Error::OK);
+
+    Scene truncated;
+    REQUIRE_EQ(io::binary::load(data.data(), data.size() - 1, truncated),
+        Error::INVALID_BINARY_FORMAT);
+    std::vector<unsigned char> newer = data;
+    newer[4]                         = io::binary::FORMAT_VERSION + 1;
+    Scene unsupported;
+    REQUIRE_EQ(io::binary::load(newer.data(), newer.size(), unsupported),
+        Error::INVALID_BINARY_FORMAT);
+    Json::Value doc;
+    REQUIRE_EQ(io::binary::to_json(data.data(), 8, doc),
+        Error::INVALID_BINARY_FORMAT);
+}
+
+TEST_CASE("Store a component in the binary format")
+{
+    size_t idx    = io::scene::create("Binary component");
+    NRef<Scene> s = io::scene::get(idx);
+    s->component_context.emplace(&s, 2, 1);
+    Node g_xor = s->add_node<GateNode>(GateType::XOR);
+    s->connect(g_xor, 0, s->component_context->get_input(0));
+    s->connect(g_xor, 1, s->component_context->get_input(1));
+    s->connect(s->component_context->get_output(0), 0, g_xor);
+    std::string dependency = s->to_dependency();
+    std::filesystem::path json_path { s->to_filepath() };
+    std::filesystem::path binary_path = json_path;
+    binary_path.replace_extension(io::binary::SUFFIX);
+    std::filesystem::remove(binary_path);
+
+    REQUIRE_EQ(io::scene::save(idx), Error::OK);
+    REQUIRE_EQ(io::binary::convert(json_path, binary_path), Error::OK);
+    std::filesystem::remove(json_path);
+    REQUIRE_EQ(io::component::fetch(dependency, true), Error::OK);
+    REQUIRE_EQ(io::component::run(dependency, 0b01), 1);
+
+    /* Saving keeps the binary format of the component. */
+    s->get_node<GateNode>(g_xor)->point = Point { 5, 5 };
+    io::scene::notify_change(idx);
+    REQUIRE_EQ(io::scene::save(idx), Error::OK);
+    REQUIRE_FALSE(std::filesystem::exists(json_path));
+    std::string expected = s->to_json().toStyledString();
+    REQUIRE_EQ(io::scene::close(idx), Error::OK);
+    REQUIRE_EQ(io::component::fetch(dependency, true), Error::OK);
+    REQUIRE_EQ(
+        io::component::get(dependency)->to_json().toStyledString(), expected);
+    std::filesystem::remove(binary_path);
+}
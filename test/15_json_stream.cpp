@@ -0,0 +1,156 @@
+#include "common.h"
+#include "core.h"
+#include "io.h"
+#include <doctest.h>
+#include <filesystem>
+#include <json/json.h>
+
+using namespace lcs;
+
+/* Loads the text with both readers, and compares their results. */
+static Error _load_both(const std::string& text)
+{
+    Scene streamed;
+    Error err = io::load_json(text.data(), text.size(), streamed);
+
+    Json::Reader reader {};
+    Json::Value root;
+    Scene parsed;
+    Error expected = reader.parse(text, root) ? parsed.from_json(root)
+                                              : Error::INVALID_JSON_FORMAT;
+    REQUIRE_EQ(err, expected);
+    if (!err) {
+        REQUIRE_EQ(streamed.to_json().toStyledString(),
+            parsed.to_json().toStyledString());
+        for (auto& o : parsed._outputs) {
+            REQUIRE_EQ(streamed.get_node<OutputNode>(o.first)->get(),
+                o.second.get());
+        }
+        REQUIRE_EQ(streamed._last_rel, parsed._last_rel);
+        REQUIRE_EQ(streamed._scheduler.next(), parsed._scheduler.next());
+    }
+    return err;
+}
+
+TEST_CASE("Stream a scene from JSON")
+{
+    Scene s { "Stream \"a\" scene", "author", "Line\nbreak ç", 2 };
+    auto clk   = s.add_node<InputNode>(4.0f);
+    auto v     = s.add_node<InputNode>();
+    auto g_or  = s.add_node<GateNode>(GateType::OR, sockid { 3 });
+    auto g_not = s.add_node<GateNode>(GateType::NOT);
+    auto o     = s.add_node<OutputNode>();
+    s.get_node<InputNode>(clk)->set_clock(4.0f, 0.5f);
+    s.get_node<InputNode>(v)->set(true);
+    s.get_node<GateNode>(g_or)->point = Point { -3, 7 };
+    REQUIRE(s.connect(g_or, 0, v));
+    REQUIRE(s.connect(g_or, 2, clk));
+    REQUIRE(s.connect(g_not, 0, g_or));
+    REQUIRE(s.connect(o, 0, g_not));
+    std::string text = s.to_json().toStyledString();
+    REQUIRE_EQ(_load_both(text), Error::OK);
+
+    Scene loaded;
+    REQUIRE_EQ(io::load(text, loaded), Error::OK);
+    REQUIRE_EQ(loaded.to_json().toStyledString(), text);
+    REQUIRE_EQ(std::string { loaded.name.data() }, "Stream \"a\" scene");
+
+    /* Keys in any order, comments and escapes. */
+    REQUIRE_EQ(_load_both(R"({
+        // Relations before the nodes
+        "rel": { "1": { "to": { "id": "Out@1" }, "from": { "id": "In@1" } } },
+        "nodes": {
+            "Out": { "1": { "pos": { "y": 2, "x": 1 } } },
+            "In": { "1": { "data": true } } /* a comment */
+        },
+        "version": 1, "name": "AA😀", "author": ""
+    })"),
+        Error::OK);
+}
+
+TEST_CASE("Stream a component from JSON")
+{
+    Scene s { "Stream a component" };
+    s.component_context.emplace(&s, 2, 1);
+    Node g_and = s.add_node<GateNode>(GateType::AND);
+    s.connect(g_and, 0, s.component_context->get_input(0));
+    s.connect(g_and, 1, s.component_context->get_input(1));
+    s.connect(s.component_context->get_output(0), 0, g_and);
+    REQUIRE_EQ(_load_both(s.to_json().toStyledString()), Error::OK);
+}
+
+TEST_CASE("Stream invalid scenes from JSON")
+{
+    REQUIRE_EQ(_load_both(""), Error::INVALID_JSON_FORMAT);
+    REQUIRE_EQ(_load_both("{ \"name\": "), Error::INVALID_JSON_FORMAT);
+    REQUIRE_EQ(_load_both("[1, 2]"), Error::INVALID_SCENE);
+    REQUIRE_EQ(_load_both(R"({ "name": "a", "author": "", "nodes": {} })"),
+        Error::INVALID_SCENE);
+    REQUIRE_EQ(_load_both(std::string { R"({ "version": 1, "author": "", )" }
+                   + R"("nodes": {}, "name": ")" + std::string(200, 'a')
+                   + "\" }"),
+        Error::INVALID_SCENE_NAME);
+    REQUIRE_EQ(_load_both(R"({ "version": 1, "author": "", "name": "",
+        "nodes": { "Gate": { "1": { "size": 3 } } } })"),
+        Error::INVALID_GATE);
+    REQUIRE_EQ(_load_both(R"({ "version": 1, "author": "", "name": "",
+        "nodes": { "Gate": { "1": { "type": "MUX" } } } })"),
+        Error::INVALID_GATE);
+    for (const char* key : { "0", "abc", "1x", "-1", "65536", "" }) {
+        REQUIRE_EQ(_load_both(std::string { R"({ "version": 1, "author": "",
+            "name": "", "nodes": { "Out": { ")" }
+                       + key + "\": {} } } }"),
+            Error::INVALID_NODEID);
+    }
+    REQUIRE_EQ(_load_both(R"({ "version": 1, "author": "", "name": "",
+        "nodes": { "In": { "1": { "pos": { "x": 1 } } } } })"),
+        Error::INVALID_INPUT);
+    REQUIRE_EQ(_load_both(R"({ "version": 1, "author": "", "name": "",
+        "nodes": { "In": { "1": { "data": false } } },
+        "rel": { "1": { "from": { "id": "In@1" } } } })"),
+        Error::INVALID_NODE);
+    REQUIRE_EQ(_load_both(R"({ "version": 1, "author": "", "name": "",
+        "nodes": { "In": { "1": { "data": false } } },
+        "rel": { "1": { "from": { "id": "In@1" }, "to": { "id": "In@2" } } }
+        })"),
+        Error::REL_CONNECT_ERROR);
+    REQUIRE_EQ(_load_both(R"({ "version": 1, "author": "", "name": "",
+        "nodes": { "Comp": { "1": { "use": "local/missing/1" } } } })"),
+        Error::COMPONENT_NOT_FOUND);
+}
+
+TEST_CASE("Write a minified scene")
+{
+    Scene s { "Minified \"scene\"", "author", "Tab\tand\x01 ç", 1 };
+    auto clk   = s.add_node<InputNode>(0.1f);
+    auto g_xor = s.add_node<GateNode>(GateType::XOR);
+    auto o     = s.add_node<OutputNode>();
+    s.get_node<GateNode>(g_xor)->point = Point { -12, 40 };
+    REQUIRE(s.connect(g_xor, 0, clk));
+    REQUIRE(s.connect(g_xor, 1, clk));
+    REQUIRE(s.connect(o, 0, g_xor));
+    Json::Value doc    = s.to_json();
+    std::string styled = doc.toStyledString();
+    REQUIRE_EQ(io::to_text(doc, io::STYLED), styled);
+
+    std::string text = io::to_text(doc);
+    REQUIRE_EQ(text.find('\n'), std::string::npos);
+    REQUIRE_LT(text.size(), styled.size());
+    Json::Reader reader {};
+    Json::Value parsed;
+    REQUIRE(reader.parse(text, parsed));
+    REQUIRE_EQ(parsed.toStyledString(), styled);
+    REQUIRE_EQ(_load_both(text), Error::OK);
+
+    /* Components in the library are minified, scenes are not. */
+    size_t idx    = io::scene::create("Minified component");
+    NRef<Scene> c = io::scene::get(idx);
+    c->component_context.emplace(&c, 1, 1);
+    c->connect(c->component_context->get_output(0), 0,
+        c->component_context->get_input(0));
+    std::string path = c->to_filepath();
+    REQUIRE_EQ(io::scene::save(idx), Error::OK);
+    REQUIRE_EQ(read(path), io::to_text(c->to_json()));
+    REQUIRE_EQ(io::scene::close(idx), Error::OK);
+    std::filesystem::remove(path);
+}
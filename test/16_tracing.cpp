@@ -0,0 +1,66 @@
+#include "common.h"
+#include <doctest.h>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace lcs;
+
+static size_t _count_lines(std::string_view prefix)
+{
+    size_t count = 0;
+    l_iterate([&](size_t, const Line& l) {
+        if (std::string_view { l.expr.data() }.substr(0, prefix.size())
+            == prefix) {
+            count++;
+        }
+    });
+    return count;
+}
+
+TEST_CASE("Trace messages are formatted when they are read")
+{
+    l_clear();
+    T_INFO("Traced %d of %s at %.1f", 42, "message", 0.5);
+    size_t found = 0;
+    l_iterate([&](size_t, const Line& l) {
+        if (std::string_view { l.expr.data() }
+            == "Traced 42 of message at 0.5") {
+            REQUIRE_EQ(l.severity, LogLevel::INFO);
+            found++;
+        }
+    });
+    REQUIRE_EQ(found, 1);
+}
+
+TEST_CASE("Record trace messages from multiple threads")
+{
+    l_clear();
+    std::vector<std::thread> threads {};
+    for (size_t t = 0; t < 4; t++) {
+        threads.emplace_back([t]() {
+            for (size_t i = 0; i < 40; i++) {
+                T_DEBUG("Thread %zu sent %zu", t, i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    REQUIRE_EQ(_count_lines("Thread "), 160);
+}
+
+TEST_CASE("Write log lines to the file sink")
+{
+    std::string path = TMP / "sink.txt";
+    REQUIRE(l_set_file(path));
+    L_INFO("Written to the file sink");
+    /* Traced as a warning, which no build removes. */
+    __TRACE__(LogLevel::WARN, 0, "Traced to the file sink %d", 1);
+    l_flush();
+    REQUIRE(l_set_file(ROOT / "log.txt"));
+
+    std::string log = read(path);
+    REQUIRE_NE(log.find("Written to the file sink"), std::string::npos);
+    REQUIRE_NE(log.find("Traced to the file sink 1"), std::string::npos);
+}
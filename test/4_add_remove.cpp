@@ -1,5 +1,6 @@
 #include "core.h"
 #include <doctest.h>
+#include <json/json.h>
 
 using namespace lcs;
 TEST_CASE("Basic Add Remove Re-add Test")
@@ -82,3 +83,82 @@ TEST_CASE("Gate State Change After Removal")
 
     REQUIRE_EQ(s.get_node<OutputNode>(o)->get(), State::FALSE);
 }
+
+TEST_CASE("Node storage reuses removed ids once the others are used")
+{
+    Scene s;
+    auto g1 = s.add_node<GateNode>(GateType::AND);
+    auto g2 = s.add_node<GateNode>(GateType::OR);
+    auto g3 = s.add_node<GateNode>(GateType::XOR);
+    REQUIRE_EQ(s._gates.size(), 3);
+
+    auto h2 = s._gates.handle(g2);
+    REQUIRE_NE(s._gates.get(h2), nullptr);
+    s.remove_node(g2);
+    REQUIRE_EQ(s._gates.size(), 2);
+    REQUIRE_EQ(s._gates.get(h2), nullptr);
+    REQUIRE(s._gates.find(g2) == s._gates.end());
+    REQUIRE_EQ(s.get_node<GateNode>(g1)->type(), GateType::AND);
+    REQUIRE_EQ(s.get_node<GateNode>(g3)->type(), GateType::XOR);
+
+    auto g4 = s.add_node<GateNode>(GateType::NOR);
+    REQUIRE_EQ(g4.id, g3.id + 1);
+    REQUIRE_EQ(s._gates.get(h2), nullptr);
+    REQUIRE_EQ(s._gates.get(s._gates.handle(g4))->type(), GateType::NOR);
+
+    size_t count = 0;
+    for (const auto& gate : s._gates) {
+        REQUIRE_EQ(s.get_node<GateNode>(gate.first)->type(),
+            gate.second.type());
+        count++;
+    }
+    REQUIRE_EQ(count, 3);
+
+    /* Removed ids are reused once every other id is in use. */
+    size_t added = 0;
+    while (s._gates.next_id() > g3.id) {
+        added += s.add_node<GateNode>(GateType::AND).id != 0;
+    }
+    REQUIRE_EQ(added, UINT16_MAX - 4);
+    REQUIRE_EQ(s.add_node<GateNode>(GateType::AND).id, g2.id);
+    REQUIRE_EQ(s._gates.next_id(), 0);
+    REQUIRE_EQ(s.add_node<GateNode>(GateType::AND).id, 0);
+    REQUIRE_EQ(s._gates.size(), UINT16_MAX);
+}
+
+TEST_CASE("Removed relations are compacted on save")
+{
+    Scene s;
+    auto v  = s.add_node<InputNode>();
+    auto g  = s.add_node<GateNode>(GateType::NOT);
+    auto o  = s.add_node<OutputNode>();
+    auto r1 = s.connect(g, 0, v);
+    auto r2 = s.connect(o, 0, g);
+    REQUIRE(r1);
+    REQUIRE(r2);
+    REQUIRE_EQ(s.get_value(r2), State::TRUE);
+
+    REQUIRE_FALSE(s.disconnect(r1));
+    REQUIRE_EQ(s._relations.size(), 1);
+    REQUIRE_EQ(s.get_rel(r1), nullptr);
+    REQUIRE_EQ(s.get_value(r1), State::DISABLED);
+    REQUIRE_EQ(s.get_value(r2), State::DISABLED);
+    REQUIRE_EQ(s.get_node<OutputNode>(o)->get(), State::DISABLED);
+
+    auto r3 = s.connect(g, 0, v);
+    REQUIRE_GT(r3, r2);
+    REQUIRE_EQ(s.get_value(r2), State::TRUE);
+    s.get_node<InputNode>(v)->set(true);
+    REQUIRE_EQ(s.get_value(r3), State::TRUE);
+    REQUIRE_EQ(s.get_value(r2), State::FALSE);
+
+    Json::Value doc = s.to_json();
+    REQUIRE_EQ(doc["rel"].size(), 2);
+    REQUIRE(doc["rel"].isMember("1"));
+    REQUIRE(doc["rel"].isMember("2"));
+    REQUIRE_FALSE(doc["rel"].isMember(std::to_string(r3)));
+
+    Scene loaded;
+    REQUIRE_FALSE(loaded.from_json(doc));
+    REQUIRE_EQ(doc.toStyledString(), loaded.to_json().toStyledString());
+}
@@ -89,3 +89,32 @@ TEST_CASE("Create a component, grow it")
     //    REQUIRE_EQ(s.component_context->run(0b01), 1);
     REQUIRE_EQ(s.component_context->run(0b00), 0);
 }
+
+TEST_CASE("Run a 2x1 MUX component in batches")
+{
+    Scene s { ComponentContext { &s, 3, 2 }, "Batch 2x1 MUX component" };
+    auto g_and   = s.add_node<GateNode>(GateType::AND);
+    auto g_and_2 = s.add_node<GateNode>(GateType::AND);
+    auto g_not   = s.add_node<GateNode>(GateType::NOT);
+    auto g_out   = s.add_node<GateNode>(GateType::OR);
+
+    s.connect(g_and, 0, s.component_context->get_input(0));
+    s.connect(g_and_2, 0, s.component_context->get_input(1));
+    s.connect(g_and, 1, s.component_context->get_input(2));
+    s.connect(g_not, 0, s.component_context->get_input(2));
+    s.connect(g_and_2, 1, g_not);
+    s.connect(g_out, 0, g_and);
+    s.connect(g_out, 1, g_and_2);
+    s.connect(s.component_context->get_output(0), 0, g_out);
+    s.connect(s.component_context->get_output(1), 0, g_not);
+
+    std::vector<uint64_t> input(150);
+    std::vector<uint64_t> output(input.size());
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = (i * 5) & 0b111;
+    }
+    s.component_context->run_batch(input.data(), output.data(), input.size());
+    for (size_t i = 0; i < input.size(); i++) {
+        REQUIRE_EQ(output[i], s.component_context->run(input[i]));
+    }
+}
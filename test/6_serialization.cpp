@@ -1,8 +1,10 @@
 #include "core.h"
 #include "io.h"
 #include "test_util.h"
+#include <atomic>
 #include <doctest.h>
 #include <json/json.h>
+#include <thread>
 
 using namespace lcs;
 
@@ -325,3 +327,334 @@ TEST_CASE("Load a component to a scene, then update component(out)")
         REQUIRE_EQ(s2.get_node<OutputNode>(o3)->get(), TRUE);
     }
 }
+
+TEST_CASE("Evaluate components from their truth tables")
+{
+    Scene s { ComponentContext { &s, 3, 2 }, "Truth table 2x1 MUX" };
+    auto g_and   = s.add_node<GateNode>(GateType::AND);
+    auto g_and_2 = s.add_node<GateNode>(GateType::AND);
+    auto g_not   = s.add_node<GateNode>(GateType::NOT);
+    auto g_out   = s.add_node<GateNode>(GateType::OR);
+    s.connect(g_and, 0, s.component_context->get_input(0));
+    s.connect(g_and_2, 0, s.component_context->get_input(1));
+    s.connect(g_and, 1, s.component_context->get_input(2));
+    s.connect(g_not, 0, s.component_context->get_input(2));
+    s.connect(g_and_2, 1, g_not);
+    s.connect(g_out, 0, g_and);
+    s.connect(g_out, 1, g_and_2);
+    s.connect(s.component_context->get_output(0), 0, g_out);
+    s.connect(s.component_context->get_output(1), 0, g_not);
+
+    std::string mux = s.to_dependency();
+    REQUIRE_EQ(io::component::fetch(mux, s.to_json().toStyledString()),
+        Error::OK);
+    REQUIRE_FALSE(io::component::has_truth_table(mux));
+    for (uint64_t i = 0; i < 8; i++) {
+        REQUIRE_EQ(io::component::run(mux, i), s.component_context->run(i));
+    }
+    REQUIRE(io::component::has_truth_table(mux));
+
+    /* Reloading the component discards its truth table. */
+    s.component_context->setup(3, 1);
+    REQUIRE_EQ(io::component::fetch(mux, s.to_json().toStyledString(), true),
+        Error::OK);
+    REQUIRE_FALSE(io::component::has_truth_table(mux));
+    for (uint64_t i = 0; i < 8; i++) {
+        REQUIRE_EQ(io::component::run(mux, i), s.component_context->run(i));
+    }
+    REQUIRE(io::component::has_truth_table(mux));
+
+    io::component::set_truth_table_limit(2);
+    REQUIRE_EQ(io::component::run(mux, 0b101), s.component_context->run(0b101));
+    REQUIRE_FALSE(io::component::has_truth_table(mux));
+
+    /* Limits are clamped, so wide components are always simulated. */
+    sockid wide_s = io::component::TRUTH_TABLE_MAX + 1;
+    Scene w { ComponentContext { &w, wide_s, 1 }, "Truth table wide AND" };
+    auto g_wide = w.add_node<GateNode>(GateType::AND);
+    w.connect(g_wide, 0, w.component_context->get_input(0));
+    w.connect(g_wide, 1, w.component_context->get_input(wide_s - 1));
+    w.connect(w.component_context->get_output(0), 0, g_wide);
+    std::string wide = w.to_dependency();
+    REQUIRE_EQ(io::component::fetch(wide, w.to_json().toStyledString()),
+        Error::OK);
+    io::component::set_truth_table_limit(io::component::TRUTH_TABLE_MAX + 8);
+    uint64_t both = 1 | (uint64_t { 1 } << (wide_s - 1));
+    REQUIRE_EQ(io::component::run(wide, both), 1);
+    REQUIRE_EQ(io::component::run(wide, 1), 0);
+    REQUIRE_FALSE(io::component::has_truth_table(wide));
+    io::component::set_truth_table_limit(io::component::TRUTH_TABLE_LIMIT);
+
+    /* An SR latch remembers its state, so it has to be simulated. */
+    Scene l { ComponentContext { &l, 2, 1 }, "Truth table SR latch" };
+    auto nor_r = l.add_node<GateNode>(GateType::NOR);
+    auto nor_s = l.add_node<GateNode>(GateType::NOR);
+    l.connect(nor_r, 0, l.component_context->get_input(0));
+    l.connect(nor_s, 0, l.component_context->get_input(1));
+    l.connect(nor_r, 1, nor_s);
+    l.connect(nor_s, 1, nor_r);
+    l.connect(l.component_context->get_output(0), 0, nor_r);
+
+    std::string latch = l.to_dependency();
+    REQUIRE_EQ(io::component::fetch(latch, l.to_json().toStyledString()),
+        Error::OK);
+    uint64_t set = io::component::run(latch, 0b10);
+    REQUIRE_EQ(io::component::run(latch, 0b00), set);
+    uint64_t reset = io::component::run(latch, 0b01);
+    REQUIRE_NE(set, reset);
+    REQUIRE_EQ(io::component::run(latch, 0b00), reset);
+    REQUIRE_FALSE(io::component::has_truth_table(latch));
+
+    /* A component that uses the same component twice. */
+    Scene n { ComponentContext { &n, 3, 1 }, "Truth table nested MUX" };
+    n.dependencies.push_back(mux);
+    auto m1 = n.add_node<ComponentNode>(mux);
+    auto m2 = n.add_node<ComponentNode>(mux);
+    for (sockid i = 0; i < 3; i++) {
+        REQUIRE(n.connect(m1, i, n.component_context->get_input(i)));
+    }
+    REQUIRE(n.connect(m2, 0, m1));
+    REQUIRE(n.connect(m2, 1, n.component_context->get_input(0)));
+    REQUIRE(n.connect(m2, 2, n.component_context->get_input(1)));
+    REQUIRE(n.connect(n.component_context->get_output(0), 0, m2));
+
+    std::string nested = n.to_dependency();
+    REQUIRE_EQ(io::component::fetch(nested, n.to_json().toStyledString()),
+        Error::OK);
+    for (uint64_t i = 0; i < 8; i++) {
+        REQUIRE_EQ(io::component::run(nested, i), n.component_context->run(i));
+    }
+    REQUIRE(io::component::has_truth_table(nested));
+}
+
+TEST_CASE("Run components through interned ids")
+{
+    Scene s { ComponentContext { &s, 2, 1 }, "Interned AND" };
+    auto g_and = s.add_node<GateNode>(GateType::AND);
+    s.connect(g_and, 0, s.component_context->get_input(0));
+    s.connect(g_and, 1, s.component_context->get_input(1));
+    s.connect(s.component_context->get_output(0), 0, g_and);
+
+    std::string name = s.to_dependency();
+    compid id        = io::component::intern(name);
+    REQUIRE_NE(id, 0);
+    REQUIRE_EQ(io::component::intern(name), id);
+    REQUIRE_NE(io::component::intern(name + "x"), id);
+
+    REQUIRE_EQ(io::component::fetch(name, s.to_json().toStyledString()),
+        Error::OK);
+    for (uint64_t i = 0; i < 4; i++) {
+        REQUIRE_EQ(io::component::run(id, i), io::component::run(name, i));
+        REQUIRE_EQ(io::component::run(id, i), s.component_context->run(i));
+    }
+
+    /* The id stays valid when the component is reloaded. */
+    Scene s2 { ComponentContext { &s2, 2, 1 }, "Interned AND" };
+    auto g_or = s2.add_node<GateNode>(GateType::OR);
+    s2.connect(g_or, 0, s2.component_context->get_input(0));
+    s2.connect(g_or, 1, s2.component_context->get_input(1));
+    s2.connect(s2.component_context->get_output(0), 0, g_or);
+    REQUIRE_EQ(s2.to_dependency(), name);
+    REQUIRE_EQ(io::component::fetch(name, s2.to_json().toStyledString(), true),
+        Error::OK);
+    REQUIRE_EQ(io::component::intern(name), id);
+    uint64_t input[4]  = { 0, 1, 2, 3 };
+    uint64_t output[4] = {};
+    io::component::run_batch(id, input, output, 4);
+    for (uint64_t i = 0; i < 4; i++) {
+        REQUIRE_EQ(output[i], s2.component_context->run(i));
+    }
+    REQUIRE_EQ(io::component::run(0, 1), 0);
+}
+
+TEST_CASE("Instances of a sequential component keep their own state")
+{
+    /* An SR latch with an unused input, which only causes an evaluation. */
+    Scene l { ComponentContext { &l, 3, 1 }, "Instanced SR latch" };
+    auto nor_r = l.add_node<GateNode>(GateType::NOR);
+    auto nor_s = l.add_node<GateNode>(GateType::NOR);
+    l.connect(nor_r, 0, l.component_context->get_input(0));
+    l.connect(nor_s, 0, l.component_context->get_input(1));
+    l.connect(nor_r, 1, nor_s);
+    l.connect(nor_s, 1, nor_r);
+    l.connect(l.component_context->get_output(0), 0, nor_r);
+    std::string latch = l.to_dependency();
+    REQUIRE_EQ(io::component::fetch(latch, l.to_json().toStyledString()),
+        Error::OK);
+
+    compid id = io::component::intern(latch);
+    InstanceState a {};
+    InstanceState b {};
+    uint64_t set   = io::component::run(id, 0b010, a);
+    uint64_t reset = io::component::run(id, 0b001, b);
+    REQUIRE_NE(set, reset);
+    REQUIRE_EQ(io::component::run(id, 0b100, a), set);
+    REQUIRE_EQ(io::component::run(id, 0b100, b), reset);
+
+    for (SimulationMode mode :
+        { SimulationMode::INTERPRETED, SimulationMode::COMPILED }) {
+        Scene s {};
+        s.set_mode(mode);
+        s.dependencies.push_back(latch);
+        REQUIRE_EQ(s.load_dependencies(), Error::OK);
+        Node x = s.add_node<InputNode>();
+        Node r = s.add_node<InputNode>();
+        std::vector<Node> in {};
+        std::vector<Node> out {};
+        for (size_t i = 0; i < 8; i++) {
+            Node c  = s.add_node<ComponentNode>(latch);
+            Node si = s.add_node<InputNode>();
+            Node o  = s.add_node<OutputNode>();
+            REQUIRE(s.connect(c, 0, x));
+            REQUIRE(s.connect(c, 1, si));
+            REQUIRE(s.connect(c, 2, r));
+            REQUIRE(s.connect(o, 0, c, 0));
+            in.push_back(si);
+            out.push_back(o);
+        }
+        s.get_node<InputNode>(r)->set(true);
+        s.get_node<InputNode>(r)->set(false);
+        for (size_t i = 0; i < in.size(); i += 2) {
+            s.get_node<InputNode>(in[i])->set(true);
+            s.get_node<InputNode>(in[i])->set(false);
+        }
+        /* Every instance is evaluated again while holding its state. */
+        s.get_node<InputNode>(x)->set(true);
+        for (size_t i = 0; i < out.size(); i++) {
+            REQUIRE_EQ(s.get_node<OutputNode>(out[i])->get(),
+                i % 2 == 0 ? State::TRUE : State::FALSE);
+        }
+    }
+}
+
+TEST_CASE("Clocks inside a component change its outputs")
+{
+    Scene c { ComponentContext { &c, 1, 1 }, "Clocked AND" };
+    auto clk = c.add_node<InputNode>(2.0f);
+    auto g   = c.add_node<GateNode>(GateType::AND);
+    c.connect(g, 0, c.component_context->get_input(0));
+    c.connect(g, 1, clk);
+    c.connect(c.component_context->get_output(0), 0, g);
+    std::string clocked = c.to_dependency();
+    REQUIRE_EQ(io::component::fetch(clocked, c.to_json().toStyledString()),
+        Error::OK);
+
+    compid id = io::component::intern(clocked);
+    InstanceState state {};
+    REQUIRE_EQ(io::component::run(id, 1, state), 0);
+
+    size_t idx    = io::scene::create("Clocked AND user", "", "", 1);
+    NRef<Scene> s = io::scene::get(idx);
+    s->dependencies.push_back(clocked);
+    REQUIRE_EQ(s->load_dependencies(), Error::OK);
+    Node in  = s->add_node<InputNode>();
+    Node cmp = s->add_node<ComponentNode>(clocked);
+    Node out = s->add_node<OutputNode>();
+    REQUIRE(s->connect(cmp, 0, in));
+    REQUIRE(s->connect(out, 0, cmp, 0));
+
+    /* The clock of the loaded component is toggled with the scene. */
+    REQUIRE(io::scene::step(idx));
+    REQUIRE_EQ(io::component::run(id, 1, state), 1);
+    s->get_node<InputNode>(in)->set(true);
+    REQUIRE_EQ(s->get_node<OutputNode>(out)->get(), State::TRUE);
+    REQUIRE(io::scene::step(idx));
+    REQUIRE_EQ(io::component::run(id, 1, state), 0);
+    REQUIRE_EQ(io::scene::close(idx), Error::OK);
+
+    /* Clocks of nested components are toggled too. */
+    Scene w { ComponentContext { &w, 1, 1 }, "Clocked AND wrapper" };
+    w.dependencies.push_back(clocked);
+    REQUIRE_EQ(w.load_dependencies(), Error::OK);
+    Node inner = w.add_node<ComponentNode>(clocked);
+    REQUIRE(w.connect(inner, 0, w.component_context->get_input(0)));
+    REQUIRE(w.connect(w.component_context->get_output(0), 0, inner));
+    std::string wrapper = w.to_dependency();
+    REQUIRE_EQ(io::component::fetch(wrapper, w.to_json().toStyledString()),
+        Error::OK);
+
+    size_t w_idx   = io::scene::create("Clocked AND wrapper user", "", "", 1);
+    NRef<Scene> ws = io::scene::get(w_idx);
+    ws->dependencies.push_back(wrapper);
+    REQUIRE_EQ(ws->load_dependencies(), Error::OK);
+    Node w_in  = ws->add_node<InputNode>();
+    Node w_cmp = ws->add_node<ComponentNode>(wrapper);
+    Node w_out = ws->add_node<OutputNode>();
+    REQUIRE(ws->connect(w_cmp, 0, w_in));
+    REQUIRE(ws->connect(w_out, 0, w_cmp, 0));
+    REQUIRE(io::scene::step(w_idx));
+    ws->get_node<InputNode>(w_in)->set(true);
+    REQUIRE_EQ(ws->get_node<OutputNode>(w_out)->get(), State::TRUE);
+
+    /* Instances on other threads run while the clocks are toggled. */
+    std::atomic<bool> is_done     = false;
+    std::atomic<size_t> invalid_s = 0;
+    std::thread worker { [&]() {
+        InstanceState worker_state {};
+        while (!is_done) {
+            if (io::component::run(id, 1, worker_state) > 1) {
+                invalid_s++;
+            }
+        }
+    } };
+    for (size_t i = 0; i < 100; i++) {
+        REQUIRE(io::scene::step(w_idx));
+    }
+    is_done = true;
+    worker.join();
+    REQUIRE_EQ(invalid_s, 0);
+    REQUIRE_EQ(io::scene::close(w_idx), Error::OK);
+}
+
+TEST_CASE("Run a component from multiple threads")
+{
+    Scene l { ComponentContext { &l, 2, 1 }, "Threaded SR latch" };
+    auto nor_r = l.add_node<GateNode>(GateType::NOR);
+    auto nor_s = l.add_node<GateNode>(GateType::NOR);
+    l.connect(nor_r, 0, l.component_context->get_input(0));
+    l.connect(nor_s, 0, l.component_context->get_input(1));
+    l.connect(nor_r, 1, nor_s);
+    l.connect(nor_s, 1, nor_r);
+    l.connect(l.component_context->get_output(0), 0, nor_r);
+    std::string latch = l.to_dependency();
+    std::string text  = l.to_json().toStyledString();
+    REQUIRE_EQ(io::component::fetch(latch, text), Error::OK);
+
+    compid id = io::component::intern(latch);
+    InstanceState first {};
+    uint64_t set   = io::component::run(id, 0b10, first);
+    uint64_t reset = io::component::run(id, 0b01, first);
+
+    std::atomic<size_t> errors { 0 };
+    std::vector<std::thread> threads {};
+    for (size_t t = 0; t < 4; t++) {
+        threads.emplace_back([&, t]() {
+            InstanceState state {};
+            for (size_t i = 0; i < 2000; i++) {
+                bool is_set  = (i + t) % 3 == 0;
+                uint64_t q   = io::component::run(
+                    id, is_set ? 0b10 : 0b01, state);
+                auto version = state.component;
+                if (q != (is_set ? set : reset)) {
+                    errors++;
+                }
+                /* A reload restarts the instance from the loaded state. */
+                if (io::component::run(id, 0b00, state) != q
+                    && state.component == version) {
+                    errors++;
+                }
+                if (io::component::get(latch) == nullptr) {
+                    errors++;
+                }
+            }
+        });
+    }
+    /* Readers keep running the version they started with. */
+    for (size_t i = 0; i < 20; i++) {
+        REQUIRE_EQ(io::component::fetch(latch, text, true), Error::OK);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    REQUIRE_EQ(errors.load(), 0);
+}
@@ -2,6 +2,8 @@
 #include "core.h"
 #include "io.h"
 #include <doctest.h>
+#include <filesystem>
+#include <optional>
 #include <json/json.h>
 
 using namespace lcs;
@@ -164,3 +166,252 @@ TEST_CASE("Fetch a non-local component")
         REQUIRE_EQ(s2.get_node<OutputNode>(o)->get(), State::TRUE);
     }
 }
+
+TEST_CASE("Save a scene in the background")
+{
+    size_t idx    = io::scene::create("Save a scene in the background");
+    NRef<Scene> s = io::scene::get(idx);
+    auto v        = s->add_node<InputNode>();
+    auto o        = s->add_node<OutputNode>();
+    s->connect(o, 0, v);
+    std::string s_str = s->to_json().toStyledString();
+
+    io::scene::SaveResult result;
+    REQUIRE_EQ(io::scene::save_as_async(TMP / "async.json", idx), Error::OK);
+    REQUIRE(io::scene::is_saved(idx));
+    /* Edits after the save are not written. */
+    s->add_node<GateNode>(GateType::AND);
+    io::scene::notify_change(idx);
+    while (!io::scene::poll_save(result)) { }
+    REQUIRE_EQ(result.err, Error::OK);
+    REQUIRE_EQ(result.path, TMP / "async.json");
+    REQUIRE_EQ(read(TMP / "async.json"), s_str);
+    REQUIRE_FALSE(std::filesystem::exists(TMP / "async.json.tmp"));
+    REQUIRE_FALSE(io::scene::poll_save(result));
+
+    /* A file can not be written below another file. */
+    REQUIRE_EQ(io::scene::save_as_async(TMP / "async.json" / "x.json", idx),
+        Error::OK);
+    REQUIRE(io::scene::is_saved(idx));
+    while (!io::scene::poll_save(result)) { }
+    REQUIRE_EQ(result.err, Error::WRITE_FAILED);
+    REQUIRE_FALSE(io::scene::is_saved(idx));
+    REQUIRE_EQ(read(TMP / "async.json"), s_str);
+    REQUIRE_EQ(io::scene::save(idx), Error::WRITE_FAILED);
+    REQUIRE_FALSE(io::scene::is_saved(idx));
+
+    /* A save waits for the background saves that were started before. */
+    REQUIRE_EQ(io::scene::save_as_async(TMP / "async.json", idx), Error::OK);
+    s->add_node<GateNode>(GateType::OR);
+    io::scene::notify_change(idx);
+    REQUIRE_EQ(io::scene::save(idx), Error::OK);
+    std::string last_str = s->to_json().toStyledString();
+    REQUIRE_EQ(read(TMP / "async.json"), last_str);
+    while (!io::scene::poll_save(result)) { }
+    REQUIRE_EQ(result.err, Error::OK);
+    REQUIRE_EQ(read(TMP / "async.json"), last_str);
+    REQUIRE_EQ(io::scene::close(idx), Error::OK);
+}
+
+TEST_CASE("Save a loaded component in the background")
+{
+    size_t idx    = io::scene::create("Save a loaded component");
+    NRef<Scene> s = io::scene::get(idx);
+    s->component_context.emplace(&s, 1, 1);
+    s->connect(s->component_context->get_output(0), 0,
+        s->component_context->get_input(0));
+    std::string dependency = s->to_dependency();
+    REQUIRE_EQ(io::scene::save(idx), Error::OK);
+    REQUIRE_EQ(io::component::fetch(dependency), Error::OK);
+
+    Node g_not = s->add_node<GateNode>(GateType::NOT);
+    s->connect(g_not, 0, s->component_context->get_input(0));
+    s->connect(s->component_context->get_output(0), 0, g_not);
+    io::scene::notify_change(idx);
+    std::string s_str = s->to_json().toStyledString();
+    REQUIRE_EQ(io::scene::save_async(idx), Error::OK);
+    io::scene::SaveResult result;
+    while (!io::scene::poll_save(result)) { }
+    REQUIRE_EQ(result.err, Error::OK);
+    REQUIRE_EQ(io::component::get(dependency)->to_json().toStyledString(),
+        s_str);
+    REQUIRE_EQ(io::scene::close(idx), Error::OK);
+}
+
+TEST_CASE("Index the component library")
+{
+    size_t idx    = io::scene::create("Indexed component");
+    NRef<Scene> s = io::scene::get(idx);
+    s->component_context.emplace(&s, 2, 1);
+    Node g_and = s->add_node<GateNode>(GateType::AND);
+    s->connect(g_and, 0, s->component_context->get_input(0));
+    s->connect(g_and, 1, s->component_context->get_input(1));
+    s->connect(s->component_context->get_output(0), 0, g_and);
+    std::string dependency = s->to_dependency();
+    std::filesystem::path path { s->to_filepath() };
+    REQUIRE_EQ(io::scene::save(idx), Error::OK);
+    REQUIRE_EQ(io::scene::close(idx), Error::OK);
+
+    auto find = [&]() -> std::optional<io::component::Entry> {
+        for (const io::component::Entry& e : io::component::list()) {
+            if (e.dependency == dependency) {
+                return e;
+            }
+        }
+        return std::nullopt;
+    };
+    REQUIRE_GT(io::component::update_index(), 0);
+    REQUIRE(std::filesystem::exists(CACHE / "components.json"));
+    auto entry = find();
+    REQUIRE(entry.has_value());
+    REQUIRE_EQ(entry->name, "Indexed component");
+    REQUIRE_EQ(entry->input_s, 2);
+    REQUIRE_EQ(entry->output_s, 1);
+    REQUIRE_EQ(entry->size, std::filesystem::file_size(path));
+
+    /* Dependencies are resolved from the index, whatever the file name. */
+    std::filesystem::path renamed = LOCAL / "renamed.json";
+    std::filesystem::rename(path, renamed);
+    io::component::update_index();
+    REQUIRE_EQ(find()->path, renamed.string());
+    REQUIRE_EQ(find()->hash, entry->hash);
+    REQUIRE_EQ(io::component::fetch(dependency, true), Error::OK);
+    REQUIRE_EQ(io::component::run(dependency, 0b11), 1);
+
+    std::filesystem::remove(renamed);
+    io::component::update_index();
+    REQUIRE_FALSE(find().has_value());
+}
+
+TEST_CASE("Index a component that has a dependency")
+{
+    Scene leaf { ComponentContext { &leaf, 1, 1 }, "Indexed leaf" };
+    Node g_not = leaf.add_node<GateNode>(GateType::NOT);
+    leaf.connect(g_not, 0, leaf.component_context->get_input(0));
+    leaf.connect(leaf.component_context->get_output(0), 0, g_not);
+    std::string leaf_text = leaf.to_json().toStyledString();
+    REQUIRE_EQ(io::component::fetch(leaf.to_dependency(), leaf_text),
+        Error::OK);
+
+    Scene top { ComponentContext { &top, 1, 1 }, "Indexed top" };
+    top.dependencies.push_back(leaf.to_dependency());
+    Node c = top.add_node<ComponentNode>(leaf.to_dependency());
+    REQUIRE(top.connect(c, 0, top.component_context->get_input(0)));
+    REQUIRE(top.connect(top.component_context->get_output(0), 0, c));
+    std::string top_text = top.to_json().toStyledString();
+
+    /* Renamed copies are written. The top copy is indexed before its leaf
+     * exists, and indexing doesn't load the leaf. */
+    std::vector<std::string> dependencies;
+    for (std::string* text : { &top_text, &leaf_text }) {
+        size_t at = 0;
+        while ((at = text->find("Indexed ", at)) != std::string::npos) {
+            at += 8;
+            text->insert(at, "copy ");
+        }
+        Json::Reader reader {};
+        Json::Value doc;
+        REQUIRE(reader.parse(*text, doc));
+        Scene named { doc["name"].asString() };
+        REQUIRE(write(named.to_filepath(), *text));
+        dependencies.push_back(named.to_dependency());
+        io::component::update_index();
+        REQUIRE_EQ(io::component::get("local/Indexed copy leaf/1"), nullptr);
+    }
+    size_t indexed_s = 0;
+    for (const io::component::Entry& e : io::component::list()) {
+        if (e.dependency == dependencies[0]) {
+            REQUIRE_EQ(e.input_s, 1);
+            REQUIRE_EQ(e.output_s, 1);
+            REQUIRE_EQ(e.dependencies,
+                std::vector<std::string> { dependencies[1] });
+            indexed_s++;
+        } else if (e.dependency == dependencies[1]) {
+            REQUIRE(e.dependencies.empty());
+            indexed_s++;
+        }
+    }
+    REQUIRE_EQ(indexed_s, 2);
+    REQUIRE_EQ(io::component::fetch(dependencies[0]), Error::OK);
+    REQUIRE_NE(io::component::get(dependencies[1]), nullptr);
+}
+
+TEST_CASE("Fetch nested components")
+{
+    Scene leaf { ComponentContext { &leaf, 1, 1 }, "Nested leaf" };
+    Node g_not = leaf.add_node<GateNode>(GateType::NOT);
+    leaf.connect(g_not, 0, leaf.component_context->get_input(0));
+    leaf.connect(leaf.component_context->get_output(0), 0, g_not);
+    REQUIRE(write(leaf.to_filepath(), leaf.to_json().toStyledString()));
+    REQUIRE_EQ(io::component::fetch(leaf.to_dependency()), Error::OK);
+
+    /* Two components use the leaf, the top component uses both. */
+    std::vector<std::string> mids;
+    std::vector<std::string> texts;
+    for (const char* name : { "Nested middle 1", "Nested middle 2" }) {
+        Scene mid { ComponentContext { &mid, 1, 1 }, name };
+        mid.dependencies.push_back(leaf.to_dependency());
+        Node c = mid.add_node<ComponentNode>(leaf.to_dependency());
+        REQUIRE(mid.connect(c, 0, mid.component_context->get_input(0)));
+        REQUIRE(mid.connect(mid.component_context->get_output(0), 0, c));
+        mids.push_back(mid.to_dependency());
+        texts.push_back(mid.to_json().toStyledString());
+        REQUIRE_EQ(io::component::fetch(mids.back(), texts.back()), Error::OK);
+    }
+    Scene top { ComponentContext { &top, 1, 2 }, "Nested top" };
+    top.dependencies = mids;
+    for (sockid i = 0; i < 2; i++) {
+        Node c = top.add_node<ComponentNode>(mids[i]);
+        REQUIRE(top.connect(c, 0, top.component_context->get_input(0)));
+        REQUIRE(top.connect(top.component_context->get_output(i), 0, c));
+    }
+    texts.push_back(top.to_json().toStyledString());
+
+    /* Renamed copies are stored, so none of them is loaded before. */
+    std::string dependency;
+    for (std::string& text : texts) {
+        for (const char* name : { "Nested middle", "Nested top" }) {
+            size_t at = 0;
+            while ((at = text.find(name, at)) != std::string::npos) {
+                at += 7;
+                text.insert(at, "copy ");
+            }
+        }
+        Json::Reader reader {};
+        Json::Value doc;
+        REQUIRE(reader.parse(text, doc));
+        Scene named { doc["name"].asString() };
+        REQUIRE(write(named.to_filepath(), text));
+        dependency = named.to_dependency();
+    }
+    REQUIRE_EQ(io::component::get(dependency), nullptr);
+    REQUIRE_EQ(io::component::fetch_all({ dependency }), Error::OK);
+    REQUIRE_NE(io::component::get("local/Nested copy middle 2/1"), nullptr);
+    REQUIRE_EQ(io::component::run(dependency, 0b1), 0b00);
+    REQUIRE_EQ(io::component::run(dependency, 0b0), 0b11);
+
+    REQUIRE_EQ(io::component::fetch_all({ "Not a dependency" }),
+        Error::INVALID_DEPENDENCY_FORMAT);
+}
+
+TEST_CASE("Reject cyclic dependencies")
+{
+    Scene a { ComponentContext { &a, 1, 1 }, "Cycle A" };
+    Scene b { ComponentContext { &b, 1, 1 }, "Cycle B" };
+    Json::Value doc_a = a.to_json();
+    Json::Value doc_b = b.to_json();
+    doc_a["dependencies"].append(b.to_dependency());
+    doc_b["dependencies"].append(a.to_dependency());
+    REQUIRE(write(a.to_filepath(), doc_a.toStyledString()));
+    REQUIRE(write(b.to_filepath(), doc_b.toStyledString()));
+    REQUIRE_EQ(io::component::fetch(a.to_dependency()),
+        Error::CYCLIC_DEPENDENCY);
+    REQUIRE_EQ(io::component::get(a.to_dependency()), nullptr);
+
+    Scene self { ComponentContext { &self, 1, 1 }, "Cycle self" };
+    Json::Value doc = self.to_json();
+    doc["dependencies"].append(self.to_dependency());
+    REQUIRE(write(self.to_filepath(), doc.toStyledString()));
+    Scene s;
+    REQUIRE_EQ(s.from_json(doc), Error::CYCLIC_DEPENDENCY);
+}
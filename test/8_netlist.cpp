@@ -0,0 +1,311 @@
+#include "common.h"
+#include "core.h"
+#include "io.h"
+#include "test_util.h"
+#include <array>
+#include <doctest.h>
+#include <json/json.h>
+using namespace lcs;
+
+TEST_CASE("Compiled Full Adder")
+{
+    Scene s;
+    _create_full_adder_io(s);
+    _create_full_adder(s);
+    s.set_mode(SimulationMode::COMPILED);
+
+    for (int i = 0; i < 8; i++) {
+        bool v_a = i & 1, v_b = i & 2, v_c = i & 4;
+        s.get_node<InputNode>(a)->set(v_a);
+        s.get_node<InputNode>(b)->set(v_b);
+        s.get_node<InputNode>(c_in)->set(v_c);
+        int total = v_a + v_b + v_c;
+
+        REQUIRE_EQ(s.get_node<OutputNode>(sum)->get(),
+            total & 1 ? State::TRUE : State::FALSE);
+        REQUIRE_EQ(s.get_node<OutputNode>(c_out)->get(),
+            total > 1 ? State::TRUE : State::FALSE);
+    }
+    REQUIRE_FALSE(s._netlist.is_cyclic());
+    REQUIRE_EQ(s._netlist.size(), 10);
+    REQUIRE_EQ(s._netlist.levels(), 5);
+}
+
+TEST_CASE("Compiled netlist follows structural changes")
+{
+    Scene s;
+    auto v     = s.add_node<InputNode>();
+    auto v2    = s.add_node<InputNode>();
+    auto g_and = s.add_node<GateNode>(GateType::AND);
+    auto o     = s.add_node<OutputNode>();
+    s.set_mode(SimulationMode::COMPILED);
+
+    REQUIRE(s.connect(g_and, 0, v));
+    REQUIRE(s.connect(g_and, 1, v2));
+    relid r = s.connect(o, 0, g_and);
+    REQUIRE(r);
+
+    s.get_node<InputNode>(v)->set(true);
+    s.get_node<InputNode>(v2)->set(true);
+    REQUIRE_EQ(s.get_node<OutputNode>(o)->get(), State::TRUE);
+    REQUIRE_EQ(s.get_value(r), State::TRUE);
+
+    s.get_node<GateNode>(g_and)->increment();
+    s.get_node<InputNode>(v)->set(false);
+    REQUIRE_EQ(s.get_node<OutputNode>(o)->get(), State::DISABLED);
+    REQUIRE_EQ(s.get_node<GateNode>(g_and)->get(), State::DISABLED);
+
+    s.get_node<GateNode>(g_and)->decrement();
+    s.get_node<InputNode>(v)->set(true);
+    REQUIRE_EQ(s.get_node<OutputNode>(o)->get(), State::TRUE);
+}
+
+TEST_CASE("Compiled SR Latch")
+{
+    Scene s;
+    auto set    = s.add_node<InputNode>();
+    auto reset  = s.add_node<InputNode>();
+    auto g_nor  = s.add_node<GateNode>(GateType::NOR);
+    auto g_nor2 = s.add_node<GateNode>(GateType::NOR);
+    auto q      = s.add_node<OutputNode>();
+
+    REQUIRE(s.connect(g_nor, 0, reset));
+    REQUIRE(s.connect(g_nor, 1, g_nor2));
+    REQUIRE(s.connect(g_nor2, 0, set));
+    REQUIRE(s.connect(g_nor2, 1, g_nor));
+    REQUIRE(s.connect(q, 0, g_nor));
+    s.set_mode(SimulationMode::COMPILED);
+
+    s.get_node<InputNode>(set)->set(true);
+    REQUIRE(s._netlist.is_cyclic());
+    REQUIRE_EQ(s.get_node<OutputNode>(q)->get(), State::TRUE);
+    s.get_node<InputNode>(set)->set(false);
+    REQUIRE_EQ(s.get_node<OutputNode>(q)->get(), State::TRUE);
+    s.get_node<InputNode>(reset)->set(true);
+    REQUIRE_EQ(s.get_node<OutputNode>(q)->get(), State::FALSE);
+    s.get_node<InputNode>(reset)->set(false);
+    REQUIRE_EQ(s.get_node<OutputNode>(q)->get(), State::FALSE);
+}
+
+TEST_CASE("Run a compiled 2x1 MUX component")
+{
+    Scene s { ComponentContext { &s, 3, 1 }, "Compiled 2x1 MUX" };
+    auto g_and   = s.add_node<GateNode>(GateType::AND);
+    auto g_and_2 = s.add_node<GateNode>(GateType::AND);
+    auto g_not   = s.add_node<GateNode>(GateType::NOT);
+    auto g_out   = s.add_node<GateNode>(GateType::OR);
+
+    s.connect(g_and, 0, s.component_context->get_input(0));
+    s.connect(g_and_2, 0, s.component_context->get_input(1));
+    s.connect(g_and, 1, s.component_context->get_input(2));
+    s.connect(g_not, 0, s.component_context->get_input(2));
+    s.connect(g_and_2, 1, g_not);
+    s.connect(g_out, 0, g_and);
+    s.connect(g_out, 1, g_and_2);
+    s.connect(s.component_context->get_output(0), 0, g_out);
+    s.set_mode(SimulationMode::COMPILED);
+
+    REQUIRE_EQ(s.component_context->run(0b111), 1);
+    REQUIRE_EQ(s.component_context->run(0b110), 0);
+    REQUIRE_EQ(s.component_context->run(0b101), 1);
+    REQUIRE_EQ(s.component_context->run(0b100), 0);
+    REQUIRE_EQ(s.component_context->run(0b011), 1);
+    REQUIRE_EQ(s.component_context->run(0b010), 1);
+    REQUIRE_EQ(s.component_context->run(0b001), 0);
+    REQUIRE_EQ(s.component_context->run(0b000), 0);
+}
+
+/* Half adder with an additional in0 & !in1 output, so the order of the input
+ * sockets is visible. */
+static std::string _create_half_adder(Node* g_xor)
+{
+    Scene s { ComponentContext { &s, 2, 3 }, "Flattened half adder" };
+    *g_xor     = s.add_node<GateNode>(GateType::XOR);
+    auto g_and = s.add_node<GateNode>(GateType::AND);
+    auto g_not = s.add_node<GateNode>(GateType::NOT);
+    auto g_dif = s.add_node<GateNode>(GateType::AND);
+    s.connect(*g_xor, 0, s.component_context->get_input(0));
+    s.connect(*g_xor, 1, s.component_context->get_input(1));
+    s.connect(g_and, 0, s.component_context->get_input(0));
+    s.connect(g_and, 1, s.component_context->get_input(1));
+    s.connect(g_not, 0, s.component_context->get_input(1));
+    s.connect(g_dif, 0, s.component_context->get_input(0));
+    s.connect(g_dif, 1, g_not);
+    s.connect(s.component_context->get_output(0), 0, *g_xor);
+    s.connect(s.component_context->get_output(1), 0, g_and);
+    s.connect(s.component_context->get_output(2), 0, g_dif);
+    std::string name = s.to_dependency();
+    REQUIRE_EQ(io::component::fetch(name, s.to_json().toStyledString(), true),
+        Error::OK);
+    return name;
+}
+
+TEST_CASE("Flattened netlist inlines components")
+{
+    Node g_xor;
+    std::string ha = _create_half_adder(&g_xor);
+
+    std::array<Scene, 2> scenes {};
+    std::array<Node, 3> in {};
+    std::array<Node, 3> out {};
+    std::array<Node, 2> comp {};
+    for (Scene& s : scenes) {
+        s.dependencies.push_back(ha);
+        REQUIRE_FALSE(s.load_dependencies());
+        for (Node& i : in) {
+            i = s.add_node<InputNode>();
+        }
+        for (Node& o : out) {
+            o = s.add_node<OutputNode>();
+        }
+        comp[0]   = s.add_node<ComponentNode>(ha);
+        comp[1]   = s.add_node<ComponentNode>(ha);
+        auto g_or = s.add_node<GateNode>(GateType::OR);
+        REQUIRE(s.connect(comp[0], 0, in[0]));
+        REQUIRE(s.connect(comp[0], 1, in[1]));
+        REQUIRE(s.connect(comp[1], 0, comp[0], 0));
+        REQUIRE(s.connect(comp[1], 1, in[2]));
+        REQUIRE(s.connect(g_or, 0, comp[0], 1));
+        REQUIRE(s.connect(g_or, 1, comp[1], 1));
+        REQUIRE(s.connect(out[0], 0, comp[1], 0));
+        REQUIRE(s.connect(out[1], 0, g_or));
+        REQUIRE(s.connect(out[2], 0, comp[1], 2));
+        s.set_mode(SimulationMode::COMPILED);
+    }
+    Scene& flat = scenes[1];
+    flat._netlist.set_flatten(true);
+
+    for (int i = 0; i < 8; i++) {
+        for (Scene& s : scenes) {
+            for (size_t j = 0; j < in.size(); j++) {
+                s.get_node<InputNode>(in[j])->set(i & (1 << j));
+            }
+        }
+        for (size_t j = 0; j < out.size(); j++) {
+            REQUIRE_EQ(flat.get_node<OutputNode>(out[j])->get(),
+                scenes[0].get_node<OutputNode>(out[j])->get());
+        }
+        REQUIRE_EQ(flat.get_node<ComponentNode>(comp[0])->get(1),
+            scenes[0].get_node<ComponentNode>(comp[0])->get(1));
+        REQUIRE_EQ(flat._netlist.get_value({ comp[0] }, g_xor),
+            (i & 1) != ((i >> 1) & 1) ? State::TRUE : State::FALSE);
+    }
+    REQUIRE_EQ(scenes[0]._netlist.instances(), 0);
+    REQUIRE_EQ(flat._netlist.instances(), 2);
+    REQUIRE_EQ(flat._netlist.get_value({ comp[0], comp[1] }, g_xor),
+        State::DISABLED);
+
+    /* Disconnecting an input disables the whole instance. */
+    relid r = flat.get_node<ComponentNode>(comp[1])->inputs[1];
+    REQUIRE_FALSE(flat.disconnect(r));
+    flat.get_node<InputNode>(in[0])->toggle();
+    REQUIRE_EQ(flat.get_node<OutputNode>(out[0])->get(), State::DISABLED);
+    REQUIRE_EQ(flat.get_node<OutputNode>(out[2])->get(), State::DISABLED);
+
+    /* Reloading the component rebuilds the flattened netlist. */
+    std::string reloaded = _create_half_adder(&g_xor);
+    REQUIRE_EQ(reloaded, ha);
+    flat.get_node<InputNode>(in[0])->toggle();
+    REQUIRE_EQ(flat._netlist.instances(), 2);
+    bool v_a = flat.get_node<InputNode>(in[0])->get() == State::TRUE;
+    bool v_b = flat.get_node<InputNode>(in[1])->get() == State::TRUE;
+    REQUIRE_EQ(flat._netlist.get_value({ comp[0] }, g_xor),
+        v_a != v_b ? State::TRUE : State::FALSE);
+    REQUIRE_EQ(flat.get_node<ComponentNode>(comp[0])->get(0),
+        v_a != v_b ? State::TRUE : State::FALSE);
+}
+
+TEST_CASE("Flattened netlist inlines nested components")
+{
+    Node g_xor;
+    std::string ha = _create_half_adder(&g_xor);
+
+    Scene fa { ComponentContext { &fa, 3, 2 }, "Flattened full adder" };
+    fa.dependencies.push_back(ha);
+    REQUIRE_FALSE(fa.load_dependencies());
+    auto ha_1 = fa.add_node<ComponentNode>(ha);
+    auto ha_2 = fa.add_node<ComponentNode>(ha);
+    auto g_or = fa.add_node<GateNode>(GateType::OR);
+    fa.connect(ha_1, 0, fa.component_context->get_input(0));
+    fa.connect(ha_1, 1, fa.component_context->get_input(1));
+    fa.connect(ha_2, 0, ha_1, 0);
+    fa.connect(ha_2, 1, fa.component_context->get_input(2));
+    fa.connect(g_or, 0, ha_1, 1);
+    fa.connect(g_or, 1, ha_2, 1);
+    fa.connect(fa.component_context->get_output(0), 0, ha_2, 0);
+    fa.connect(fa.component_context->get_output(1), 0, g_or);
+    std::string name = fa.to_dependency();
+    REQUIRE_EQ(io::component::fetch(name, fa.to_json().toStyledString(), true),
+        Error::OK);
+
+    Scene s;
+    s.dependencies.push_back(name);
+    REQUIRE_FALSE(s.load_dependencies());
+    std::array<Node, 3> in {};
+    for (Node& i : in) {
+        i = s.add_node<InputNode>();
+    }
+    auto c = s.add_node<ComponentNode>(name);
+    auto o = s.add_node<OutputNode>();
+    for (size_t i = 0; i < in.size(); i++) {
+        REQUIRE(s.connect(c, i, in[i]));
+    }
+    REQUIRE(s.connect(o, 0, c, 1));
+    s.set_mode(SimulationMode::COMPILED);
+    s._netlist.set_flatten(true);
+
+    for (int i = 0; i < 8; i++) {
+        for (size_t j = 0; j < in.size(); j++) {
+            s.get_node<InputNode>(in[j])->set(i & (1 << j));
+        }
+        uint64_t input = (i & 1) << 2 | (i & 2) | (i & 4) >> 2;
+        REQUIRE_EQ(s.get_node<OutputNode>(o)->get(),
+            io::component::run(name, input) & 2 ? State::TRUE : State::FALSE);
+    }
+    REQUIRE_EQ(s._netlist.instances(), 3);
+    REQUIRE_NE(s._netlist.get_value({ c, ha_1 }, g_xor), State::DISABLED);
+}
+
+TEST_CASE("Parallel levels match the serial evaluation")
+{
+    constexpr size_t in_s   = 64;
+    constexpr size_t gate_s = Netlist::PARALLEL_LIMIT;
+    std::array<Scene, 2> scenes {};
+    std::vector<Node> in(in_s);
+    std::vector<Node> gates(2 * gate_s);
+    for (Scene& s : scenes) {
+        for (Node& i : in) {
+            i = s.add_node<InputNode>();
+        }
+        for (size_t i = 0; i < gate_s; i++) {
+            gates[i] = s.add_node<GateNode>(
+                i % 3 == 0 ? GateType::XOR : GateType::NAND);
+            REQUIRE(s.connect(gates[i], 0, in[i % in_s]));
+            REQUIRE(s.connect(gates[i], 1, in[(i * 7 + 3) % in_s]));
+        }
+        for (size_t i = gate_s; i < 2 * gate_s; i++) {
+            gates[i] = s.add_node<GateNode>(GateType::OR);
+            REQUIRE(s.connect(gates[i], 0, gates[i - gate_s]));
+            REQUIRE(s.connect(gates[i], 1, gates[(i * 13) % gate_s]));
+        }
+        s.set_mode(SimulationMode::COMPILED);
+    }
+
+    uint64_t pattern = 0x9E3779B97F4A7C15;
+    for (int step = 0; step < 8; step++) {
+        pattern = pattern * 6364136223846793005ULL + 1442695040888963407ULL;
+        for (size_t t = 0; t < scenes.size(); t++) {
+            Netlist::set_thread_count(t == 0 ? 1 : 4);
+            Scene& s = scenes[t];
+            for (size_t i = 0; i < in_s; i++) {
+                s.get_node<InputNode>(in[i])->set((pattern >> i) & 1);
+            }
+        }
+        for (Node g : gates) {
+            REQUIRE_EQ(scenes[0].get_node<GateNode>(g)->get(),
+                scenes[1].get_node<GateNode>(g)->get());
+        }
+    }
+    REQUIRE_EQ(scenes[1]._netlist.levels(), 3);
+    Netlist::set_thread_count(1);
+}
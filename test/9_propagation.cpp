@@ -0,0 +1,122 @@
+#include "common.h"
+#include "core.h"
+#include <doctest.h>
+#include <json/json.h>
+using namespace lcs;
+
+TEST_CASE("Deep NOT chain")
+{
+    Scene s;
+    auto v    = s.add_node<InputNode>();
+    auto o    = s.add_node<OutputNode>();
+    Node prev = v;
+    for (size_t i = 0; i < 5000; i++) {
+        Node g = s.add_node<GateNode>(GateType::NOT);
+        REQUIRE(s.connect(g, 0, prev));
+        prev = g;
+    }
+    REQUIRE(s.connect(o, 0, prev));
+
+    REQUIRE_EQ(s.get_node<OutputNode>(o)->get(), State::FALSE);
+    s.get_node<InputNode>(v)->set(true);
+    REQUIRE_EQ(s.get_node<OutputNode>(o)->get(), State::TRUE);
+    s.get_node<InputNode>(v)->set(false);
+    REQUIRE_EQ(s.get_node<OutputNode>(o)->get(), State::FALSE);
+}
+
+TEST_CASE("SR Latch")
+{
+    Scene s;
+    auto set    = s.add_node<InputNode>();
+    auto reset  = s.add_node<InputNode>();
+    auto g_nor  = s.add_node<GateNode>(GateType::NOR);
+    auto g_nor2 = s.add_node<GateNode>(GateType::NOR);
+    auto q      = s.add_node<OutputNode>();
+
+    REQUIRE(s.connect(g_nor, 0, reset));
+    REQUIRE(s.connect(g_nor, 1, g_nor2));
+    REQUIRE(s.connect(g_nor2, 0, set));
+    REQUIRE(s.connect(g_nor2, 1, g_nor));
+    REQUIRE(s.connect(q, 0, g_nor));
+
+    s.get_node<InputNode>(set)->set(true);
+    REQUIRE_EQ(s.get_node<OutputNode>(q)->get(), State::TRUE);
+    s.get_node<InputNode>(set)->set(false);
+    REQUIRE_EQ(s.get_node<OutputNode>(q)->get(), State::TRUE);
+    s.get_node<InputNode>(reset)->set(true);
+    REQUIRE_EQ(s.get_node<OutputNode>(q)->get(), State::FALSE);
+    s.get_node<InputNode>(reset)->set(false);
+    REQUIRE_EQ(s.get_node<OutputNode>(q)->get(), State::FALSE);
+}
+
+TEST_CASE("Ring oscillator")
+{
+    Scene s;
+    s.set_event_budget(1000);
+    auto v     = s.add_node<InputNode>();
+    auto g_and = s.add_node<GateNode>(GateType::AND);
+    auto g_not = s.add_node<GateNode>(GateType::NOT);
+    auto g_buf = s.add_node<GateNode>(GateType::NOT);
+    auto g_inv = s.add_node<GateNode>(GateType::NOT);
+
+    REQUIRE(s.connect(g_and, 0, v));
+    REQUIRE(s.connect(g_not, 0, g_and));
+    REQUIRE(s.connect(g_buf, 0, g_not));
+    REQUIRE(s.connect(g_inv, 0, g_buf));
+    relid loop = s.connect(g_and, 1, g_inv);
+    REQUIRE(loop);
+
+    s.get_node<InputNode>(v)->set(true);
+    REQUIRE(s.get_rel(loop)->is_oscillating);
+
+    s.get_node<InputNode>(v)->set(false);
+    REQUIRE_FALSE(s.get_rel(loop)->is_oscillating);
+    REQUIRE_EQ(s.get_node<GateNode>(g_inv)->get(), State::TRUE);
+}
+
+TEST_CASE("Batch defers propagation until commit")
+{
+    Scene s;
+    auto v = s.add_node<InputNode>();
+    auto o = s.add_node<OutputNode>();
+    Node set, reset, q;
+    {
+        Scene::Batch batch { s };
+        REQUIRE(s.is_batch());
+        Node prev = v;
+        for (size_t i = 0; i < 5001; i++) {
+            Node g = s.add_node<GateNode>(GateType::NOT);
+            REQUIRE(s.connect(g, 0, prev));
+            prev = g;
+        }
+        REQUIRE(s.connect(o, 0, prev));
+        REQUIRE_EQ(s.event_count(), 0);
+
+        set        = s.add_node<InputNode>();
+        reset      = s.add_node<InputNode>();
+        auto g_nor = s.add_node<GateNode>(GateType::NOR);
+        auto g_nr2 = s.add_node<GateNode>(GateType::NOR);
+        q          = s.add_node<OutputNode>();
+        REQUIRE(s.connect(g_nor, 0, reset));
+        REQUIRE(s.connect(g_nor, 1, g_nr2));
+        REQUIRE(s.connect(g_nr2, 0, set));
+        REQUIRE(s.connect(g_nr2, 1, g_nor));
+        REQUIRE(s.connect(q, 0, g_nor));
+        s.get_node<InputNode>(set)->set(true);
+        REQUIRE_EQ(s.get_node<OutputNode>(q)->get(), State::DISABLED);
+    }
+    REQUIRE_FALSE(s.is_batch());
+    REQUIRE_EQ(s.get_node<OutputNode>(o)->get(), State::TRUE);
+    REQUIRE_EQ(s.get_node<OutputNode>(q)->get(), State::TRUE);
+    s.get_node<InputNode>(set)->set(false);
+    REQUIRE_EQ(s.get_node<OutputNode>(q)->get(), State::TRUE);
+    s.get_node<InputNode>(reset)->set(true);
+    REQUIRE_EQ(s.get_node<OutputNode>(q)->get(), State::FALSE);
+
+    s.get_node<InputNode>(v)->set(true);
+    REQUIRE_EQ(s.get_node<OutputNode>(o)->get(), State::FALSE);
+    Scene loaded;
+    REQUIRE_FALSE(loaded.from_json(s.to_json()));
+    REQUIRE_EQ(loaded.get_node<OutputNode>(o)->get(), State::FALSE);
+    REQUIRE_EQ(loaded.get_node<OutputNode>(q)->get(), State::FALSE);
+}